@@ -1,6 +1,7 @@
 // Porres 2017
 
 #include "m_pd.h"
+#include "shared/biquad.h"
 #include <math.h>
 #include <string.h>
 
@@ -16,89 +17,71 @@ typedef struct _allpass_2nd {
     t_float     x_nyq;
     int     x_bypass;
     int     x_bw;
-    double  x_xnm1;
-    double  x_xnm2;
-    double  x_ynm1;
-    double  x_ynm2;
+    t_biquad    x_biquad;
     } t_allpass_2nd;
 
 static t_class *allpass_2nd_class;
 
+// the coefficients for the parameters of a sample, see shared/biquad.h
+static void allpass_2nd_coefs(void *z, double *p, t_biquad_coefs *c)
+{
+    t_allpass_2nd *x = (t_allpass_2nd *)z;
+    double f = p[0], reson = p[1];
+    double q, omega, alphaQ, cos_w, b0;
+    t_float nyq = x->x_nyq;
+    
+    if (f < 0.000001)
+        f = 0.000001;
+    if (f > nyq - 0.000001)
+        f = nyq - 0.000001;
+    
+    omega = f * PI/nyq; // hz2rad
+    
+    if (x->x_bw) // reson is bw in octaves
+        {
+        if (reson < 0.000001)
+            reson = 0.000001;
+        q = 1 / (2 * sinh(HALF_LOG2 * reson * omega/sin(omega)));
+        }
+    else
+        q = reson;
+        
+    if (q < 0.000001)
+        q = 0.000001;
+
+    alphaQ = sin(omega) / (2*q);
+    cos_w = cos(omega);
+    b0 = alphaQ + 1;
+    c->a0 = (1 - alphaQ) / b0;
+    c->a1 = -2*cos_w / b0;
+    c->a2 = 1;
+    c->b1 = -c->a1;
+    c->b2 = (alphaQ - 1) / b0;
+    c->pass = 0;
+}
+
 static t_int *allpass_2nd_perform(t_int *w)
 {
     t_allpass_2nd *x = (t_allpass_2nd *)(w[1]);
     int nblock = (int)(w[2]);
     t_float *in1 = (t_float *)(w[3]);
-    t_float *in2 = (t_float *)(w[4]);
-    t_float *in3 = (t_float *)(w[5]);
+    t_float *params[2] = {(t_float *)(w[4]), (t_float *)(w[5])};
     t_float *out = (t_float *)(w[6]);
-    double xnm1 = x->x_xnm1;
-    double xnm2 = x->x_xnm2;
-    double ynm1 = x->x_ynm1;
-    double ynm2 = x->x_ynm2;
-    t_float nyq = x->x_nyq;
-    while (nblock--)
-    {
-        double xn = *in1++, f = *in2++, reson = *in3++;
-        double q, omega, alphaQ, cos_w, a0, a1, a2, b0, b1, b2, yn;
-        
-        if (f < 0.000001)
-            f = 0.000001;
-        if (f > nyq - 0.000001)
-            f = nyq - 0.000001;
-        
-        omega = f * PI/nyq; // hz2rad
-        
-        if (x->x_bw) // reson is bw in octaves
-            {
-            if (reson < 0.000001)
-                reson = 0.000001;
-            q = 1 / (2 * sinh(HALF_LOG2 * reson * omega/sin(omega)));
-            }
-        else
-            q = reson;
-            
-        if (q < 0.000001)
-            q = 0.000001;
-
-        alphaQ = sin(omega) / (2*q);
-        cos_w = cos(omega);
-        b0 = alphaQ + 1;
-        a0 = (1 - alphaQ) / b0;
-        a1 = -2*cos_w / b0;
-        a2 = 1;
-        b1 = -a1;
-        b2 = (alphaQ - 1) / b0;
-        
-        yn = a0 * xn + a1 * xnm1 + a2 * xnm2 + b1 * ynm1 + b2 * ynm2;
-        
-        if(x->x_bypass)
-            *out++ = xn;
-        else
-            *out++ = yn;
-        
-        xnm2 = xnm1;
-        xnm1 = xn;
-        ynm2 = ynm1;
-        ynm1 = yn;
-    }
-    x->x_xnm1 = xnm1;
-    x->x_xnm2 = xnm2;
-    x->x_ynm1 = ynm1;
-    x->x_ynm2 = ynm2;
+    biquad_perform(&x->x_biquad, x, allpass_2nd_coefs, in1, params, out, nblock, x->x_bypass);
     return (w + 7);
 }
 
 static void allpass_2nd_dsp(t_allpass_2nd *x, t_signal **sp)
 {
     x->x_nyq = sp[0]->s_sr / 2;
+    biquad_invalidate(&x->x_biquad);
     dsp_add(allpass_2nd_perform, 6, x, sp[0]->s_n, sp[0]->s_vec,
             sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec);
 }
 
 static void allpass_2nd_clear(t_allpass_2nd *x)
 {
-    x->x_xnm1 = x->x_xnm2 = x->x_ynm1 = x->x_ynm2 = 0.;
+    biquad_clear(&x->x_biquad);
 }
 
 static void allpass_2nd_bypass(t_allpass_2nd *x, t_floatarg f)
@@ -109,11 +92,13 @@ static void allpass_2nd_bypass(t_allpass_2nd *x, t_floatarg f)
 static void allpass_2nd_bw(t_allpass_2nd *x)
 {
     x->x_bw = 1;
+    biquad_invalidate(&x->x_biquad);
 }
 
 static void allpass_2nd_q(t_allpass_2nd *x)
 {
     x->x_bw = 0;
+    biquad_invalidate(&x->x_biquad);
 }
 
 static void *allpass_2nd_tilde_new(t_symbol *s, int argc, t_atom *argv)
@@ -169,6 +154,7 @@ static void *allpass_2nd_new(t_symbol *s, int argc, t_atom *argv)
 /////////////////////////////////////////////////////////////////////////////////////
     x->x_bw = bw;
     
+    biquad_init(&x->x_biquad, 2);
     x->x_inlet_freq = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
     pd_float((t_pd *)x->x_inlet_freq, freq);
     x->x_inlet_q = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
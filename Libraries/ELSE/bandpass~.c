@@ -1,6 +1,7 @@
 // Porres 2017
 
 #include "m_pd.h"
+#include "shared/biquad.h"
 #include <math.h>
 #include <string.h>
 
@@ -16,93 +17,75 @@ typedef struct _bandpass {
     t_float     x_nyq;
     int     x_bypass;
     int     x_bw;
-    double  x_xnm1;
-    double  x_xnm2;
-    double  x_ynm1;
-    double  x_ynm2;
+    t_biquad    x_biquad;
     } t_bandpass;
 
 static t_class *bandpass_class;
 
+// the coefficients for the parameters of a sample, see shared/biquad.h
+static void bandpass_coefs(void *z, double *p, t_biquad_coefs *c)
+{
+    t_bandpass *x = (t_bandpass *)z;
+    double f = p[0], reson = p[1];
+    double q, omega, alphaQ, cos_w, b0;
+    t_float nyq = x->x_nyq;
+    
+    if (f < 0.000001)
+        f = 0.000001;
+    if (f > nyq - 0.000001)
+        f = nyq - 0.000001;
+    
+    omega = f * PI/nyq; // hz2rad
+    
+    if (x->x_bw) // reson is bw in octaves
+        {
+        if (reson < 0.000001)
+            reson = 0.000001;
+        q = 1 / (2 * sinh(HALF_LOG2 * reson * omega/sin(omega)));
+        }
+    else
+        q = reson;
+        
+    if (q < 0.000001)
+        {
+        q = 0.000001; // prevent blow-up
+        c->pass = 1; // force bypass
+        }
+    else
+        c->pass = 0;
+    
+    alphaQ = sin(omega) / (2*q);
+    cos_w = cos(omega);
+    b0 = alphaQ + 1;
+    c->a0 = alphaQ / b0;
+    c->a1 = 0;
+    c->a2 = -c->a0;
+    c->b1 = 2*cos_w / b0;
+    c->b2 = (alphaQ - 1) / b0;
+}
+
 static t_int *bandpass_perform(t_int *w)
 {
     t_bandpass *x = (t_bandpass *)(w[1]);
     int nblock = (int)(w[2]);
     t_float *in1 = (t_float *)(w[3]);
-    t_float *in2 = (t_float *)(w[4]);
-    t_float *in3 = (t_float *)(w[5]);
+    t_float *params[2] = {(t_float *)(w[4]), (t_float *)(w[5])};
     t_float *out = (t_float *)(w[6]);
-    double xnm1 = x->x_xnm1;
-    double xnm2 = x->x_xnm2;
-    double ynm1 = x->x_ynm1;
-    double ynm2 = x->x_ynm2;
-    t_float nyq = x->x_nyq;
-    while (nblock--)
-    {
-        double xn = *in1++, f = *in2++, reson = *in3++;
-        double q, omega, alphaQ, cos_w, a0, a2, b0, b1, b2, yn;
-        int q_bypass;
-        
-        if (f < 0.000001)
-            f = 0.000001;
-        if (f > nyq - 0.000001)
-            f = nyq - 0.000001;
-        
-        omega = f * PI/nyq; // hz2rad
-        
-        if (x->x_bw) // reson is bw in octaves
-            {
-            if (reson < 0.000001)
-                reson = 0.000001;
-            q = 1 / (2 * sinh(HALF_LOG2 * reson * omega/sin(omega)));
-            }
-        else
-            q = reson;
-            
-        if (q < 0.000001)
-            {
-            q = 0.000001; // prevent blow-up
-            q_bypass = 1; // force bypass
-            }
-        else
-            q_bypass = 0;
-        
-        alphaQ = sin(omega) / (2*q);
-        cos_w = cos(omega);
-        b0 = alphaQ + 1;
-        a0 = alphaQ / b0;
-        a2 = -a0;
-        b1 = 2*cos_w / b0;
-        b2 = (alphaQ - 1) / b0;
-        yn = a0 * xn + a2 * xnm2 + b1 * ynm1 + b2 * ynm2;
-        
-        if(x->x_bypass || q_bypass)
-            *out++ = xn;
-        else
-            *out++ = yn;
-        
-        xnm2 = xnm1;
-        xnm1 = xn;
-        ynm2 = ynm1;
-        ynm1 = yn;
-    }
-    x->x_xnm1 = xnm1;
-    x->x_xnm2 = xnm2;
-    x->x_ynm1 = ynm1;
-    x->x_ynm2 = ynm2;
+    biquad_perform(&x->x_biquad, x, bandpass_coefs, in1, params, out, nblock, x->x_bypass);
     return (w + 7);
 }
 
 static void bandpass_dsp(t_bandpass *x, t_signal **sp)
 {
     x->x_nyq = sp[0]->s_sr / 2;
+    biquad_invalidate(&x->x_biquad);
     dsp_add(bandpass_perform, 6, x, sp[0]->s_n, sp[0]->s_vec,
             sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec);
 }
 
 static void bandpass_clear(t_bandpass *x)
 {
-    x->x_xnm1 = x->x_xnm2 = x->x_ynm1 = x->x_ynm2 = 0.;
+    biquad_clear(&x->x_biquad);
 }
 
 static void bandpass_bypass(t_bandpass *x, t_floatarg f)
@@ -113,11 +96,13 @@ static void bandpass_bypass(t_bandpass *x, t_floatarg f)
 static void bandpass_bw(t_bandpass *x)
 {
     x->x_bw = 1;
+    biquad_invalidate(&x->x_biquad);
 }
 
 static void bandpass_q(t_bandpass *x)
 {
     x->x_bw = 0;
+    biquad_invalidate(&x->x_biquad);
 }
 
 
@@ -167,6 +152,7 @@ static void *bandpass_new(t_symbol *s, int argc, t_atom *argv)
 /////////////////////////////////////////////////////////////////////////////////////
     x->x_bw = bw;
     
+    biquad_init(&x->x_biquad, 2);
     x->x_inlet_freq = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
     pd_float((t_pd *)x->x_inlet_freq, freq);
     x->x_inlet_q = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
@@ -0,0 +1,97 @@
+// band-limited imp~, replaces the bl.imp~ abstraction (which ran imp~ oversampled by 16)
+
+#include "m_pd.h"
+#include "shared/osc.h"
+#include "shared/blep.h"
+
+// the abstraction's impulse was one sample at 16 times the rate, so it had an area of 1/16 of
+// a sample at the output rate, the same level is kept
+#define BL_IMP_AREA (1. / BLEP_OVERSAMPLE)
+
+static t_class *bl_imp_class;
+
+typedef struct _bl_imp{
+    t_object    x_obj;
+    t_osc       x_osc;
+    t_blep      x_blep;
+    t_float     x_freq;
+    t_inlet    *x_inlet_sync;
+    t_inlet    *x_inlet_phase;
+    t_outlet   *x_outlet;
+}t_bl_imp;
+
+// an impulse when a cycle starts, at the fraction of a sample where the phase went by it, and
+// one when it's synced to 1 like imp~ does
+static void bl_imp_tick(t_blep *b, int i, double phase){
+    double last = b->b_last, step = b->b_step, end = last + step, expected = end;
+    int c;
+    if(expected <= 0) // wrapped like osc_phase() does
+        expected += 1;
+    if(expected >= 1)
+        expected -= 1;
+    for(c = 0; c <= 1 && step != 0; c++)
+        if(step > 0 ? last < c && c <= end : end < c && c <= last)
+            blep_impulse(b, i, (end - c) / step, BL_IMP_AREA);
+    if(phase != expected && phase >= 1)
+        blep_impulse(b, i, 0, BL_IMP_AREA);
+}
+
+static t_int *bl_imp_perform(t_int *w){
+    t_bl_imp *x = (t_bl_imp *)(w[1]);
+    int n = (int)(w[2]);
+    t_float *freq = (t_float *)(w[3]);
+    t_float *sync = (t_float *)(w[4]);
+    t_float *offset = (t_float *)(w[5]);
+    t_float *out = (t_float *)(w[6]);
+    double phase[BLEP_CHUNK], step[BLEP_CHUNK];
+    while(n > 0){
+        int i, m = n < BLEP_CHUNK ? n : BLEP_CHUNK;
+        osc_phase(&x->x_osc, freq, sync, offset, phase, step, m);
+        for(i = 0; i < m; i++){
+            bl_imp_tick(&x->x_blep, i, phase[i]);
+            x->x_blep.b_last = phase[i];
+            x->x_blep.b_step = step[i];
+        }
+        blep_read(&x->x_blep, out, m);
+        freq += m, sync += m, offset += m, out += m, n -= m;
+    }
+    return(w + 7);
+}
+
+static void bl_imp_dsp(t_bl_imp *x, t_signal **sp){
+    x->x_osc.o_sr = sp[0]->s_sr;
+    dsp_add(bl_imp_perform, 6, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec,
+        sp[3]->s_vec);
+}
+
+static void *bl_imp_free(t_bl_imp *x){
+    inlet_free(x->x_inlet_sync);
+    inlet_free(x->x_inlet_phase);
+    outlet_free(x->x_outlet);
+    return(void *)x;
+}
+
+static void *bl_imp_new(t_floatarg f1, t_floatarg f2){
+    t_bl_imp *x = (t_bl_imp *)pd_new(bl_imp_class);
+    t_float init_phase = f2 < 0 || f2 >= 1 ? 0 : f2;
+    osc_init(&x->x_osc, init_phase);
+    x->x_osc.o_last_phase_offset = init_phase;
+    blep_init(&x->x_blep, init_phase);
+    if(init_phase == 0 && f1 >= 0) // starts with an impulse, like imp~
+        blep_impulse(&x->x_blep, 0, 0, BL_IMP_AREA);
+    x->x_freq = f1;
+    x->x_inlet_sync = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_sync, 0);
+    x->x_inlet_phase = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_phase, init_phase);
+    x->x_outlet = outlet_new(&x->x_obj, &s_signal);
+    return(x);
+}
+
+void setup_bl0x2eimp_tilde(void){
+    bl_imp_class = class_new(gensym("bl.imp~"), (t_newmethod)bl_imp_new,
+        (t_method)bl_imp_free, sizeof(t_bl_imp), CLASS_DEFAULT, A_DEFFLOAT, A_DEFFLOAT, 0);
+    CLASS_MAINSIGNALIN(bl_imp_class, t_bl_imp, x_freq);
+    class_addmethod(bl_imp_class, (t_method)bl_imp_dsp, gensym("dsp"), A_CANT, 0);
+    blep_setup();
+}
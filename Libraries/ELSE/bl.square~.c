@@ -0,0 +1,87 @@
+// band-limited square~, replaces the bl.square~ abstraction (which ran square~ oversampled by 16)
+
+#include "m_pd.h"
+#include "shared/osc.h"
+#include "shared/blep.h"
+
+static t_class *bl_square_class;
+
+typedef struct _bl_square{
+    t_object    x_obj;
+    t_osc       x_osc;
+    t_blep      x_blep;
+    t_float     x_freq;
+    t_inlet    *x_inlet_width;
+    t_inlet    *x_inlet_sync;
+    t_inlet    *x_inlet_phase;
+    t_outlet   *x_outlet;
+}t_bl_square;
+
+static t_int *bl_square_perform(t_int *w){
+    t_bl_square *x = (t_bl_square *)(w[1]);
+    int n = (int)(w[2]);
+    t_float *freq = (t_float *)(w[3]);
+    t_float *width = (t_float *)(w[4]);
+    t_float *sync = (t_float *)(w[5]);
+    t_float *offset = (t_float *)(w[6]);
+    t_float *out = (t_float *)(w[7]);
+    double phase[BLEP_CHUNK], step[BLEP_CHUNK];
+    t_blep_shape shape[BLEP_CHUNK];
+    while(n > 0){
+        int i, m = n < BLEP_CHUNK ? n : BLEP_CHUNK;
+        osc_phase(&x->x_osc, freq, sync, offset, phase, step, m);
+        for(i = 0; i < m; i++){
+            double wd = width[i];
+            shape[i].s_n = 2;
+            shape[i].s_start[0] = 0, shape[i].s_value[0] = 1, shape[i].s_slope[0] = 0;
+            shape[i].s_start[1] = wd > 1. ? 1. : wd < 0. ? 0. : wd; // clipped
+            shape[i].s_value[1] = -1, shape[i].s_slope[1] = 0;
+        }
+        blep_shape(&x->x_blep, shape, 1, phase, step, m);
+        blep_read(&x->x_blep, out, m);
+        freq += m, width += m, sync += m, offset += m, out += m, n -= m;
+    }
+    return(w + 8);
+}
+
+static void bl_square_dsp(t_bl_square *x, t_signal **sp){
+    x->x_osc.o_sr = sp[0]->s_sr;
+    dsp_add(bl_square_perform, 7, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec,
+        sp[3]->s_vec, sp[4]->s_vec);
+}
+
+static void *bl_square_free(t_bl_square *x){
+    inlet_free(x->x_inlet_width);
+    inlet_free(x->x_inlet_sync);
+    inlet_free(x->x_inlet_phase);
+    outlet_free(x->x_outlet);
+    return(void *)x;
+}
+
+static void *bl_square_new(t_symbol *s, int ac, t_atom *av){
+    t_bl_square *x = (t_bl_square *)pd_new(bl_square_class);
+    t_float init_freq = atom_getfloatarg(0, ac, av);
+    t_float init_width = ac > 1 ? atom_getfloatarg(1, ac, av) : 0.5;
+    t_float init_phase = atom_getfloatarg(2, ac, av);
+    init_phase = init_phase < 0 || init_phase >= 1 ? 0 : init_phase;
+    osc_init(&x->x_osc, init_phase);
+    x->x_osc.o_last_phase_offset = init_phase;
+    blep_init(&x->x_blep, init_phase);
+    x->x_freq = init_freq;
+    x->x_inlet_width = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_width, init_width);
+    x->x_inlet_sync = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_sync, 0);
+    x->x_inlet_phase = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_phase, init_phase);
+    x->x_outlet = outlet_new(&x->x_obj, &s_signal);
+    return(x);
+}
+
+void setup_bl0x2esquare_tilde(void){
+    bl_square_class = class_new(gensym("bl.square~"), (t_newmethod)bl_square_new,
+        (t_method)bl_square_free, sizeof(t_bl_square), CLASS_DEFAULT, A_GIMME, 0);
+    CLASS_MAINSIGNALIN(bl_square_class, t_bl_square, x_freq);
+    class_addmethod(bl_square_class, (t_method)bl_square_dsp, gensym("dsp"), A_CANT, 0);
+    blep_setup();
+}
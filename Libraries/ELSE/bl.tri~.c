@@ -0,0 +1,73 @@
+// band-limited tri~, replaces the bl.tri~ abstraction (which ran tri~ oversampled by 16)
+
+#include "m_pd.h"
+#include "shared/osc.h"
+#include "shared/blep.h"
+
+static t_class *bl_tri_class;
+
+typedef struct _bl_tri{
+    t_object    x_obj;
+    t_osc       x_osc;
+    t_blep      x_blep;
+    t_float     x_freq;
+    t_inlet    *x_inlet_sync;
+    t_inlet    *x_inlet_phase;
+    t_outlet   *x_outlet;
+}t_bl_tri;
+
+static t_blep_shape bl_tri_shape = {3, {0, 0.25, 0.75}, {0, 1, -1}, {4, -4, 4}};
+
+static t_int *bl_tri_perform(t_int *w){
+    t_bl_tri *x = (t_bl_tri *)(w[1]);
+    int n = (int)(w[2]);
+    t_float *freq = (t_float *)(w[3]);
+    t_float *sync = (t_float *)(w[4]);
+    t_float *offset = (t_float *)(w[5]);
+    t_float *out = (t_float *)(w[6]);
+    double phase[BLEP_CHUNK], step[BLEP_CHUNK];
+    while(n > 0){
+        int m = n < BLEP_CHUNK ? n : BLEP_CHUNK;
+        osc_phase(&x->x_osc, freq, sync, offset, phase, step, m);
+        blep_shape(&x->x_blep, &bl_tri_shape, 0, phase, step, m);
+        blep_read(&x->x_blep, out, m);
+        freq += m, sync += m, offset += m, out += m, n -= m;
+    }
+    return(w + 7);
+}
+
+static void bl_tri_dsp(t_bl_tri *x, t_signal **sp){
+    x->x_osc.o_sr = sp[0]->s_sr;
+    dsp_add(bl_tri_perform, 6, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec,
+        sp[3]->s_vec);
+}
+
+static void *bl_tri_free(t_bl_tri *x){
+    inlet_free(x->x_inlet_sync);
+    inlet_free(x->x_inlet_phase);
+    outlet_free(x->x_outlet);
+    return(void *)x;
+}
+
+static void *bl_tri_new(t_floatarg f1, t_floatarg f2){
+    t_bl_tri *x = (t_bl_tri *)pd_new(bl_tri_class);
+    t_float init_phase = f2 < 0 || f2 >= 1 ? 0 : f2;
+    osc_init(&x->x_osc, init_phase);
+    x->x_osc.o_last_phase_offset = init_phase;
+    blep_init(&x->x_blep, init_phase);
+    x->x_freq = f1;
+    x->x_inlet_sync = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_sync, 0);
+    x->x_inlet_phase = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_phase, init_phase);
+    x->x_outlet = outlet_new(&x->x_obj, &s_signal);
+    return(x);
+}
+
+void setup_bl0x2etri_tilde(void){
+    bl_tri_class = class_new(gensym("bl.tri~"), (t_newmethod)bl_tri_new,
+        (t_method)bl_tri_free, sizeof(t_bl_tri), CLASS_DEFAULT, A_DEFFLOAT, A_DEFFLOAT, 0);
+    CLASS_MAINSIGNALIN(bl_tri_class, t_bl_tri, x_freq);
+    class_addmethod(bl_tri_class, (t_method)bl_tri_dsp, gensym("dsp"), A_CANT, 0);
+    blep_setup();
+}
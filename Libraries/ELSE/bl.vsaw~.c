@@ -0,0 +1,102 @@
+// band-limited vsaw~, replaces the bl.vsaw~ abstraction (which ran vsaw~ oversampled by 16)
+
+#include "m_pd.h"
+#include "shared/osc.h"
+#include "shared/blep.h"
+
+static t_class *bl_vsaw_class;
+
+typedef struct _bl_vsaw{
+    t_object    x_obj;
+    t_osc       x_osc;
+    t_blep      x_blep;
+    t_float     x_freq;
+    t_inlet    *x_inlet_width;
+    t_inlet    *x_inlet_sync;
+    t_inlet    *x_inlet_phase;
+    t_outlet   *x_outlet;
+}t_bl_vsaw;
+
+// falls from 1 to -1 until the phase gets to 1 - width, then rises back. A width close to 0 or 1
+// makes one of the slopes steeper than the corrections can take, so it's a plain saw from there
+static void bl_vsaw_shape(t_blep_shape *s, double width){
+    s->s_start[0] = 0;
+    if(width < 0.001 || width > 0.999){
+        s->s_n = 1;
+        s->s_value[0] = width < 0.5 ? 1 : -1;
+        s->s_slope[0] = width < 0.5 ? -2 : 2;
+    }
+    else{
+        s->s_n = 2;
+        s->s_value[0] = 1;
+        s->s_slope[0] = -2 / (1 - width);
+        s->s_start[1] = 1 - width;
+        s->s_value[1] = -1;
+        s->s_slope[1] = 2 / width;
+    }
+}
+
+static t_int *bl_vsaw_perform(t_int *w){
+    t_bl_vsaw *x = (t_bl_vsaw *)(w[1]);
+    int n = (int)(w[2]);
+    t_float *freq = (t_float *)(w[3]);
+    t_float *width = (t_float *)(w[4]);
+    t_float *sync = (t_float *)(w[5]);
+    t_float *offset = (t_float *)(w[6]);
+    t_float *out = (t_float *)(w[7]);
+    double phase[BLEP_CHUNK], step[BLEP_CHUNK];
+    t_blep_shape shape[BLEP_CHUNK];
+    while(n > 0){
+        int i, m = n < BLEP_CHUNK ? n : BLEP_CHUNK;
+        osc_phase(&x->x_osc, freq, sync, offset, phase, step, m);
+        for(i = 0; i < m; i++)
+            bl_vsaw_shape(&shape[i], width[i]);
+        blep_shape(&x->x_blep, shape, 1, phase, step, m);
+        blep_read(&x->x_blep, out, m);
+        freq += m, width += m, sync += m, offset += m, out += m, n -= m;
+    }
+    return(w + 8);
+}
+
+static void bl_vsaw_dsp(t_bl_vsaw *x, t_signal **sp){
+    x->x_osc.o_sr = sp[0]->s_sr;
+    dsp_add(bl_vsaw_perform, 7, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec,
+        sp[3]->s_vec, sp[4]->s_vec);
+}
+
+static void *bl_vsaw_free(t_bl_vsaw *x){
+    inlet_free(x->x_inlet_width);
+    inlet_free(x->x_inlet_sync);
+    inlet_free(x->x_inlet_phase);
+    outlet_free(x->x_outlet);
+    return(void *)x;
+}
+
+static void *bl_vsaw_new(t_symbol *s, int ac, t_atom *av){
+    t_bl_vsaw *x = (t_bl_vsaw *)pd_new(bl_vsaw_class);
+    t_float init_freq = atom_getfloatarg(0, ac, av);
+    t_float init_width = atom_getfloatarg(1, ac, av);
+    t_float init_phase = atom_getfloatarg(2, ac, av);
+    init_width = init_width < 0 ? 0 : init_width > 1 ? 1 : init_width;
+    init_phase = init_phase < 0 || init_phase >= 1 ? 0 : init_phase;
+    osc_init(&x->x_osc, init_phase);
+    x->x_osc.o_last_phase_offset = init_phase;
+    blep_init(&x->x_blep, init_phase);
+    x->x_freq = init_freq;
+    x->x_inlet_width = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_width, init_width);
+    x->x_inlet_sync = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_sync, 0);
+    x->x_inlet_phase = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_phase, init_phase);
+    x->x_outlet = outlet_new(&x->x_obj, &s_signal);
+    return(x);
+}
+
+void setup_bl0x2evsaw_tilde(void){
+    bl_vsaw_class = class_new(gensym("bl.vsaw~"), (t_newmethod)bl_vsaw_new,
+        (t_method)bl_vsaw_free, sizeof(t_bl_vsaw), CLASS_DEFAULT, A_GIMME, 0);
+    CLASS_MAINSIGNALIN(bl_vsaw_class, t_bl_vsaw, x_freq);
+    class_addmethod(bl_vsaw_class, (t_method)bl_vsaw_dsp, gensym("dsp"), A_CANT, 0);
+    blep_setup();
+}
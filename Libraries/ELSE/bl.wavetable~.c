@@ -0,0 +1,140 @@
+// band-limited wavetable~, replaces the bl.wavetable~ abstraction (which ran wavetable~
+// oversampled by 16 with a lowpass), it does the same in a loop
+
+#include "m_pd.h"
+#include "shared/buffer.h"
+#include "shared/osc.h"
+#include "shared/blep.h"
+#include <math.h>
+
+static t_class *bl_wavetable_class;
+
+typedef struct _bl_wavetable{
+    t_object    x_obj;
+    t_buffer   *x_buffer;
+    t_osc       x_osc;
+    t_blep      x_blep;
+    t_float     x_freq;
+    t_inlet    *x_inlet_sync;
+    t_inlet    *x_inlet_phase;
+    t_outlet   *x_outlet;
+}t_bl_wavetable;
+
+static void bl_wavetable_set(t_bl_wavetable *x, t_symbol *s){
+    buffer_setarray(x->x_buffer, s);
+}
+
+// lagrange interpolation, like wavetable~
+static double bl_wavetable_read(t_word *vector, int size, double phase){
+    double xpos = phase * (double)size;
+    int ndx = (int)xpos;
+    double frac = xpos - ndx;
+    if(ndx >= size)
+        ndx = 0;
+    int ndxm1 = ndx - 1, ndx1 = ndx + 1;
+    if(ndxm1 < 0)
+        ndxm1 = size - 1;
+    if(ndx1 >= size)
+        ndx1 = 0;
+    int ndx2 = ndx1 + 1;
+    if(ndx2 >= size)
+        ndx2 = 0;
+    double a = (double)vector[ndxm1].w_float;
+    double b = (double)vector[ndx].w_float;
+    double c = (double)vector[ndx1].w_float;
+    double d = (double)vector[ndx2].w_float;
+    double cmb = c - b;
+    return(b + frac * (cmb - (1. - frac) / 6. * ((d - a - 3.0 * cmb) * frac + d + 2.0 * a - 3.0 * b)));
+}
+
+static t_int *bl_wavetable_perform(t_int *w){
+    t_bl_wavetable *x = (t_bl_wavetable *)(w[1]);
+    int n = (int)(w[2]);
+    t_float *freq = (t_float *)(w[3]);
+    t_float *sync = (t_float *)(w[4]);
+    t_float *offset = (t_float *)(w[5]);
+    t_float *out = (t_float *)(w[6]);
+    t_word *vector = x->x_buffer->c_vectors[0];
+    int size = x->x_buffer->c_npts;
+    int playable = x->x_buffer->c_playable && vector && size > 0;
+    double phase[BLEP_CHUNK], step[BLEP_CHUNK], over[BLEP_OVERSAMPLE];
+    while(n > 0){
+        int i, r, m = n < BLEP_CHUNK ? n : BLEP_CHUNK;
+        if(playable){ // otherwise the phase holds and what's left of the kernel plays out
+            osc_phase(&x->x_osc, freq, sync, offset, phase, step, m);
+            for(i = 0; i < m; i++){
+                for(r = 0; r < BLEP_OVERSAMPLE; r++){ // back from this sample's phase
+                    double p = phase[i] - x->x_blep.b_step * r / BLEP_OVERSAMPLE;
+                    over[r] = bl_wavetable_read(vector, size, p - floor(p));
+                }
+                blep_downsample(&x->x_blep, i, over);
+                x->x_blep.b_step = step[i];
+            }
+        }
+        blep_read(&x->x_blep, out, m);
+        freq += m, sync += m, offset += m, out += m, n -= m;
+    }
+    return(w + 7);
+}
+
+static void bl_wavetable_dsp(t_bl_wavetable *x, t_signal **sp){
+    buffer_checkdsp(x->x_buffer);
+    x->x_osc.o_sr = sp[0]->s_sr;
+    dsp_add(bl_wavetable_perform, 6, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec,
+        sp[3]->s_vec);
+}
+
+static void *bl_wavetable_free(t_bl_wavetable *x){
+    buffer_free(x->x_buffer);
+    inlet_free(x->x_inlet_sync);
+    inlet_free(x->x_inlet_phase);
+    outlet_free(x->x_outlet);
+    return(void *)x;
+}
+
+static void *bl_wavetable_new(t_symbol *s, int ac, t_atom *av){
+    t_bl_wavetable *x = (t_bl_wavetable *)pd_new(bl_wavetable_class);
+    t_symbol *name = NULL;
+    int nameset = 0, floatarg = 0;
+    t_float phaseoff = 0;
+    x->x_freq = 0.;
+    while(ac){
+        if(av->a_type == A_SYMBOL){
+            if(!floatarg && !nameset){
+                name = atom_getsymbolarg(0, ac, av);
+                nameset = 1, ac--, av++;
+            }
+            else
+                goto errstate;
+        }
+        else{
+            if(floatarg == 0)
+                x->x_freq = atom_getfloatarg(0, ac, av);
+            else if(floatarg == 1)
+                phaseoff = atom_getfloatarg(0, ac, av);
+            floatarg++, ac--, av++;
+        }
+    }
+    phaseoff = phaseoff < 0 || phaseoff > 1 ? 0 : phaseoff;
+    osc_init(&x->x_osc, phaseoff);
+    x->x_osc.o_last_phase_offset = phaseoff;
+    blep_init(&x->x_blep, phaseoff);
+    x->x_inlet_sync = inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+    x->x_inlet_phase = inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+    pd_float((t_pd *)x->x_inlet_phase, phaseoff);
+    x->x_outlet = outlet_new(&x->x_obj, gensym("signal"));
+    x->x_buffer = buffer_init((t_class *)x, name, 1, 0);
+    return(x);
+errstate:
+    pd_error(x, "[bl.wavetable~]: improper args");
+    return(NULL);
+}
+
+void setup_bl0x2ewavetable_tilde(void){
+    bl_wavetable_class = class_new(gensym("bl.wavetable~"), (t_newmethod)bl_wavetable_new,
+        (t_method)bl_wavetable_free, sizeof(t_bl_wavetable), CLASS_DEFAULT, A_GIMME, 0);
+    CLASS_MAINSIGNALIN(bl_wavetable_class, t_bl_wavetable, x_freq);
+    class_addmethod(bl_wavetable_class, (t_method)bl_wavetable_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(bl_wavetable_class, (t_method)bl_wavetable_set, gensym("set"), A_SYMBOL, 0);
+    blep_setup();
+}
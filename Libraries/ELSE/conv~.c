@@ -0,0 +1,659 @@
+// partitioned convolution, replaces the conv~ abstraction
+
+#include "m_pd.h"
+#include "d_soundfile.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// [conv~ <size> <file or array>] convolves its input with an impulse response, split in
+// partitions of <size> samples that are convolved with FFTs. The output is delayed by <size>,
+// like the abstraction was. With -zero there's no delay: the first CONV_HEAD samples of the
+// response are convolved directly and the partitions start small and grow up to <size>, so
+// long responses stay cheap. With -thread the larger partitions, whose results are needed
+// later, are computed in a background thread instead of in a burst in the audio thread.
+
+#define CONV_HEAD       64      // taps convolved directly, and the smallest partition
+#define CONV_PARTS      8       // partitions of each size before the next, 4 times larger one
+#define CONV_MAXSIZE    65536
+#define CONV_READBYTES  65536
+
+#define CONV_IDLE       0
+#define CONV_QUEUED     1
+#define CONV_BUSY       2
+#define CONV_DONE       3
+
+static t_class *conv_class;
+
+// real fft of size n with a complex one of size n/2
+typedef struct _convfft{
+    int       f_n;
+    int      *f_rev;        // bit reversal for n/2
+    t_float  *f_cos;        // twiddles for n/2
+    t_float  *f_sin;
+    t_float  *f_wcos;       // twiddles that split the halves, for n
+    t_float  *f_wsin;
+}t_convfft;
+
+// partitions of the same size, convolved uniformly with a frequency domain delay line
+typedef struct _convlevel{
+    int         l_size;     // partition size, the fft size is twice that
+    int         l_offset;   // where the first partition starts in the response, latency included
+    int         l_nparts;
+    int         l_nbins;    // size + 1
+    t_convfft   l_fft;
+    t_float    *l_hre;      // spectra of the partitions
+    t_float    *l_him;
+    t_float    *l_xre;      // spectra of the last l_nparts input windows
+    t_float    *l_xim;
+    int         l_pos;      // latest window in the delay line
+    t_float    *l_yre;      // output spectrum
+    t_float    *l_yim;
+    t_float    *l_work;     // 2 * size samples, the fft's input and output
+    t_float    *l_in;       // 2 * size input samples, copied for the background thread
+    t_float    *l_out;      // size output samples
+    unsigned    l_target;   // time where l_out goes in the output
+    int         l_thread;   // computed in the background thread
+    int         l_state;    // of the background job
+}t_convlevel;
+
+typedef struct _convengine{
+    int          e_head;        // taps convolved directly
+    t_float     *e_headir;      // reversed
+    t_float     *e_headbuf;     // inputs for the direct taps
+    int          e_step;        // smallest partition, all partitions start on multiples of it
+    int          e_nlevels;
+    t_convlevel *e_levels;
+    t_float     *e_in;          // input history
+    unsigned     e_inmask;
+    t_float     *e_out;         // output accumulated ahead of time
+    unsigned     e_outmask;
+    unsigned     e_time;
+}t_convengine;
+
+typedef struct _conv{
+    t_object        x_obj;
+    t_float         x_f;
+    t_canvas       *x_canvas;
+    t_symbol       *x_pending;      // an array that may be created after the object
+    t_convengine   *x_engine;
+    t_float        *x_ir;           // kept to rebuild the partitions with another size
+    int             x_irsize;
+    int             x_size;
+    int             x_zero;
+    int             x_threaded;
+    int             x_quit;
+    pthread_t       x_thread;
+    pthread_mutex_t x_mutex;
+    pthread_cond_t  x_cond;
+    t_outlet       *x_outlet;
+}t_conv;
+
+///////////////////////////////////////// fft /////////////////////////////////////////
+
+static void convfft_init(t_convfft *f, int n){
+    int i, j, bits = 0, half = n / 2;
+    f->f_n = n;
+    f->f_rev = (int *)getbytes(half * sizeof(int));
+    f->f_cos = (t_float *)getbytes(half * sizeof(t_float));
+    f->f_sin = (t_float *)getbytes(half * sizeof(t_float));
+    f->f_wcos = (t_float *)getbytes((half + 1) * sizeof(t_float));
+    f->f_wsin = (t_float *)getbytes((half + 1) * sizeof(t_float));
+    while((1 << bits) < half)
+        bits++;
+    for(i = 0; i < half; i++){
+        int r = 0;
+        for(j = 0; j < bits; j++)
+            r |= ((i >> j) & 1) << (bits - 1 - j);
+        f->f_rev[i] = r;
+        f->f_cos[i] = cos(2 * M_PI * i / half);
+        f->f_sin[i] = sin(2 * M_PI * i / half);
+    }
+    for(i = 0; i <= half; i++){
+        f->f_wcos[i] = cos(2 * M_PI * i / n);
+        f->f_wsin[i] = sin(2 * M_PI * i / n);
+    }
+}
+
+static void convfft_free(t_convfft *f){
+    int half = f->f_n / 2;
+    freebytes(f->f_rev, half * sizeof(int));
+    freebytes(f->f_cos, half * sizeof(t_float));
+    freebytes(f->f_sin, half * sizeof(t_float));
+    freebytes(f->f_wcos, (half + 1) * sizeof(t_float));
+    freebytes(f->f_wsin, (half + 1) * sizeof(t_float));
+}
+
+// in place radix 2 complex fft of size n/2, not normalized
+static void convfft_complex(t_convfft *f, t_float *re, t_float *im, int inverse){
+    int n = f->f_n / 2, i, j, len;
+    for(i = 0; i < n; i++){
+        j = f->f_rev[i];
+        if(j > i){
+            t_float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for(len = 2; len <= n; len <<= 1){
+        int half = len >> 1, stride = n / len;
+        for(i = 0; i < n; i += len){
+            for(j = 0; j < half; j++){
+                t_float wr = f->f_cos[j * stride];
+                t_float wi = inverse ? f->f_sin[j * stride] : -f->f_sin[j * stride];
+                int a = i + j, b = a + half;
+                t_float tr = re[b] * wr - im[b] * wi;
+                t_float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+// n real samples from 'buf' to n/2 + 1 bins, 'buf' is used as work space
+static void convfft_forward(t_convfft *f, t_float *buf, t_float *re, t_float *im){
+    int k, half = f->f_n / 2;
+    for(k = 0; k < half; k++){ // even samples as the real part, odd ones as the imaginary
+        re[k] = buf[2 * k];
+        im[k] = buf[2 * k + 1];
+    }
+    convfft_complex(f, re, im, 0);
+    re[half] = re[0];
+    im[half] = im[0];
+    for(k = 0; k <= half / 2; k++){ // split the spectra of the even and odd samples
+        t_float ar = re[k], ai = im[k], br = re[half - k], bi = -im[half - k];
+        t_float er = (ar + br) * 0.5, ei = (ai + bi) * 0.5;
+        t_float odr = (ai - bi) * 0.5, odi = (br - ar) * 0.5;
+        t_float wr = f->f_wcos[k], wi = -f->f_wsin[k];
+        re[k] = er + odr * wr - odi * wi;
+        im[k] = ei + odr * wi + odi * wr;
+        if(k != half - k){ // the mirrored bin, from the conjugates
+            t_float er2 = er, ei2 = -ei, odr2 = odr, odi2 = -odi;
+            t_float wr2 = f->f_wcos[half - k], wi2 = -f->f_wsin[half - k];
+            re[half - k] = er2 + odr2 * wr2 - odi2 * wi2;
+            im[half - k] = ei2 + odr2 * wi2 + odi2 * wr2;
+        }
+    }
+}
+
+// n/2 + 1 bins to n real samples in 'buf', scaled by n/2, 're' and 'im' are overwritten
+static void convfft_inverse(t_convfft *f, t_float *re, t_float *im, t_float *buf){
+    int k, half = f->f_n / 2;
+    for(k = 0; k <= half / 2; k++){
+        t_float ar = re[k], ai = im[k], br = re[half - k], bi = -im[half - k];
+        t_float er = ar + br, ei = ai + bi; // twice the even spectrum
+        t_float dr = ar - br, di = ai - bi; // twice the odd one, times the twiddle
+        t_float wr = f->f_wcos[k], wi = f->f_wsin[k];
+        t_float odr = dr * wr - di * wi, odi = dr * wi + di * wr;
+        re[k] = er - odi; // even + i * odd
+        im[k] = ei + odr;
+        if(k != half - k){
+            t_float wr2 = f->f_wcos[half - k], wi2 = f->f_wsin[half - k];
+            t_float dr2 = -dr, di2 = di; // for the mirrored bin
+            t_float odr2 = dr2 * wr2 - di2 * wi2, odi2 = dr2 * wi2 + di2 * wr2;
+            re[half - k] = er - odi2;
+            im[half - k] = -ei + odr2;
+        }
+    }
+    convfft_complex(f, re, im, 1);
+    for(k = 0; k < half; k++){
+        buf[2 * k] = re[k] * 0.5;
+        buf[2 * k + 1] = im[k] * 0.5;
+    }
+}
+
+/////////////////////////////////////// engine ///////////////////////////////////////
+
+static void conv_level_init(t_convlevel *l, t_float *ir, int irsize, int latency, int thread){
+    int j, k, size = l->l_size, nbins = size + 1;
+    l->l_nbins = nbins;
+    convfft_init(&l->l_fft, 2 * size);
+    l->l_hre = (t_float *)getbytes(l->l_nparts * nbins * sizeof(t_float));
+    l->l_him = (t_float *)getbytes(l->l_nparts * nbins * sizeof(t_float));
+    l->l_xre = (t_float *)getbytes(l->l_nparts * nbins * sizeof(t_float));
+    l->l_xim = (t_float *)getbytes(l->l_nparts * nbins * sizeof(t_float));
+    l->l_yre = (t_float *)getbytes(nbins * sizeof(t_float));
+    l->l_yim = (t_float *)getbytes(nbins * sizeof(t_float));
+    l->l_work = (t_float *)getbytes(2 * size * sizeof(t_float));
+    l->l_in = (t_float *)getbytes(2 * size * sizeof(t_float));
+    l->l_out = (t_float *)getbytes(size * sizeof(t_float));
+    l->l_pos = 0;
+    l->l_thread = thread && l->l_offset >= 2 * size; // a whole partition of time to compute it
+    l->l_state = CONV_IDLE;
+    for(j = 0; j < l->l_nparts; j++){ // zero padded partitions, scaled for the inverse fft
+        int start = l->l_offset + j * size - latency;
+        for(k = 0; k < 2 * size; k++){
+            int i = start + k;
+            l->l_work[k] = k < size && i >= 0 && i < irsize ? ir[i] / size : 0;
+        }
+        convfft_forward(&l->l_fft, l->l_work, l->l_hre + j * nbins, l->l_him + j * nbins);
+    }
+}
+
+static void conv_level_free(t_convlevel *l){
+    int size = l->l_size, nbins = l->l_nbins;
+    convfft_free(&l->l_fft);
+    freebytes(l->l_hre, l->l_nparts * nbins * sizeof(t_float));
+    freebytes(l->l_him, l->l_nparts * nbins * sizeof(t_float));
+    freebytes(l->l_xre, l->l_nparts * nbins * sizeof(t_float));
+    freebytes(l->l_xim, l->l_nparts * nbins * sizeof(t_float));
+    freebytes(l->l_yre, nbins * sizeof(t_float));
+    freebytes(l->l_yim, nbins * sizeof(t_float));
+    freebytes(l->l_work, 2 * size * sizeof(t_float));
+    freebytes(l->l_in, 2 * size * sizeof(t_float));
+    freebytes(l->l_out, size * sizeof(t_float));
+}
+
+// convolves the window of the last 2 * size inputs, the result is the last 'size' outputs
+static void conv_level_run(t_convlevel *l, t_float *in){
+    int j, k, nbins = l->l_nbins;
+    t_float *xre = l->l_xre + l->l_pos * nbins, *xim = l->l_xim + l->l_pos * nbins;
+    t_float *yre = l->l_yre, *yim = l->l_yim;
+    memcpy(l->l_work, in, 2 * l->l_size * sizeof(t_float));
+    convfft_forward(&l->l_fft, l->l_work, xre, xim);
+    memset(yre, 0, nbins * sizeof(t_float));
+    memset(yim, 0, nbins * sizeof(t_float));
+    for(j = 0; j < l->l_nparts; j++){ // the newest window with the first partition and so on
+        int slot = l->l_pos - j < 0 ? l->l_pos - j + l->l_nparts : l->l_pos - j;
+        t_float *ar = l->l_xre + slot * nbins, *ai = l->l_xim + slot * nbins;
+        t_float *br = l->l_hre + j * nbins, *bi = l->l_him + j * nbins;
+        for(k = 0; k < nbins; k++){
+            yre[k] += ar[k] * br[k] - ai[k] * bi[k];
+            yim[k] += ar[k] * bi[k] + ai[k] * br[k];
+        }
+    }
+    convfft_inverse(&l->l_fft, yre, yim, l->l_work);
+    memcpy(l->l_out, l->l_work + l->l_size, l->l_size * sizeof(t_float));
+    if(++l->l_pos == l->l_nparts)
+        l->l_pos = 0;
+}
+
+static void conv_engine_free(t_convengine *e){
+    int i;
+    if(!e)
+        return;
+    for(i = 0; i < e->e_nlevels; i++)
+        conv_level_free(&e->e_levels[i]);
+    freebytes(e->e_levels, e->e_nlevels * sizeof(t_convlevel));
+    freebytes(e->e_headir, e->e_head * sizeof(t_float));
+    freebytes(e->e_headbuf, (e->e_head + e->e_step) * sizeof(t_float));
+    freebytes(e->e_in, (e->e_inmask + 1) * sizeof(t_float));
+    freebytes(e->e_out, (e->e_outmask + 1) * sizeof(t_float));
+    freebytes(e, sizeof(t_convengine));
+}
+
+static unsigned conv_pow2(unsigned n){
+    unsigned p = 1;
+    while(p < n)
+        p <<= 1;
+    return(p);
+}
+
+static t_convengine *conv_engine_new(t_float *ir, int irsize, int size, int zero, int thread){
+    t_convengine *e;
+    int i, offset, latency = zero ? 0 : size, length = irsize + latency, maxlevels = 32;
+    t_convlevel levels[32];
+    int nlevels = 0, partsize = zero ? CONV_HEAD : size;
+    if(irsize <= 0)
+        return(NULL);
+    e = (t_convengine *)getbytes(sizeof(t_convengine));
+    e->e_head = zero ? CONV_HEAD : 0;
+    offset = zero ? CONV_HEAD : size; // the latency hides the first partition's delay
+    while(offset < length && nlevels < maxlevels){
+        t_convlevel *l = &levels[nlevels++];
+        int remaining = (length - offset + partsize - 1) / partsize;
+        memset(l, 0, sizeof(*l));
+        l->l_size = partsize;
+        l->l_offset = offset;
+        l->l_nparts = partsize < size && remaining > CONV_PARTS ? CONV_PARTS : remaining;
+        offset += l->l_nparts * partsize;
+        if(partsize < size) // the next partitions start late enough to hide a 4x larger delay
+            partsize = partsize * 4 < size ? partsize * 4 : size;
+    }
+    e->e_nlevels = nlevels;
+    e->e_levels = (t_convlevel *)getbytes(nlevels * sizeof(t_convlevel));
+    for(i = 0; i < nlevels; i++){
+        e->e_levels[i] = levels[i];
+        conv_level_init(&e->e_levels[i], ir, irsize, latency, thread);
+    }
+    e->e_step = zero ? CONV_HEAD : size;
+    e->e_headir = (t_float *)getbytes(e->e_head * sizeof(t_float));
+    for(i = 0; i < e->e_head; i++)
+        e->e_headir[e->e_head - 1 - i] = i < irsize ? ir[i] : 0;
+    e->e_headbuf = (t_float *)getbytes((e->e_head + e->e_step) * sizeof(t_float));
+    e->e_inmask = conv_pow2(2 * size > e->e_head + e->e_step ? 2 * size : e->e_head + e->e_step) - 1;
+    e->e_in = (t_float *)getbytes((e->e_inmask + 1) * sizeof(t_float));
+    e->e_outmask = conv_pow2(offset + size) - 1;
+    e->e_out = (t_float *)getbytes((e->e_outmask + 1) * sizeof(t_float));
+    e->e_time = 0;
+    return(e);
+}
+
+static void conv_mix(t_convengine *e, t_convlevel *l, unsigned target){
+    int i;
+    for(i = 0; i < l->l_size; i++)
+        e->e_out[(target + i) & e->e_outmask] += l->l_out[i];
+}
+
+/////////////////////////////////////// thread ///////////////////////////////////////
+
+static void *conv_thread(void *arg){
+    t_conv *x = (t_conv *)arg;
+    pthread_mutex_lock(&x->x_mutex);
+    while(!x->x_quit){
+        t_convlevel *job = NULL;
+        int i;
+        if(x->x_engine){ // the smallest partitions are due first
+            for(i = 0; i < x->x_engine->e_nlevels; i++){
+                t_convlevel *l = &x->x_engine->e_levels[i];
+                if(l->l_state == CONV_QUEUED && (!job || l->l_size < job->l_size))
+                    job = l;
+            }
+        }
+        if(!job){
+            pthread_cond_wait(&x->x_cond, &x->x_mutex);
+            continue;
+        }
+        job->l_state = CONV_BUSY;
+        pthread_mutex_unlock(&x->x_mutex);
+        conv_level_run(job, job->l_in);
+        pthread_mutex_lock(&x->x_mutex);
+        job->l_state = CONV_DONE;
+        pthread_cond_broadcast(&x->x_cond);
+    }
+    pthread_mutex_unlock(&x->x_mutex);
+    return(NULL);
+}
+
+// mixes the finished background results, waits for the ones due before 'time'
+static void conv_collect(t_conv *x, t_convengine *e, unsigned time){
+    int i;
+    pthread_mutex_lock(&x->x_mutex);
+    for(i = 0; i < e->e_nlevels; i++){
+        t_convlevel *l = &e->e_levels[i];
+        if(!l->l_thread || l->l_state == CONV_IDLE)
+            continue;
+        while(l->l_state != CONV_DONE && (int)(l->l_target - time) < 0)
+            pthread_cond_wait(&x->x_cond, &x->x_mutex);
+        if(l->l_state == CONV_DONE){
+            conv_mix(e, l, l->l_target);
+            l->l_state = CONV_IDLE;
+        }
+    }
+    pthread_mutex_unlock(&x->x_mutex);
+}
+
+static void conv_queue(t_conv *x, t_convengine *e, t_convlevel *l, unsigned target){
+    int i;
+    pthread_mutex_lock(&x->x_mutex);
+    while(l->l_state == CONV_QUEUED || l->l_state == CONV_BUSY) // still on the last window
+        pthread_cond_wait(&x->x_cond, &x->x_mutex);
+    if(l->l_state == CONV_DONE)
+        conv_mix(e, l, l->l_target);
+    for(i = 0; i < 2 * l->l_size; i++)
+        l->l_in[i] = e->e_in[(e->e_time - 2 * l->l_size + i) & e->e_inmask];
+    l->l_target = target;
+    l->l_state = CONV_QUEUED;
+    pthread_cond_broadcast(&x->x_cond);
+    pthread_mutex_unlock(&x->x_mutex);
+}
+
+// stops using the old engine once the background thread is done with it
+static void conv_setengine(t_conv *x, t_convengine *e){
+    t_convengine *old = x->x_engine;
+    if(x->x_threaded){
+        int i, busy = 1;
+        pthread_mutex_lock(&x->x_mutex);
+        while(busy){
+            busy = 0;
+            for(i = 0; old && i < old->e_nlevels; i++)
+                busy = busy || old->e_levels[i].l_state == CONV_BUSY;
+            if(busy)
+                pthread_cond_wait(&x->x_cond, &x->x_mutex);
+        }
+        x->x_engine = e;
+        pthread_mutex_unlock(&x->x_mutex);
+    }
+    else
+        x->x_engine = e;
+    conv_engine_free(old);
+}
+
+/////////////////////////////////////// object ///////////////////////////////////////
+
+// the levels due at 'time', which is a multiple of the smallest partition
+static void conv_partitions(t_conv *x, t_convengine *e){
+    int i;
+    for(i = 0; i < e->e_nlevels; i++){
+        t_convlevel *l = &e->e_levels[i];
+        unsigned size = l->l_size, target = e->e_time - size + l->l_offset;
+        if(e->e_time & (size - 1))
+            continue;
+        if(l->l_thread)
+            conv_queue(x, e, l, target);
+        else{
+            int k;
+            for(k = 0; k < 2 * l->l_size; k++)
+                l->l_in[k] = e->e_in[(e->e_time - 2 * size + k) & e->e_inmask];
+            conv_level_run(l, l->l_in);
+            conv_mix(e, l, target);
+        }
+    }
+}
+
+static t_int *conv_perform(t_int *w){
+    t_conv *x = (t_conv *)(w[1]);
+    t_float *in = (t_float *)(w[2]);
+    t_float *out = (t_float *)(w[3]);
+    int n = (int)(w[4]);
+    t_convengine *e = x->x_engine;
+    if(!e){
+        while(n--)
+            *out++ = 0;
+        return(w + 5);
+    }
+    while(n > 0){ // in segments that end where partitions are due
+        unsigned time = e->e_time;
+        int i, k, m = e->e_step - (time & (e->e_step - 1)), head = e->e_head;
+        if(m > n)
+            m = n;
+        for(i = 0; i < m; i++) // read before writing, 'out' may be 'in'
+            e->e_in[(time + i) & e->e_inmask] = in[i];
+        if(x->x_threaded)
+            conv_collect(x, e, time + m);
+        for(i = 0; i < head - 1 + m; i++)
+            e->e_headbuf[i] = e->e_in[(time - head + 1 + i) & e->e_inmask];
+        for(i = 0; i < m; i++){
+            t_float sum = e->e_out[(time + i) & e->e_outmask];
+            t_float *buf = e->e_headbuf + i;
+            for(k = 0; k < head; k++)
+                sum += e->e_headir[k] * buf[k];
+            e->e_out[(time + i) & e->e_outmask] = 0;
+            out[i] = sum;
+        }
+        e->e_time = time + m;
+        if(!(e->e_time & (e->e_step - 1)))
+            conv_partitions(x, e);
+        in += m;
+        out += m;
+        n -= m;
+    }
+    return(w + 5);
+}
+
+static void conv_set(t_conv *x, t_symbol *s);
+
+static void conv_dsp(t_conv *x, t_signal **sp){
+    if(x->x_pending){ // the creation argument wasn't a file or an existing array
+        if(pd_findbyclass(x->x_pending, garray_class))
+            conv_set(x, x->x_pending);
+        else
+            pd_error(x, "[conv~]: no array or file named '%s'", x->x_pending->s_name);
+        x->x_pending = NULL;
+    }
+    dsp_add(conv_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, (t_int)sp[0]->s_n);
+}
+
+static void conv_update(t_conv *x){
+    conv_setengine(x, conv_engine_new(x->x_ir, x->x_irsize, x->x_size, x->x_zero, x->x_threaded));
+}
+
+static void conv_setir(t_conv *x, t_float *ir, int size){
+    if(x->x_ir)
+        freebytes(x->x_ir, x->x_irsize * sizeof(t_float));
+    x->x_ir = ir;
+    x->x_irsize = size;
+    conv_update(x);
+}
+
+static void conv_set(t_conv *x, t_symbol *s){
+    t_garray *a = (t_garray *)pd_findbyclass(s, garray_class);
+    t_word *vec;
+    t_float *ir;
+    int i, npts;
+    if(!a){
+        pd_error(x, "[conv~]: no array named '%s'", s->s_name);
+        return;
+    }
+    if(!garray_getfloatwords(a, &npts, &vec)){
+        pd_error(x, "[conv~]: bad template for '%s'", s->s_name);
+        return;
+    }
+    ir = (t_float *)getbytes(npts * sizeof(t_float));
+    for(i = 0; i < npts; i++)
+        ir[i] = vec[i].w_float;
+    conv_setir(x, ir, npts);
+}
+
+// the first channel of a sound file
+static int conv_readfile(t_conv *x, t_symbol *s){
+    t_soundfile sf;
+    unsigned char *buf;
+    t_float *ir = NULL;
+    size_t left, size = 0, maxsize = 0;
+    int fd = open_soundfile_via_canvas(x->x_canvas, s->s_name, &sf, 0);
+    if(fd < 0)
+        return(0);
+    buf = (unsigned char *)getbytes(CONV_READBYTES);
+    left = sf.sf_bytelimit;
+    while(left >= (size_t)sf.sf_bytesperframe){
+        size_t want = left < CONV_READBYTES ? left : CONV_READBYTES;
+        int got = (int)read(fd, buf, (unsigned)(want - want % sf.sf_bytesperframe));
+        size_t frames;
+        if(got <= 0)
+            break;
+        frames = got / sf.sf_bytesperframe;
+        if(size + frames > maxsize){
+            size_t newsize = (size + frames) * 2;
+            ir = (t_float *)resizebytes(ir, maxsize * sizeof(t_float), newsize * sizeof(t_float));
+            maxsize = newsize;
+        }
+        soundfile_xferin_float(&sf, 1, &ir, size, buf, frames);
+        size += frames;
+        left -= got;
+    }
+    sys_close(fd);
+    freebytes(buf, CONV_READBYTES);
+    if(!size)
+        return(0);
+    ir = (t_float *)resizebytes(ir, maxsize * sizeof(t_float), size * sizeof(t_float));
+    conv_setir(x, ir, (int)size);
+    return(1);
+}
+
+static void conv_load(t_conv *x, t_symbol *s){
+    if(!conv_readfile(x, s))
+        pd_error(x, "[conv~]: could not load impulse response '%s'", s->s_name);
+}
+
+static int conv_getsize(t_float f){
+    int size = CONV_HEAD;
+    while(size < f && size < CONV_MAXSIZE)
+        size *= 2;
+    return(size);
+}
+
+static void conv_size(t_conv *x, t_floatarg f){
+    int size = conv_getsize(f);
+    if(size != x->x_size){
+        x->x_size = size;
+        if(x->x_ir)
+            conv_update(x);
+    }
+}
+
+static void conv_free(t_conv *x){
+    if(x->x_threaded){
+        pthread_mutex_lock(&x->x_mutex);
+        x->x_quit = 1;
+        pthread_cond_broadcast(&x->x_cond);
+        pthread_mutex_unlock(&x->x_mutex);
+        pthread_join(x->x_thread, NULL);
+        pthread_cond_destroy(&x->x_cond);
+        pthread_mutex_destroy(&x->x_mutex);
+    }
+    conv_engine_free(x->x_engine);
+    if(x->x_ir)
+        freebytes(x->x_ir, x->x_irsize * sizeof(t_float));
+}
+
+static void *conv_new(t_symbol *s, int ac, t_atom *av){
+    t_conv *x = (t_conv *)pd_new(conv_class);
+    t_symbol *ir = NULL;
+    t_float size = 1024;
+    int floatarg = 0;
+    x->x_canvas = canvas_getcurrent();
+    while(ac){
+        if(av->a_type == A_SYMBOL){
+            t_symbol *sym = atom_getsymbol(av);
+            if(sym == gensym("-zero"))
+                x->x_zero = 1;
+            else if(sym == gensym("-thread"))
+                x->x_threaded = 1;
+            else if(!ir)
+                ir = sym;
+            else
+                goto errstate;
+        }
+        else if(!floatarg++)
+            size = atom_getfloat(av);
+        else
+            goto errstate;
+        ac--, av++;
+    }
+    x->x_size = conv_getsize(size);
+    if(x->x_threaded){
+        pthread_mutex_init(&x->x_mutex, NULL);
+        pthread_cond_init(&x->x_cond, NULL);
+        pthread_create(&x->x_thread, NULL, conv_thread, x);
+    }
+    x->x_outlet = outlet_new(&x->x_obj, &s_signal);
+    if(ir){ // an array if there's one with this name, then a file, then an array made later
+        if(pd_findbyclass(ir, garray_class))
+            conv_set(x, ir);
+        else if(!conv_readfile(x, ir))
+            x->x_pending = ir;
+    }
+    return(x);
+errstate:
+    pd_error(x, "[conv~]: improper args");
+    return(NULL);
+}
+
+void conv_tilde_setup(void){
+    conv_class = class_new(gensym("conv~"), (t_newmethod)conv_new, (t_method)conv_free,
+        sizeof(t_conv), 0, A_GIMME, 0);
+    CLASS_MAINSIGNALIN(conv_class, t_conv, x_f);
+    class_addmethod(conv_class, (t_method)conv_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(conv_class, (t_method)conv_set, gensym("set"), A_SYMBOL, 0);
+    class_addmethod(conv_class, (t_method)conv_load, gensym("load"), A_SYMBOL, 0);
+    class_addmethod(conv_class, (t_method)conv_size, gensym("size"), A_FLOAT, 0);
+}
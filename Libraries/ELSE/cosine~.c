@@ -3,21 +3,19 @@
 #include "m_pd.h"
 #include <math.h>
 #include "shared/magic.h"
-
-#define TWOPI (3.14159265358979323846 * 2)
+#include "shared/osc.h"
 
 static t_class *cosine_class;
 
 typedef struct _cosine
 {
     t_object x_obj;
-    double  x_phase;
-    double  x_last_phase_offset;
+    t_osc    x_osc;
+    int      x_precise;
     t_float  x_freq;
     t_inlet  *x_inlet_phase;
     t_inlet  *x_inlet_sync;
     t_outlet *x_outlet;
-    t_float x_sr;
     // MAGIC:
     t_glist *x_glist; // object list
     t_float *x_signalscalar; // right inlet's float field
@@ -25,6 +23,10 @@ typedef struct _cosine
     t_float  x_phase_sync_float; // float from magic
 } t_cosine;
 
+static void cosine_shape(t_cosine *x, double *phase, t_float *out, int n){
+    osc_cos(phase, out, n, x->x_precise);
+}
+
 static t_int *cosine_perform(t_int *w){
     t_cosine *x = (t_cosine *)(w[1]);
     int nblock = (t_int)(w[2]);
@@ -38,33 +40,11 @@ static t_int *cosine_perform(t_int *w){
         t_float input_phase = fmod(*scalar, 1);
         if (input_phase < 0)
             input_phase += 1;
-        x->x_phase = input_phase;
+        x->x_osc.o_phase = input_phase;
         magic_setnan(x->x_signalscalar);
     }
     // Magic End
-    double phase = x->x_phase;
-    double last_phase_offset = x->x_last_phase_offset;
-    double sr = x->x_sr;
-    double output;
-    while (nblock--){
-        double hz = *in1++;
-        double phase_offset = *in3++;
-        double phase_step = hz / sr; // phase_step
-        phase_step = phase_step > 0.5 ? 0.5 : phase_step < -0.5 ? -0.5 : phase_step; // clipped to nyq
-        double phase_dev = phase_offset - last_phase_offset;
-        if (phase_dev >= 1 || phase_dev <= -1)
-            phase_dev = fmod(phase_dev, 1); // fmod(phase_dev)
-        phase = phase + phase_dev;
-        if (phase <= 0)
-            phase = phase + 1.; // wrap deviated phase
-        if (phase >= 1)
-            phase = phase - 1.; // wrap deviated phase
-        *out++ = cos(phase * TWOPI);
-        phase = phase + phase_step; // next phase
-        last_phase_offset = phase_offset; // last phase offset
-    }
-    x->x_phase = phase;
-    x->x_last_phase_offset = last_phase_offset;
+    osc_perform(&x->x_osc, x, (t_osc_shapefn)cosine_shape, in1, NULL, in3, out, nblock);
     return (w + 7);
 }
 
@@ -76,40 +56,13 @@ static t_int *cosine_perform_sig(t_int *w)
     t_float *in2 = (t_float *)(w[4]); // sync
     t_float *in3 = (t_float *)(w[5]); // phase
     t_float *out = (t_float *)(w[6]);
-    double phase = x->x_phase;
-    double last_phase_offset = x->x_last_phase_offset;
-    double sr = x->x_sr;
-    double output;
-    while (nblock--){
-        double hz = *in1++;
-        t_float trig = *in2++;
-        double phase_offset = *in3++;
-        double phase_step = hz / sr; // phase_step
-        phase_step = phase_step > 0.5 ? 0.5 : phase_step < -0.5 ? -0.5 : phase_step; // clipped to nyq
-        double phase_dev = phase_offset - last_phase_offset;
-        if (phase_dev >= 1 || phase_dev <= -1)
-            phase_dev = fmod(phase_dev, 1); // fmod(phase_dev)
-        if (trig > 0 && trig <= 1)
-            phase = trig;
-        else{
-            phase = phase + phase_dev;
-            if (phase <= 0)
-                phase = phase + 1.; // wrap deviated phase
-            if (phase >= 1)
-                phase = phase - 1.; // wrap deviated phase
-        }
-        *out++ = cos(phase * TWOPI);
-        phase = phase + phase_step; // next phase
-        last_phase_offset = phase_offset; // last phase offset
-    }
-    x->x_phase = phase;
-    x->x_last_phase_offset = last_phase_offset;
+    osc_perform(&x->x_osc, x, (t_osc_shapefn)cosine_shape, in1, in2, in3, out, nblock);
     return (w + 7);
 }
 
 static void cosine_dsp(t_cosine *x, t_signal **sp){
     x->x_hasfeeders = magic_inlet_connection((t_object *)x, x->x_glist, 1, &s_signal); // magic feeder flag
-    x->x_sr = sp[0]->s_sr;
+    x->x_osc.o_sr = sp[0]->s_sr;
     if (x->x_hasfeeders){
         dsp_add(cosine_perform_sig, 6, x, sp[0]->s_n,
                 sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec);
@@ -129,6 +82,11 @@ static void *cosine_free(t_cosine *x){
 static void *cosine_new(t_symbol *s, int ac, t_atom *av){
     t_cosine *x = (t_cosine *)pd_new(cosine_class);
     t_float f1 = 0, f2 = 0;
+    x->x_precise = 0;
+    if (ac && av->a_type == A_SYMBOL && atom_getsymbol(av) == gensym("-precise")){
+        x->x_precise = 1; // libm instead of the polynomial, for 64 bit floats
+        ac--; av++;
+    }
     if (ac && av->a_type == A_FLOAT){
         f1 = av->a_w.w_float;
         ac--; av++;
@@ -140,9 +98,7 @@ static void *cosine_new(t_symbol *s, int ac, t_atom *av){
     t_float init_freq = f1;
     t_float init_phase = f2;
     init_phase < 0 ? 0 : init_phase >= 1 ? 0 : init_phase; // clipping phase input
-    if (init_phase == 0 && init_freq > 0)
-        x->x_phase = 1.;
-    x->x_last_phase_offset = 0;
+    osc_init(&x->x_osc, init_phase == 0 && init_freq > 0 ? 1. : 0.);
     x->x_freq = init_freq;
     x->x_inlet_sync = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
     pd_float((t_pd *)x->x_inlet_sync, 0);
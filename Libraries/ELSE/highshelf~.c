@@ -1,6 +1,7 @@
 // Porres 2017
 
 #include "m_pd.h"
+#include "shared/biquad.h"
 #include <math.h>
 
 #define PI 3.14159265358979323846
@@ -14,80 +15,64 @@ typedef struct _highshelf {
     t_outlet   *x_out;
     t_float     x_nyq;
     int     x_bypass;
-    double  x_xnm1;
-    double  x_xnm2;
-    double  x_ynm1;
-    double  x_ynm2;
+    t_biquad    x_biquad;
     } t_highshelf;
 
 static t_class *highshelf_class;
 
+// the coefficients for the parameters of a sample, see shared/biquad.h
+static void highshelf_coefs(void *z, double *p, t_biquad_coefs *c)
+{
+    t_highshelf *x = (t_highshelf *)z;
+    double f = p[0], slope = p[1], db = p[2];
+    double amp, omega, alphaS, cos_w, b0;
+    t_float nyq = x->x_nyq;
+    
+    if (f < 0.1)
+        f = 0.1;
+    if (f > nyq - 0.1)
+        f = nyq - 0.1;
+    
+    omega = f * PI/nyq; // hz2rad
+    
+    if (slope < 0.000001)
+        slope = 0.000001;
+    if (slope > 1)
+        slope = 1;
+    amp = pow(10, db / 40);
+    alphaS = sin(omega) * sqrt((amp*amp + 1) * (1/slope - 1) + 2*amp);
+    cos_w = cos(omega);
+    b0 = (amp+1) - (amp-1)*cos_w + alphaS;
+    c->a0 = amp*(amp+1 + (amp-1)*cos_w + alphaS) / b0;
+    c->a1 = -2*amp*(amp-1 + (amp+1)*cos_w) / b0;
+    c->a2 = amp*(amp+1 + (amp-1)*cos_w - alphaS) / b0;
+    c->b1 = -2*(amp-1 - (amp+1)*cos_w) / b0;
+    c->b2 = -(amp+1 - (amp-1)*cos_w - alphaS) / b0;
+    c->pass = 0;
+}
+
 static t_int *highshelf_perform(t_int *w)
 {
     t_highshelf *x = (t_highshelf *)(w[1]);
     int nblock = (int)(w[2]);
     t_float *in1 = (t_float *)(w[3]);
-    t_float *in2 = (t_float *)(w[4]);
-    t_float *in3 = (t_float *)(w[5]);
-    t_float *in4 = (t_float *)(w[6]);
+    t_float *params[3] = {(t_float *)(w[4]), (t_float *)(w[5]), (t_float *)(w[6])};
     t_float *out = (t_float *)(w[7]);
-    double xnm1 = x->x_xnm1;
-    double xnm2 = x->x_xnm2;
-    double ynm1 = x->x_ynm1;
-    double ynm2 = x->x_ynm2;
-    t_float nyq = x->x_nyq;
-    while (nblock--)
-    {
-        double xn = *in1++, f = *in2++, slope = *in3++, db = *in4++;
-        double q, amp, omega, alphaS, cos_w, a0, a1, a2, b0, b1, b2, yn;
-
-        if (f < 0.1)
-            f = 0.1;
-        if (f > nyq - 0.1)
-            f = nyq - 0.1;
-        
-        omega = f * PI/nyq; // hz2rad
-        
-        if (slope < 0.000001)
-            slope = 0.000001;
-        if (slope > 1)
-            slope = 1;
-        amp = pow(10, db / 40);
-        alphaS = sin(omega) * sqrt((amp*amp + 1) * (1/slope - 1) + 2*amp);
-        cos_w = cos(omega);
-        b0 = (amp+1) - (amp-1)*cos_w + alphaS;
-        a0 = amp*(amp+1 + (amp-1)*cos_w + alphaS) / b0;
-        a1 = -2*amp*(amp-1 + (amp+1)*cos_w) / b0;
-        a2 = amp*(amp+1 + (amp-1)*cos_w - alphaS) / b0;
-        b1 = -2*(amp-1 - (amp+1)*cos_w) / b0;
-        b2 = -(amp+1 - (amp-1)*cos_w - alphaS) / b0;
-        yn = a0 * xn + a1 * xnm1 + a2 * xnm2 + b1 * ynm1 + b2 * ynm2;
-        if(x->x_bypass)
-            *out++ = xn;
-        else
-            *out++ = yn;
-        xnm2 = xnm1;
-        xnm1 = xn;
-        ynm2 = ynm1;
-        ynm1 = yn;
-    }
-    x->x_xnm1 = xnm1;
-    x->x_xnm2 = xnm2;
-    x->x_ynm1 = ynm1;
-    x->x_ynm2 = ynm2;
+    biquad_perform(&x->x_biquad, x, highshelf_coefs, in1, params, out, nblock, x->x_bypass);
     return (w + 8);
 }
 
 static void highshelf_dsp(t_highshelf *x, t_signal **sp)
 {
     x->x_nyq = sp[0]->s_sr / 2;
+    biquad_invalidate(&x->x_biquad);
     dsp_add(highshelf_perform, 7, x, sp[0]->s_n, sp[0]->s_vec,
             sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec, sp[4]->s_vec);
 }
 
 static void highshelf_clear(t_highshelf *x)
 {
-    x->x_xnm1 = x->x_xnm2 = x->x_ynm1 = x->x_ynm2 = 0.;
+    biquad_clear(&x->x_biquad);
 }
 
 static void highshelf_bypass(t_highshelf *x, t_floatarg f)
@@ -138,6 +123,7 @@ static void *highshelf_new(t_symbol *s, int argc, t_atom *argv)
         }
     };
 /////////////////////////////////////////////////////////////////////////////////////
+    biquad_init(&x->x_biquad, 3);
     x->x_inlet_freq = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
     pd_float((t_pd *)x->x_inlet_freq, freq);
     x->x_inlet_q = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
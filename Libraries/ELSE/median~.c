@@ -3,6 +3,16 @@
 #include "m_pd.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+// [median~ <n>] outputs the median of consecutive windows of n samples within a block.
+// [median~ -slide <n>] outputs the median of the last n samples for every sample, across
+// blocks. The window is split in two heaps, the lower half with its maximum on top and
+// the upper half with its minimum on top, so each sample only costs O(log n).
+// The window is allocated when the size changes, never in the perform routine, and is
+// at most MEDIAN_MAXSIZE samples.
+
+#define MEDIAN_MAXSIZE 524288 // about 12 seconds at 44.1kHz
 
 static t_class *median_class;
 
@@ -13,43 +23,206 @@ typedef struct _median {
     t_float     *x_temp;
     t_int        x_block_size;
     t_outlet    *x_outlet;
+    int          x_slide;
+    int          x_size;    // sliding window size
+    int          x_count;   // samples in the window, until it's full
+    int          x_head;    // oldest sample of the window
+    t_float     *x_ring;    // the window, in time order
+    int         *x_pos;     // heap position of each sample of the window, see median_place()
+    int         *x_lo;      // samples of the lower half, maximum on top
+    int         *x_hi;      // samples of the upper half, minimum on top
+    int          x_nlo;
+    int          x_nhi;
 }t_median;
 
-void median_sort(t_float *a, int n) {
-    if(n < 2)
-        return;
-    t_float p = a[n / 2];
-    t_float *l = a;
-    t_float *r = a + n - 1;
-    while(l <= r){
-        while(*l < p)
-            l++;
-        while(*r > p)
-            r--;
-        if(l <= r){
-            t_float t = *l;
-            *l++ = *r;
-            *r-- = t;
+// quickselect, leaves the k-th smallest value at a[k], smaller ones before it and larger ones after
+static void median_select(t_float *a, int n, int k){
+    int lo = 0, hi = n - 1;
+    while(lo < hi){
+        t_float p = a[(lo + hi) / 2];
+        int l = lo, r = hi;
+        while(l <= r){
+            while(a[l] < p)
+                l++;
+            while(a[r] > p)
+                r--;
+            if(l <= r){
+                t_float t = a[l];
+                a[l++] = a[r];
+                a[r--] = t;
+            }
         }
+        if(k <= r)
+            hi = r;
+        else if(k >= l)
+            lo = l;
+        else
+            return;
     }
-    median_sort(a, r - a + 1);
-    median_sort(l, a + n - l);
 }
 
 t_float median_calculate(t_float * array, int begin, int end){
-    median_sort(array + begin, end - begin + 1);
     int qtd = end - begin + 1;
-    t_float median = 0;
-    median = (qtd%2 == 1) ? array[begin + ((qtd - 1)/2)] :
-        (array[begin + qtd / 2 - 1] + array[begin + qtd / 2])/2.0f;
-    return(median);
+    t_float *a = array + begin;
+    median_select(a, qtd, qtd / 2);
+    if(qtd % 2 == 1)
+        return(a[qtd / 2]);
+    // the other middle value is the largest of the lower half
+    t_float lower = a[0];
+    for(int i = 1; i < qtd / 2; i++)
+        if(a[i] > lower)
+            lower = a[i];
+    return((lower + a[qtd / 2]) / 2.0f);
+}
+
+///////////////////////////////// sliding window /////////////////////////////////
+
+// positions in the lower heap are stored as is, positions in the upper heap as -1 - position
+static void median_place(t_median *x, int *heap, int i, int slot){
+    heap[i] = slot;
+    x->x_pos[slot] = heap == x->x_lo ? i : -1 - i;
+}
+
+// if slot a belongs above slot b in the heap
+static int median_above(t_median *x, int *heap, int a, int b){
+    return(heap == x->x_lo ? x->x_ring[a] > x->x_ring[b] : x->x_ring[a] < x->x_ring[b]);
+}
+
+static void median_sift(t_median *x, int *heap, int n, int i){
+    int slot = heap[i];
+    while(i > 0 && median_above(x, heap, slot, heap[(i - 1) / 2])){
+        median_place(x, heap, i, heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    while(1){
+        int child = 2 * i + 1;
+        if(child >= n)
+            break;
+        if(child + 1 < n && median_above(x, heap, heap[child + 1], heap[child]))
+            child++;
+        if(!median_above(x, heap, heap[child], slot))
+            break;
+        median_place(x, heap, i, heap[child]);
+        i = child;
+    }
+    median_place(x, heap, i, slot);
+}
+
+// keeps the lower half the same size as the upper half, or one larger
+static void median_balance(t_median *x){
+    if(x->x_nlo > x->x_nhi + 1){
+        int slot = x->x_lo[0];
+        median_place(x, x->x_lo, 0, x->x_lo[--x->x_nlo]);
+        median_sift(x, x->x_lo, x->x_nlo, 0);
+        median_place(x, x->x_hi, x->x_nhi++, slot);
+        median_sift(x, x->x_hi, x->x_nhi, x->x_nhi - 1);
+    }
+    else if(x->x_nhi > x->x_nlo){
+        int slot = x->x_hi[0];
+        median_place(x, x->x_hi, 0, x->x_hi[--x->x_nhi]);
+        median_sift(x, x->x_hi, x->x_nhi, 0);
+        median_place(x, x->x_lo, x->x_nlo++, slot);
+        median_sift(x, x->x_lo, x->x_nlo, x->x_nlo - 1);
+    }
+}
+
+static void median_insert(t_median *x, int slot, t_float f){
+    x->x_ring[slot] = f;
+    if(x->x_nlo == 0 || f <= x->x_ring[x->x_lo[0]]){
+        median_place(x, x->x_lo, x->x_nlo++, slot);
+        median_sift(x, x->x_lo, x->x_nlo, x->x_nlo - 1);
+    }
+    else{
+        median_place(x, x->x_hi, x->x_nhi++, slot);
+        median_sift(x, x->x_hi, x->x_nhi, x->x_nhi - 1);
+    }
+    median_balance(x);
 }
 
+// the oldest sample leaves the window as the new one comes in, the sizes of the halves stay
+static void median_replace(t_median *x, int slot, t_float f){
+    int pos = x->x_pos[slot];
+    x->x_ring[slot] = f;
+    if(pos >= 0)
+        median_sift(x, x->x_lo, x->x_nlo, pos);
+    else
+        median_sift(x, x->x_hi, x->x_nhi, -1 - pos);
+    // a value that crossed the middle is now on top of its heap, so swapping the tops is enough
+    if(x->x_nhi && x->x_ring[x->x_lo[0]] > x->x_ring[x->x_hi[0]]){
+        int lo = x->x_lo[0], hi = x->x_hi[0];
+        median_place(x, x->x_lo, 0, hi);
+        median_place(x, x->x_hi, 0, lo);
+        median_sift(x, x->x_lo, x->x_nlo, 0);
+        median_sift(x, x->x_hi, x->x_nhi, 0);
+    }
+}
+
+static void median_freewindow(t_median *x){
+    if(x->x_ring){
+        freebytes(x->x_ring, x->x_size * sizeof(t_float));
+        freebytes(x->x_pos, x->x_size * sizeof(int));
+        freebytes(x->x_lo, x->x_size * sizeof(int));
+        freebytes(x->x_hi, x->x_size * sizeof(int));
+    }
+}
+
+// starts over with a new window, the old one is kept if there's no memory for it
+static void median_resize(t_median *x, int size){
+    t_float *ring = (t_float *)getbytes(size * sizeof(t_float));
+    int *pos = (int *)getbytes(size * sizeof(int));
+    int *lo = (int *)getbytes(size * sizeof(int));
+    int *hi = (int *)getbytes(size * sizeof(int));
+    if(!ring || !pos || !lo || !hi){
+        if(ring) freebytes(ring, size * sizeof(t_float));
+        if(pos) freebytes(pos, size * sizeof(int));
+        if(lo) freebytes(lo, size * sizeof(int));
+        if(hi) freebytes(hi, size * sizeof(int));
+        pd_error(x, "[median~]: couldn't allocate a window of %d samples", size);
+        return;
+    }
+    median_freewindow(x);
+    x->x_ring = ring;
+    x->x_pos = pos;
+    x->x_lo = lo;
+    x->x_hi = hi;
+    x->x_size = size;
+    x->x_count = x->x_head = x->x_nlo = x->x_nhi = 0;
+}
+
+static void median_size(t_median *x, t_floatarg f){
+    int size = f < 1 ? 1 : f > MEDIAN_MAXSIZE ? MEDIAN_MAXSIZE : (int)f;
+    x->x_samples = size;
+    if(x->x_slide && size != x->x_size)
+        median_resize(x, size);
+}
+
+static void median_slide_perform(t_median *x, int n, t_float *in, t_float *out){
+    for(int i = 0; i < n; i++){
+        t_float f = in[i];
+        if(x->x_count < x->x_size){
+            median_insert(x, x->x_head, f);
+            x->x_count++;
+        }
+        else
+            median_replace(x, x->x_head, f);
+        if(++x->x_head == x->x_size)
+            x->x_head = 0;
+        out[i] = x->x_nlo > x->x_nhi ? x->x_ring[x->x_lo[0]] :
+            (x->x_ring[x->x_lo[0]] + x->x_ring[x->x_hi[0]]) / 2.0f;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
 static t_int * median_perform(t_int *w){
     t_median *x = (t_median *)(w[1]);
     t_int n = (int)(w[2]);
     t_float *in1 = (t_float *)(w[3]);
     t_float *out1 = (t_float *)(w[4]);
+    if(x->x_slide){
+        median_slide_perform(x, n, in1, out1);
+        return(w+5);
+    }
     int i = 0;
     for(i = 0 ; i < n ; i++)
         x->x_temp[i] = in1[i];
@@ -74,29 +247,53 @@ static t_int * median_perform(t_int *w){
 static void median_dsp(t_median *x, t_signal **sp){
     t_int block = (t_int)sp[0]->s_n;
     if(block != x->x_block_size){
-        x->x_block_size = (t_int)sp[0]->s_n;
-        x->x_temp = realloc(x->x_temp, sizeof(t_float)*x->x_block_size);
+        x->x_temp = (t_float *)resizebytes(x->x_temp, x->x_block_size * sizeof(t_float),
+            block * sizeof(t_float));
+        x->x_block_size = block;
     }
     dsp_add(median_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
 }
 
 void median_free(t_median *x){
-    free(x->x_temp);
+    freebytes(x->x_temp, x->x_block_size * sizeof(t_float));
+    median_freewindow(x);
 }
 
-void * median_new(t_floatarg f) {
+void * median_new(t_symbol *s, int ac, t_atom *av){
     t_median *x = (t_median *) pd_new(median_class);
-    x->x_samples = (f < 1) ? 1 : f;
+    t_float f = 0;
+    x->x_slide = 0;
+    while(ac > 0){
+        if(av->a_type == A_SYMBOL && !strcmp(atom_getsymbol(av)->s_name, "-slide"))
+            x->x_slide = 1;
+        else if(av->a_type == A_FLOAT)
+            f = atom_getfloat(av);
+        else
+            goto errstate;
+        ac--, av++;
+    }
     x->x_block_size = 1;
-    x->x_temp = (t_float *)malloc(x->x_block_size * sizeof(t_float));
+    x->x_temp = (t_float *)getbytes(x->x_block_size * sizeof(t_float));
+    x->x_size = 0;
+    x->x_ring = NULL;
+    x->x_pos = x->x_lo = x->x_hi = NULL;
+    median_size(x, f);
+    if(x->x_slide && !x->x_ring){
+        pd_free((t_pd *)x);
+        return(NULL);
+    }
     x->x_outlet = outlet_new(&x->x_obj, &s_signal); // outlet
-    floatinlet_new(&x->x_obj, &x->x_samples);
+    inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_float, gensym("size"));
     return(void *)x;
+errstate:
+    pd_error(x, "[median~]: improper args");
+    return(NULL);
 }
 
 void median_tilde_setup(void) {
     median_class = class_new(gensym("median~"), (t_newmethod) median_new,
-        (t_method) median_free, sizeof (t_median), 0, A_DEFFLOAT, 0);
+        (t_method) median_free, sizeof (t_median), 0, A_GIMME, 0);
     class_addmethod(median_class, nullfn, gensym("signal"), 0);
     class_addmethod(median_class, (t_method) median_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(median_class, (t_method) median_size, gensym("size"), A_FLOAT, 0);
 }
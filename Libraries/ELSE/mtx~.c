@@ -40,7 +40,12 @@ typedef struct _mtx{
     float     *x_incrs;
     float     *x_bigincrs;
     int       *x_remains;
-
+    /* Cells that are on or fading, sorted by outlet, so the perform routine
+       doesn't visit the others. Rebuilt when a cell changes. */
+    int       *x_active;
+    int       *x_firstactive; /* start of each outlet's cells in x_active */
+    int        x_dirty;
+    int        x_direct;      /* outlets don't share vectors with inlets */
 } t_mtx;
 
 typedef void (*t_mtx_cellfn)(t_mtx *x, int indx, int ondx,
@@ -50,6 +55,7 @@ static t_class *mtx_class;
 
 /* called only in nonbinary mode;  LATER deal with changing nblock/ksr */
 static void mtx_retarget(t_mtx *x, int cellndx){
+    x->x_dirty = 1;
     float target = (x->x_cells[cellndx] ? x->x_gains[cellndx] : 0.);
     if (x->x_fades[cellndx] < mtx_MINfade){
         x->x_coefs[cellndx] = target;
@@ -66,6 +72,7 @@ static void mtx_retarget(t_mtx *x, int cellndx){
 
 /* called only in nonbinary mode;  LATER deal with changing nblock/ksr */
 static void mtx_retarget_connect(t_mtx *x, int cellndx){
+    x->x_dirty = 1;
     float target = (x->x_cells[cellndx] ? x->x_gains[cellndx] = x->x_defgain : 0.);
     if(x->x_fades[cellndx] < mtx_MINfade){
         x->x_coefs[cellndx] = target;
@@ -139,6 +146,7 @@ static void mtx_list(t_mtx *x, t_symbol *s, int argc, t_atom *argv){
 }
 
 static void mtx_clear(t_mtx *x){
+    x->x_dirty = 1;
     for(int i = 0; i < x->x_ncells; i++){
         x->x_cells[i] = 0;
         if (x->x_gains)
@@ -155,80 +163,119 @@ static void mtx_fade(t_mtx *x, t_floatarg f){
     }
 }
 
-static t_int *mtx_perform(t_int *w){
-    t_mtx *x = (t_mtx *)(w[1]);
-    int nblock = (int)(w[2]);
-    t_float **ivecs = x->x_ivecs;
-    t_float **ovecs = x->x_ovecs;
-    t_float **osums = x->x_osums;
-    int *cellp = x->x_cells;
-    float *gainp = x->x_gains;
-    float *coefp = x->x_coefs;
-    float *incrp = x->x_incrs;
-    float *bigincrp = x->x_bigincrs;
-    int *nleftp = x->x_remains;
-    int indx;
-    for (indx = 0; indx < x->x_numinlets; indx++){
-    t_float *ivec = *ivecs++;
-    t_float **ovecp = osums;
-
-    int ondx = x->x_numoutlets;
-    while (ondx--){
-        t_float *in = ivec;
-        t_float *out = *ovecp;
-        float nleft = *nleftp;
-        int sndx = nblock;
-        if (nleft >= nblock){
-            float coef = *coefp;
-            float incr = *incrp;
-            if((*nleftp -= nblock) == 0)
-                *coefp = (*cellp ? *gainp : 0.);
-            else
-                *coefp += *bigincrp;
-            while (sndx--)
-                    *out++ += *in++ * coef, coef += incr;
-        }
-        else if (nleft > 0){
-            float coef = *coefp;
-            float incr = *incrp;
-            sndx -= nleft;
-            do{
-                *out++ += *in++ * coef, coef += incr;
-            }while (--nleft);
-            if (*cellp){
-                coef = *coefp = *gainp;
-                while (sndx--)
-                    *out++ += *in++ * coef;
-            }
-            else
-                *coefp = 0.;
-            *nleftp = 0;
+static void mtx_update(t_mtx *x){
+    int indx, ondx, nactive = 0;
+    for(ondx = 0; ondx < x->x_numoutlets; ondx++){
+        x->x_firstactive[ondx] = nactive;
+        for(indx = 0; indx < x->x_numinlets; indx++){
+            int cellndx = indx * x->x_numoutlets + ondx;
+            if(x->x_cells[cellndx] || x->x_remains[cellndx] > 0)
+                x->x_active[nactive++] = cellndx;
         }
-        else if (*cellp){
-            float coef = *coefp;
+    }
+    x->x_firstactive[x->x_numoutlets] = nactive;
+    x->x_dirty = 0;
+}
+
+/* settled cells: unrolled so the compiler can vectorize them */
+static void mtx_set(t_float *in, t_float *out, float coef, int nblock){
+    int sndx = 0;
+    for(; sndx < (nblock & ~7); sndx += 8){
+        out[sndx] = in[sndx] * coef;
+        out[sndx + 1] = in[sndx + 1] * coef;
+        out[sndx + 2] = in[sndx + 2] * coef;
+        out[sndx + 3] = in[sndx + 3] * coef;
+        out[sndx + 4] = in[sndx + 4] * coef;
+        out[sndx + 5] = in[sndx + 5] * coef;
+        out[sndx + 6] = in[sndx + 6] * coef;
+        out[sndx + 7] = in[sndx + 7] * coef;
+    }
+    for(; sndx < nblock; sndx++)
+        out[sndx] = in[sndx] * coef;
+}
+
+static void mtx_add(t_float *in, t_float *out, float coef, int nblock){
+    int sndx = 0;
+    for(; sndx < (nblock & ~7); sndx += 8){
+        out[sndx] += in[sndx] * coef;
+        out[sndx + 1] += in[sndx + 1] * coef;
+        out[sndx + 2] += in[sndx + 2] * coef;
+        out[sndx + 3] += in[sndx + 3] * coef;
+        out[sndx + 4] += in[sndx + 4] * coef;
+        out[sndx + 5] += in[sndx + 5] * coef;
+        out[sndx + 6] += in[sndx + 6] * coef;
+        out[sndx + 7] += in[sndx + 7] * coef;
+    }
+    for(; sndx < nblock; sndx++)
+        out[sndx] += in[sndx] * coef;
+}
+
+/* fading cells, adds into 'out' */
+static void mtx_fadecell(t_mtx *x, int cellndx, t_float *in, t_float *out, int nblock){
+    int *cellp = x->x_cells + cellndx;
+    float *coefp = x->x_coefs + cellndx;
+    int *nleftp = x->x_remains + cellndx;
+    float nleft = *nleftp;
+    int sndx = nblock;
+    float coef = *coefp;
+    float incr = x->x_incrs[cellndx];
+    if (nleft >= nblock){
+        if((*nleftp -= nblock) == 0)
+            *coefp = (*cellp ? x->x_gains[cellndx] : 0.);
+        else
+            *coefp += x->x_bigincrs[cellndx];
+        while (sndx--)
+            *out++ += *in++ * coef, coef += incr;
+    }
+    else{
+        sndx -= nleft;
+        do{
+            *out++ += *in++ * coef, coef += incr;
+        }while (--nleft);
+        if (*cellp){
+            coef = *coefp = x->x_gains[cellndx];
             while (sndx--)
                 *out++ += *in++ * coef;
         }
-        cellp++;
-        ovecp++;
-        gainp++;
-        coefp++;
-        incrp++;
-        bigincrp++;
-        nleftp++;
-    }
+        else
+            *coefp = 0.;
+        *nleftp = 0;
     }
-    osums = x->x_osums;
-    indx = x->x_numoutlets;
-    while (indx--){
-        t_float *in = *osums++;
-        t_float *out = *ovecs++;
-        int sndx = nblock;
-        while (sndx--){
-            *out++ = *in;
-            *in++ = 0.;
+    if(*nleftp == 0 && !*cellp) /* faded out, it can leave the list */
+        x->x_dirty = 1;
+}
+
+static t_int *mtx_perform(t_int *w){
+    t_mtx *x = (t_mtx *)(w[1]);
+    int nblock = (int)(w[2]);
+    /* with shared vectors, the inlets must all be read before an outlet is written */
+    t_float **outs = x->x_direct ? x->x_ovecs : x->x_osums;
+    int ondx, i;
+    if(x->x_dirty)
+        mtx_update(x);
+    for(ondx = 0; ondx < x->x_numoutlets; ondx++){
+        t_float *out = outs[ondx];
+        int first = 1;
+        for(i = x->x_firstactive[ondx]; i < x->x_firstactive[ondx + 1]; i++){
+            int cellndx = x->x_active[i];
+            t_float *in = x->x_ivecs[cellndx / x->x_numoutlets];
+            if(x->x_remains[cellndx] > 0){
+                if(first)
+                    memset(out, 0, nblock * sizeof(*out));
+                mtx_fadecell(x, cellndx, in, out, nblock);
+            }
+            else if(first)
+                mtx_set(in, out, x->x_coefs[cellndx], nblock);
+            else
+                mtx_add(in, out, x->x_coefs[cellndx], nblock);
+            first = 0;
         }
+        if(first)
+            memset(out, 0, nblock * sizeof(*out));
     }
+    if(!x->x_direct)
+        for(ondx = 0; ondx < x->x_numoutlets; ondx++)
+            memcpy(x->x_ovecs[ondx], x->x_osums[ondx], nblock * sizeof(t_float));
     return(w + 3);
 }
 
@@ -251,6 +298,13 @@ static void mtx_dsp(t_mtx *x, t_signal **sp){
         };
         x->x_nblock = nblock;
     }
+    x->x_direct = 1;
+    for(i = 0; i < x->x_numoutlets; i++){
+        int j;
+        for(j = 0; j < x->x_numinlets; j++)
+            if(x->x_ovecs[i] == x->x_ivecs[j])
+                x->x_direct = 0;
+    }
     x->x_ksr = sp[0]->s_sr * .001;
     dsp_add(mtx_perform, 2, x, nblock);
 }
@@ -335,6 +389,10 @@ static void *mtx_free(t_mtx *x){
     freebytes(x->x_bigincrs, x->x_ncells * sizeof(*x->x_bigincrs));
     if (x->x_remains)
     freebytes(x->x_remains, x->x_ncells * sizeof(*x->x_remains));
+    if (x->x_active)
+    freebytes(x->x_active, x->x_ncells * sizeof(*x->x_active));
+    if (x->x_firstactive)
+    freebytes(x->x_firstactive, (x->x_numoutlets + 1) * sizeof(*x->x_firstactive));
     return (void *)x;
 }
 
@@ -414,6 +472,9 @@ static void *mtx_new(t_symbol *s, int argc, t_atom *argv){
         for (i = 0; i < x->x_ncells; i++){
             x->x_remains[i] = 0;
         };
+    x->x_active = getbytes(x->x_ncells * sizeof(*x->x_active));
+    x->x_firstactive = getbytes((x->x_numoutlets + 1) * sizeof(*x->x_firstactive));
+    x->x_dirty = 1;
     for (i = 1; i < x->x_numinlets; i++){
         inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
     };
@@ -1,6 +1,7 @@
 // Porres 2017
 
 #include "m_pd.h"
+#include "shared/biquad.h"
 #include <math.h>
 #include <string.h>
 
@@ -15,83 +16,67 @@ typedef struct _resonant {
     t_float     x_nyq;
     int     x_bypass;
     int     x_t60;
-    double  x_xnm1;
-    double  x_xnm2;
-    double  x_ynm1;
-    double  x_ynm2;
+    t_biquad    x_biquad;
     } t_resonant;
 
 static t_class *resonant_class;
 
+// the coefficients for the parameters of a sample, see shared/biquad.h
+static void resonant_coefs(void *z, double *p, t_biquad_coefs *c)
+{
+    t_resonant *x = (t_resonant *)z;
+    double f = p[0], reson = p[1];
+    double q, omega, alphaQ, cos_w, b0;
+    t_float nyq = x->x_nyq;
+    
+    if (x->x_t60) // reson is t60 in ms
+        q = f * (PI * reson/1000) / log(1000);
+    else
+        q = reson;
+    if (f < 0.000001)
+        f = 0.000001;
+    if (f > nyq - 0.000001)
+        f = nyq - 0.000001;
+    if (q < 0.000001)
+        {
+        q = 0.000001; // prevent blow-up
+        c->pass = 1; // force bypass
+        }
+    else
+        c->pass = 0;
+    omega = f * PI/nyq;
+    alphaQ = sin(omega) / (2*q);
+    cos_w = cos(omega);
+    b0 = alphaQ + 1;
+    c->a0 = alphaQ*q / b0;
+    c->a1 = 0;
+    c->a2 = -c->a0;
+    c->b1 = 2*cos_w / b0;
+    c->b2 = (alphaQ - 1) / b0;
+}
+
 static t_int *resonant_perform(t_int *w)
 {
     t_resonant *x = (t_resonant *)(w[1]);
     int nblock = (int)(w[2]);
     t_float *in1 = (t_float *)(w[3]);
-    t_float *in2 = (t_float *)(w[4]);
-    t_float *in3 = (t_float *)(w[5]);
+    t_float *params[2] = {(t_float *)(w[4]), (t_float *)(w[5])};
     t_float *out = (t_float *)(w[6]);
-    double xnm1 = x->x_xnm1;
-    double xnm2 = x->x_xnm2;
-    double ynm1 = x->x_ynm1;
-    double ynm2 = x->x_ynm2;
-    t_float nyq = x->x_nyq;
-    while (nblock--)
-    {
-        double xn = *in1++, f = *in2++, reson = *in3++;
-        double q, omega, alphaQ, cos_w, a0, a2, b0, b1, b2, yn;
-        if (x->x_t60) // reson is t60 in ms
-            q = f * (PI * reson/1000) / log(1000);
-        else
-            q = reson;
-        int q_bypass;
-        if (f < 0.000001)
-            f = 0.000001;
-        if (f > nyq - 0.000001)
-            f = nyq - 0.000001;
-        if (q < 0.000001)
-            {
-            q = 0.000001; // prevent blow-up
-            q_bypass = 1; // force bypass
-            }
-        else
-            q_bypass = 0;
-        omega = f * PI/nyq;
-        alphaQ = sin(omega) / (2*q);
-        cos_w = cos(omega);
-        b0 = alphaQ + 1;
-        a0 = alphaQ*q / b0;
-        a2 = -a0;
-        b1 = 2*cos_w / b0;
-        b2 = (alphaQ - 1) / b0;
-        yn = a0 * xn + a2 * xnm2 + b1 * ynm1 + b2 * ynm2;
-        if(x->x_bypass || q_bypass)
-            *out++ = xn;
-        else
-            *out++ = yn;
-        
-        xnm2 = xnm1;
-        xnm1 = xn;
-        ynm2 = ynm1;
-        ynm1 = yn;
-    }
-    x->x_xnm1 = xnm1;
-    x->x_xnm2 = xnm2;
-    x->x_ynm1 = ynm1;
-    x->x_ynm2 = ynm2;
+    biquad_perform(&x->x_biquad, x, resonant_coefs, in1, params, out, nblock, x->x_bypass);
     return (w + 7);
 }
 
 static void resonant_dsp(t_resonant *x, t_signal **sp)
 {
     x->x_nyq = sp[0]->s_sr / 2;
+    biquad_invalidate(&x->x_biquad);
     dsp_add(resonant_perform, 6, x, sp[0]->s_n, sp[0]->s_vec,sp[1]->s_vec, sp[2]->s_vec,
             sp[3]->s_vec);
 }
 
 static void resonant_clear(t_resonant *x)
 {
-    x->x_xnm1 = x->x_xnm2 = x->x_ynm1 = x->x_ynm2 = 0.;
+    biquad_clear(&x->x_biquad);
 }
 
 static void resonant_bypass(t_resonant *x, t_floatarg f)
@@ -102,11 +87,13 @@ static void resonant_bypass(t_resonant *x, t_floatarg f)
 static void resonant_t60(t_resonant *x)
 {
     x->x_t60 = 1;
+    biquad_invalidate(&x->x_biquad);
 }
 
 static void resonant_q(t_resonant *x)
 {
     x->x_t60 = 0;
+    biquad_invalidate(&x->x_biquad);
 }
 
 
@@ -156,6 +143,7 @@ static void *resonant_new(t_symbol *s, int argc, t_atom *argv)
     /////////////////////////////////////////////////////////////////////////////////////
     x->x_t60 = t60;
     
+    biquad_init(&x->x_biquad, 2);
     x->x_inlet_freq = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
     pd_float((t_pd *)x->x_inlet_freq, freq);
     x->x_inlet_q = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
@@ -0,0 +1,167 @@
+// biquad filtering with coefficients computed per block when possible, see biquad.h
+
+#include "m_pd.h"
+#include <math.h>
+#include "biquad.h"
+
+#define BIQUAD_CHUNK    64  // samples filtered at once with fixed coefficients
+#define BIQUAD_SEGMENT  8   // samples interpolated when the parameters move in a straight line
+
+void biquad_init(t_biquad *b, int nparams){
+    b->b_nparams = nparams < BIQUAD_MAXPARAMS ? nparams : BIQUAD_MAXPARAMS;
+    biquad_clear(b);
+    biquad_invalidate(b);
+}
+
+void biquad_clear(t_biquad *b){
+    b->b_xnm1 = b->b_xnm2 = b->b_ynm1 = b->b_ynm2 = 0.;
+}
+
+void biquad_invalidate(t_biquad *b){
+    b->b_valid = 0;
+}
+
+// only computes the coefficients if the parameters changed since the last sample
+static void biquad_update(t_biquad *b, void *x, t_biquad_coeffn fn, double *params){
+    int i, changed = !b->b_valid;
+    for(i = 0; i < b->b_nparams; i++){
+        if(params[i] != b->b_params[i]){
+            b->b_params[i] = params[i];
+            changed = 1;
+        }
+    }
+    if(changed){
+        fn(x, b->b_params, &b->b_coefs);
+        b->b_valid = 1;
+    }
+}
+
+// the feedforward part doesn't depend on earlier outputs, so it's computed for a chunk in a
+// loop the compiler can vectorize, leaving only the two feedback taps in the recursion
+static void biquad_run(t_biquad *b, t_float *in, t_float *out, int n, int bypass){
+    double xs[BIQUAD_CHUNK + 2], ff[BIQUAD_CHUNK];
+    double a0 = b->b_coefs.a0, a1 = b->b_coefs.a1, a2 = b->b_coefs.a2;
+    double b1 = b->b_coefs.b1, b2 = b->b_coefs.b2;
+    double ynm1 = b->b_ynm1, ynm2 = b->b_ynm2;
+    int i;
+    bypass = bypass || b->b_coefs.pass;
+    while(n > 0){
+        int m = n < BIQUAD_CHUNK ? n : BIQUAD_CHUNK;
+        xs[0] = b->b_xnm2;
+        xs[1] = b->b_xnm1;
+        for(i = 0; i < m; i++) // read before writing, 'out' may be 'in'
+            xs[i + 2] = in[i];
+        for(i = 0; i < m; i++)
+            ff[i] = a0 * xs[i + 2] + a1 * xs[i + 1] + a2 * xs[i];
+        for(i = 0; i < m; i++){
+            double yn = ff[i] + b1 * ynm1 + b2 * ynm2;
+            ynm2 = ynm1;
+            ynm1 = yn;
+            out[i] = bypass ? xs[i + 2] : yn;
+        }
+        b->b_xnm2 = xs[m];
+        b->b_xnm1 = xs[m + 1];
+        in += m;
+        out += m;
+        n -= m;
+    }
+    b->b_ynm1 = ynm1;
+    b->b_ynm2 = ynm2;
+}
+
+static int biquad_isconstant(t_float *in, int n){
+    int i;
+    for(i = 1; i < n; i++)
+        if(in[i] != in[0])
+            return(0);
+    return(1);
+}
+
+// if the parameters of a segment continue in a straight line from the last sample, and change
+// little enough for the coefficients to be close to linear too
+static int biquad_issmooth(t_biquad *b, double p[][BIQUAD_MAXPARAMS], int m){
+    int i, j;
+    for(j = 0; j < b->b_nparams; j++){
+        double start = b->b_params[j], end = p[m - 1][j];
+        double step = (end - start) / m;
+        if(fabs(end - start) > 0.01 * fabs(end) + 0.000001)
+            return(0);
+        double tolerance = 0.001 * fabs(end - start) + 0.000001 * fabs(end);
+        for(i = 0; i < m - 1; i++)
+            if(fabs(p[i][j] - (start + step * (i + 1))) > tolerance)
+                return(0);
+    }
+    return(1);
+}
+
+// filters a sample with its own coefficients
+#define BIQUAD_TICK(c, xn, out) do{ \
+    double yn = (c)->a0 * (xn) + (c)->a1 * xnm1 + (c)->a2 * xnm2 + (c)->b1 * ynm1 + (c)->b2 * ynm2; \
+    (out) = (bypass || (c)->pass) ? (xn) : yn; \
+    xnm2 = xnm1; \
+    xnm1 = (xn); \
+    ynm2 = ynm1; \
+    ynm1 = yn; \
+}while(0)
+
+// for signals in the parameter inlets
+static void biquad_varying(t_biquad *b, void *x, t_biquad_coeffn fn, t_float *in,
+t_float **params, t_float *out, int n, int bypass){
+    double xs[BIQUAD_SEGMENT], p[BIQUAD_SEGMENT][BIQUAD_MAXPARAMS];
+    double xnm1 = b->b_xnm1, xnm2 = b->b_xnm2, ynm1 = b->b_ynm1, ynm2 = b->b_ynm2;
+    t_biquad_coefs c;
+    int i, j, k;
+    for(i = 0; i < n; i += BIQUAD_SEGMENT){
+        int m = n - i < BIQUAD_SEGMENT ? n - i : BIQUAD_SEGMENT;
+        for(k = 0; k < m; k++){ // read before writing, 'out' may be an input
+            xs[k] = in[i + k];
+            for(j = 0; j < b->b_nparams; j++)
+                p[k][j] = params[j][i + k];
+        }
+        if(b->b_valid && m == BIQUAD_SEGMENT && biquad_issmooth(b, p, m)){
+            // interpolated coefficients keep the feedback stable, since that's a convex region
+            t_biquad_coefs start = b->b_coefs;
+            biquad_update(b, x, fn, p[m - 1]);
+            for(k = 0; k < m; k++){
+                double frac = (double)(k + 1) / m;
+                c.a0 = start.a0 + (b->b_coefs.a0 - start.a0) * frac;
+                c.a1 = start.a1 + (b->b_coefs.a1 - start.a1) * frac;
+                c.a2 = start.a2 + (b->b_coefs.a2 - start.a2) * frac;
+                c.b1 = start.b1 + (b->b_coefs.b1 - start.b1) * frac;
+                c.b2 = start.b2 + (b->b_coefs.b2 - start.b2) * frac;
+                c.pass = k == m - 1 ? b->b_coefs.pass : start.pass;
+                BIQUAD_TICK(&c, xs[k], out[i + k]);
+            }
+        }
+        else{ // audio rate modulation, computed per sample
+            for(k = 0; k < m; k++){
+                fn(x, p[k], &c);
+                BIQUAD_TICK(&c, xs[k], out[i + k]);
+            }
+            for(j = 0; j < b->b_nparams; j++)
+                b->b_params[j] = p[m - 1][j];
+            b->b_coefs = c;
+            b->b_valid = 1;
+        }
+    }
+    b->b_xnm1 = xnm1;
+    b->b_xnm2 = xnm2;
+    b->b_ynm1 = ynm1;
+    b->b_ynm2 = ynm2;
+}
+
+void biquad_perform(t_biquad *b, void *x, t_biquad_coeffn fn, t_float *in,
+t_float **params, t_float *out, int n, int bypass){
+    int j, constant = 1;
+    for(j = 0; j < b->b_nparams && constant; j++)
+        constant = biquad_isconstant(params[j], n);
+    if(constant){ // floats or a still signal, the coefficients hold for the whole block
+        double p[BIQUAD_MAXPARAMS];
+        for(j = 0; j < b->b_nparams; j++)
+            p[j] = params[j][0];
+        biquad_update(b, x, fn, p);
+        biquad_run(b, in, out, n, bypass);
+    }
+    else
+        biquad_varying(b, x, fn, in, params, out, n, bypass);
+}
@@ -0,0 +1,39 @@
+#ifndef __biquad_H__
+#define __biquad_H__
+
+// biquad filtering shared by lowpass~, highpass~, bandpass~, bandstop~, resonant~,
+// eq~, lowshelf~, highshelf~ and allpass.2nd~. Each object only computes its coefficients
+// from the parameters of a sample, this computes them as rarely as the parameters allow:
+// once per block when the parameter inlets are constant, every few samples with interpolation
+// when they move slowly in a straight line (like from line~) and per sample otherwise.
+
+#define BIQUAD_MAXPARAMS 4
+
+typedef struct _biquad_coefs{
+    double  a0, a1, a2;     // feedforward
+    double  b1, b2;         // feedback, already negated: y[n] = ... + b1*y[n-1] + b2*y[n-2]
+    int     pass;           // output the input, while the filter keeps running
+}t_biquad_coefs;
+
+// computes the coefficients for the parameters of one sample, 'x' is the object
+typedef void (*t_biquad_coeffn)(void *x, double *params, t_biquad_coefs *c);
+
+typedef struct _biquad{
+    double          b_xnm1;
+    double          b_xnm2;
+    double          b_ynm1;
+    double          b_ynm2;
+    int             b_nparams;
+    int             b_valid;                        // if the cached coefficients can be used
+    double          b_params[BIQUAD_MAXPARAMS];     // parameters of the last sample
+    t_biquad_coefs  b_coefs;                        // and their coefficients
+}t_biquad;
+
+void biquad_init(t_biquad *b, int nparams);
+void biquad_clear(t_biquad *b);
+// for changes that aren't in the parameters, like the sample rate or a -bw flag
+void biquad_invalidate(t_biquad *b);
+void biquad_perform(t_biquad *b, void *x, t_biquad_coeffn fn, t_float *in,
+    t_float **params, t_float *out, int n, int bypass);
+
+#endif
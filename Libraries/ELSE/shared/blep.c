@@ -0,0 +1,190 @@
+// band-limited steps, ramps and impulses, see blep.h
+
+#include "m_pd.h"
+#include <math.h>
+#include <string.h>
+#include "blep.h"
+
+#define BLEP_OS     128     // table points per sample
+#define BLEP_FINE   16      // integration steps per table point
+#define BLEP_SIZE   (2 * BLEP_HALF * BLEP_OS + 2) // with a guard point for the interpolation
+#define BLEP_CUTOFF 0.45    // in fractions of the sample rate
+#define BLEP_BETA   8.6     // kaiser window, about 90dB down outside the main lobe
+
+#define BLEP_PI 3.14159265358979323846
+
+// the naive step and ramp are taken out as they're added, the tables are smooth to interpolate
+static double blep_impulse_table[BLEP_SIZE];    // the kernel, with an area of 1
+static double blep_step_table[BLEP_SIZE];       // its integral, a band-limited step
+static double blep_ramp_table[BLEP_SIZE];       // and the integral of that, a band-limited ramp
+// the kernel's points for blep_downsample(), by the oversampled input they go with
+static double blep_down_table[BLEP_OVERSAMPLE][2 * BLEP_HALF];
+
+static double blep_bessel0(double x){
+    double sum = 1, term = 1;
+    for(int k = 1; k < 50; k++){
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if(term < sum * 1e-17)
+            break;
+    }
+    return(sum);
+}
+
+// kaiser windowed sinc, 't' in samples
+static double blep_kernel(double t){
+    double w = t / BLEP_HALF;
+    if(w <= -1 || w >= 1)
+        return(0);
+    double sinc = t == 0 ? 2 * BLEP_CUTOFF : sin(2 * BLEP_PI * BLEP_CUTOFF * t) / (BLEP_PI * t);
+    return(sinc * blep_bessel0(BLEP_BETA * sqrt(1 - w * w)) / blep_bessel0(BLEP_BETA));
+}
+
+void blep_setup(void){
+    static int done;
+    if(done)
+        return;
+    int n = 2 * BLEP_HALF * BLEP_OS, i, j;
+    double dt = 1. / (BLEP_OS * BLEP_FINE), h, last = 0, step = 0, ramp = 0, area;
+    // integrals of the kernel and of its integral on a finer grid, by the trapezoidal rule
+    blep_impulse_table[0] = blep_step_table[0] = blep_ramp_table[0] = 0;
+    for(i = 1; i <= n; i++){
+        for(j = 1; j <= BLEP_FINE; j++){
+            h = blep_kernel(-BLEP_HALF + ((i - 1) * BLEP_FINE + j) * dt);
+            double next = step + (last + h) * 0.5 * dt;
+            ramp += (step + next) * 0.5 * dt;
+            step = next;
+            last = h;
+        }
+        blep_impulse_table[i] = h;
+        blep_step_table[i] = step;
+        blep_ramp_table[i] = ramp;
+    }
+    area = step;
+    for(i = 0; i <= n; i++){
+        blep_impulse_table[i] /= area;
+        blep_step_table[i] /= area;
+        blep_ramp_table[i] /= area;
+    }
+    blep_impulse_table[n + 1] = 0;
+    blep_step_table[n + 1] = 1;
+    blep_ramp_table[n + 1] = blep_ramp_table[n] + 1. / BLEP_OS;
+    for(i = 0; i < 2 * BLEP_HALF; i++)
+        for(j = 0; j < BLEP_OVERSAMPLE; j++)
+            blep_down_table[j][i] = blep_impulse_table[i * BLEP_OS + j * (BLEP_OS / BLEP_OVERSAMPLE)]
+                / BLEP_OVERSAMPLE;
+    done = 1;
+}
+
+void blep_init(t_blep *b, double phase){
+    memset(b->b_buf, 0, sizeof(b->b_buf));
+    b->b_last = phase;
+    b->b_step = 0;
+}
+
+// sample i of the chunk is at b_buf[BLEP_HALF + i], so the kernel goes from b_buf[i] on
+static void blep_add(t_blep *b, double *table, int i, double frac, double amp){
+    double *buf = b->b_buf + i;
+    double pos = frac * BLEP_OS;
+    int ip = (int)pos;
+    double f = pos - ip;
+    double *t = table + ip;
+    for(int j = 0; j < 2 * BLEP_HALF; j++, t += BLEP_OS)
+        buf[j] += amp * (t[0] + f * (t[1] - t[0]));
+}
+
+// the oscillator already wrote the naive step or ramp into the samples from the event on, so
+// they're taken out of the band-limited one
+void blep_step(t_blep *b, int i, double frac, double amp){
+    double *buf = b->b_buf + i;
+    blep_add(b, blep_step_table, i, frac, amp);
+    for(int j = frac < 1 ? BLEP_HALF : BLEP_HALF - 1; j < 2 * BLEP_HALF; j++)
+        buf[j] -= amp;
+}
+
+void blep_ramp(t_blep *b, int i, double frac, double amp){
+    double *buf = b->b_buf + i;
+    blep_add(b, blep_ramp_table, i, frac, amp);
+    for(int j = frac < 1 ? BLEP_HALF : BLEP_HALF - 1; j < 2 * BLEP_HALF; j++)
+        buf[j] -= amp * (j - BLEP_HALF + frac);
+}
+
+void blep_impulse(t_blep *b, int i, double frac, double amp){
+    blep_add(b, blep_impulse_table, i, frac, amp);
+}
+
+// summed apart and added at the end, it's a lot faster than adding into the buffer each time
+void blep_downsample(t_blep *b, int i, double *in){
+    double *buf = b->b_buf + i, sum[2 * BLEP_HALF] = {0};
+    int j, r;
+    for(r = 0; r < BLEP_OVERSAMPLE; r++)
+        for(j = 0; j < 2 * BLEP_HALF; j++)
+            sum[j] += in[r] * blep_down_table[r][j];
+    for(j = 0; j < 2 * BLEP_HALF; j++)
+        buf[j] += sum[j];
+}
+
+static double blep_value(t_blep_shape *s, double phase, double *slope){
+    int k = s->s_n - 1;
+    while(k > 0 && phase < s->s_start[k])
+        k--;
+    *slope = s->s_slope[k];
+    return(s->s_value[k] + s->s_slope[k] * (phase - s->s_start[k]));
+}
+
+static void blep_sample(t_blep *b, int i, t_blep_shape *s, double last, double step,
+double phase){
+    double end = last + step, expected = end, value, slope;
+    double lo = step > 0 ? last : end, hi = step > 0 ? end : last;
+    int k;
+    if(expected <= 0) // wrapped like osc_phase() does
+        expected += 1;
+    if(expected >= 1)
+        expected -= 1;
+    for(k = 0; k < s->s_n && step != 0; k++){ // corners it went by, in (lo, hi]
+        // the first time the corner comes after 'lo', which is in (-1/2, 1], and steps are
+        // shorter than a cycle
+        double start = s->s_start[k];
+        double at = lo < start - 1 ? start - 1 : lo < start ? start : start + 1;
+        if(at > hi)
+            continue;
+        int prev = k ? k - 1 : s->s_n - 1;
+        double length = s->s_start[k] - s->s_start[prev] + (k ? 0 : 1);
+        double jump = s->s_value[k] - (s->s_value[prev] + s->s_slope[prev] * length);
+        double bend = s->s_slope[k] - s->s_slope[prev];
+        double frac = (end - at) / step;
+        if(jump != 0)
+            blep_step(b, i, frac, step > 0 ? jump : -jump);
+        if(bend != 0)
+            blep_ramp(b, i, frac, bend * fabs(step));
+    }
+    value = blep_value(s, phase, &slope);
+    if(phase != expected){ // synced, or the phase offset moved
+        double from;
+        double jump = value - blep_value(s, expected, &from);
+        if(jump != 0)
+            blep_step(b, i, 0, jump);
+        if(slope != from)
+            blep_ramp(b, i, 0, (slope - from) * step);
+    }
+    b->b_buf[BLEP_HALF + i] += value;
+}
+
+void blep_shape(t_blep *b, t_blep_shape *s, int stride, double *phase, double *step, int n){
+    double last = b->b_last, laststep = b->b_step;
+    for(int i = 0; i < n; i++, s += stride){
+        blep_sample(b, i, s, last, laststep, phase[i]);
+        last = phase[i];
+        laststep = step[i];
+    }
+    b->b_last = last;
+    b->b_step = laststep;
+}
+
+void blep_read(t_blep *b, t_float *out, int n){
+    int i;
+    for(i = 0; i < n; i++)
+        out[i] = b->b_buf[i];
+    memmove(b->b_buf, b->b_buf + n, 2 * BLEP_HALF * sizeof(double));
+    memset(b->b_buf + 2 * BLEP_HALF, 0, n * sizeof(double));
+}
@@ -0,0 +1,52 @@
+#ifndef __blep_H__
+#define __blep_H__
+
+// band-limited steps, ramps and impulses for the bl.* oscillators. An oscillator reports where its
+// naive waveform jumps (a step), bends (a ramp) or clicks (an impulse), with the fraction of a
+// sample since it happened, and this adds the difference between the band-limited version of each
+// one and the naive one around it. A wavetable has no corners to report, so bl.wavetable~ runs
+// oversampled and gets downsampled with the same kernel, a windowed sinc in tables shared by all
+// objects. It's linear phase, so the output comes BLEP_HALF samples late, like from a lowpass.
+
+#define BLEP_HALF   12  // kernel half width in samples
+#define BLEP_CHUNK  64  // most samples written before blep_read()
+#define BLEP_MAXSEG 3
+#define BLEP_OVERSAMPLE 16  // for blep_downsample()
+
+typedef struct _blep{
+    double  b_buf[BLEP_CHUNK + 2 * BLEP_HALF];
+    double  b_last;     // phase of the previous sample
+    double  b_step;     // and the step it took from there
+}t_blep;
+
+// a waveform made of straight segments over a cycle, the first one starts at phase 0
+typedef struct _blep_shape{
+    int     s_n;
+    double  s_start[BLEP_MAXSEG];   // phase where each segment starts, in increasing order
+    double  s_value[BLEP_MAXSEG];   // value at the start
+    double  s_slope[BLEP_MAXSEG];   // change per cycle
+}t_blep_shape;
+
+// builds the shared tables, call it from the class setup
+void blep_setup(void);
+void blep_init(t_blep *b, double phase);
+
+// for something that happened 'frac' samples (0 to 1) before sample 'i' of the chunk
+void blep_step(t_blep *b, int i, double frac, double amp);      // jump in value
+void blep_ramp(t_blep *b, int i, double frac, double amp);      // change of slope, per sample
+void blep_impulse(t_blep *b, int i, double frac, double amp);   // impulse with area 'amp'
+
+// the samples of a signal BLEP_OVERSAMPLE times as fast that lead to sample 'i', in[r] being
+// r / BLEP_OVERSAMPLE samples before it, lowpassed with the kernel and decimated
+void blep_downsample(t_blep *b, int i, double *in);
+
+// writes 'n' samples of a shape from their phases and steps (as osc_phase() gives them), with the
+// corrections for the corners they went by. If a phase isn't where the last step leads, the
+// oscillator was synced or its phase offset moved, so that's a jump too. Sample 'i' has the shape
+// at s[i * stride], so a stride of 0 keeps the same shape.
+void blep_shape(t_blep *b, t_blep_shape *s, int stride, double *phase, double *step, int n);
+
+// the output of a chunk of 'n' samples, then gets ready for the next one
+void blep_read(t_blep *b, t_float *out, int n);
+
+#endif
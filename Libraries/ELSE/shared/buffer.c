@@ -1,6 +1,7 @@
 
 #include "m_pd.h"
 #include "buffer.h"
+#include "samplepool.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
@@ -83,6 +84,8 @@ void buffer_clear(t_buffer *c){
 }
 
 void buffer_redraw(t_buffer *c){
+    if(c->c_file) // nothing to redraw
+        return;
     if(!c->c_single){
         if(c->c_numchans <= 1 && c->c_bufname != &s_){
             t_garray *ap = (t_garray *)pd_findbyclass(c->c_bufname, garray_class);
@@ -132,7 +135,11 @@ void buffer_redraw(t_buffer *c){
 void buffer_validate(t_buffer *c, int complain){
     buffer_clear(c);
     c->c_npts = SHARED_INT_MAX;
-    if(!c->c_single){
+    if(c->c_file){
+        if(c->c_file->f_nframes < SHARED_INT_MAX)
+            c->c_npts = (int)c->c_file->f_nframes;
+    }
+    else if(!c->c_single){
         if (c->c_numchans <= 1 && c->c_bufname != &s_){
             c->c_vectors[0] = buffer_get(c, c->c_bufname, &c->c_npts, 1, 0);
             if(!c->c_vectors[0]){ // check for 0-bufname if bufname array isn't found
@@ -166,6 +173,10 @@ void buffer_playcheck(t_buffer *c){
 
 void buffer_initarray(t_buffer *c, t_symbol *name, int complain){
     if(name){ // setting array names
+        if(c->c_file){
+            samplepool_close(c->c_file);
+            c->c_file = NULL;
+        }
         c->c_bufname = name;
         if(c->c_numchans >= 1){
             char buf[MAXPDSTRING];
@@ -185,6 +196,18 @@ void buffer_setarray(t_buffer *c, t_symbol *name){
    buffer_initarray(c, name, 1); 
 }
 
+int buffer_setfile(t_buffer *c, t_canvas *canvas, t_symbol *name){
+    t_poolfile *f = samplepool_open(canvas, name->s_name);
+    if(!f)
+        return(0);
+    if(c->c_file)
+        samplepool_close(c->c_file);
+    c->c_file = f;
+    buffer_validate(c, 0);
+    buffer_playcheck(c);
+    return(1);
+}
+
 void buffer_setminsize(t_buffer *c, int i){
     c->c_minsize = i;
 }
@@ -196,6 +219,8 @@ void buffer_checkdsp(t_buffer *c){
 }
 
 void buffer_free(t_buffer *c){
+    if(c->c_file)
+        samplepool_close(c->c_file);
     if (c->c_vectors)
         freebytes(c->c_vectors, c->c_numchans * sizeof(*c->c_vectors));
     if (c->c_channames)
@@ -226,6 +251,7 @@ void *buffer_init(t_class *owner, t_symbol *bufname, int numchans, int singlemod
         return (0);
     };
     c->c_single = singlemode;
+    c->c_file = NULL;
     c->c_owner = owner;
     c->c_npts = 0;
     c->c_vectors = vectors;
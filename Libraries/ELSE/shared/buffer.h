@@ -26,6 +26,8 @@ typedef struct _buffer{
     int         c_single; //flag for single channel mode
                         //0-regular mode, 1-load this particular channel (1-idx)
                         //should be used with c_numchans == 1
+    struct _poolfile *c_file; //a sound file from the sample pool instead of arrays, see samplepool.h
+                        //c_vectors are all null then, so only objects that set it can use it
 }t_buffer;
 
 void buffer_bug(char *fmt, ...);
@@ -44,6 +46,10 @@ t_word *buffer_get(t_buffer *c, t_symbol * name, int *bufsize, int indsp, int co
 //wrap around initarray, but allow warnings (pass 1 to complain)
 void buffer_setarray(t_buffer *c, t_symbol *name);
 
+//reads from a memory-mapped sound file instead of arrays until an array is set again,
+//returns 0 (and keeps what it had) if the file can't be opened
+int buffer_setfile(t_buffer *c, t_canvas *canvas, t_symbol *name);
+
 void buffer_setminsize(t_buffer *c, int i);
 void buffer_enable(t_buffer *c, t_floatarg f);
 //void buffer_dsp(t_buffer *x, t_signal **sp, t_perfroutine perf, int complain);
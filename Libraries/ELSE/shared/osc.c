@@ -0,0 +1,130 @@
+// oscillator phase and waveforms, see osc.h
+
+#include "m_pd.h"
+#include <math.h>
+#include "osc.h"
+
+#define OSC_TWOPI (3.14159265358979323846 * 2)
+
+void osc_init(t_osc *o, double phase){
+    o->o_phase = phase;
+    o->o_last_phase_offset = 0;
+    o->o_sr = sys_getsr();
+}
+
+// if the frequency and phase offset inlets hold still and nothing syncs after the first sample
+static int osc_isconstant(t_float *freq, t_float *sync, t_float *offset, int n){
+    int i;
+    for(i = 1; i < n; i++){
+        if(freq[i] != freq[0] || offset[i] != offset[0])
+            return(0);
+        if(sync && sync[i] > 0 && sync[i] <= 1)
+            return(0);
+    }
+    return(1);
+}
+
+void osc_phase(t_osc *o, t_float *freq, t_float *sync, t_float *offset, double *out,
+double *step, int n){
+    double phase = o->o_phase;
+    double last_phase_offset = o->o_last_phase_offset;
+    double sr = o->o_sr;
+    int i, constant = osc_isconstant(freq, sync, offset, n);
+    for(i = 0; i < n; i++){
+        double hz = freq[i];
+        double phase_offset = offset[i];
+        double phase_step = hz / sr; // phase_step
+        phase_step = phase_step > 0.5 ? 0.5 : phase_step < -0.5 ? -0.5 : phase_step; // clipped to nyq
+        double phase_dev = phase_offset - last_phase_offset;
+        if(phase_dev >= 1 || phase_dev <= -1)
+            phase_dev = fmod(phase_dev, 1); // fmod(phase_dev)
+        if(sync && sync[i] > 0 && sync[i] <= 1)
+            phase = sync[i];
+        else{
+            phase = phase + phase_dev;
+            if(phase <= 0)
+                phase = phase + 1.; // wrap deviated phase
+            if(phase >= 1)
+                phase = phase - 1.; // wrap deviated phase
+        }
+        out[i] = phase;
+        if(step)
+            step[i] = phase_step;
+        phase = phase + phase_step; // next phase
+        last_phase_offset = phase_offset; // last phase offset
+        if(constant){ // the same steps as above with no deviation, which adds an exact 0
+            for(i = 1; i < n; i++){
+                if(phase <= 0)
+                    phase = phase + 1.;
+                if(phase >= 1)
+                    phase = phase - 1.;
+                out[i] = phase;
+                if(step)
+                    step[i] = phase_step;
+                phase = phase + phase_step;
+            }
+        }
+    }
+    o->o_phase = phase;
+    o->o_last_phase_offset = last_phase_offset;
+}
+
+void osc_perform(t_osc *o, void *x, t_osc_shapefn fn, t_float *freq, t_float *sync,
+t_float *offset, t_float *out, int n){
+    double phase[OSC_CHUNK];
+    while(n > 0){ // a chunk's inputs are read before its output is written, 'out' may be an input
+        int m = n < OSC_CHUNK ? n : OSC_CHUNK;
+        osc_phase(o, freq, sync, offset, phase, NULL, m);
+        fn(x, phase, out, m);
+        freq += m;
+        offset += m;
+        if(sync)
+            sync += m;
+        out += m;
+        n -= m;
+    }
+}
+
+// minimax fit of sin(2*pi*r) for r in [-0.25, 0.25], odd powers of r
+#define OSC_S1   6.28318530717722853202
+#define OSC_S3  -41.3417022389895442158
+#define OSC_S5   81.6052490320559433465
+#define OSC_S7  -76.7058411297550764366
+#define OSC_S9   42.0579638749634083239
+#define OSC_S11 -15.0792949143043204215
+#define OSC_S13  3.65508391939349206986
+
+// no calls or branches, so the loop vectorizes
+static void osc_polysin(double *phase, t_float *out, int n, double shift){
+    int i;
+    for(i = 0; i < n; i++){
+        double p = phase[i] + shift;
+        // nearest integer, phases stay within a cycle or so of [0, 1]
+        double r = p - (double)((int)(p + 1024.5) - 1024);
+        // fold into a quarter cycle, sin(2pi(1/2 - r)) = sin(2pi r)
+        r = copysign(0.25 - fabs(fabs(r) - 0.25), r);
+        double s = r * r;
+        out[i] = r * (OSC_S1 + s * (OSC_S3 + s * (OSC_S5 + s * (OSC_S7 +
+            s * (OSC_S9 + s * (OSC_S11 + s * OSC_S13))))));
+    }
+}
+
+void osc_sin(double *phase, t_float *out, int n, int precise){
+    int i;
+    if(precise){
+        for(i = 0; i < n; i++)
+            out[i] = sin(phase[i] * OSC_TWOPI);
+    }
+    else
+        osc_polysin(phase, out, n, 0);
+}
+
+void osc_cos(double *phase, t_float *out, int n, int precise){
+    int i;
+    if(precise){
+        for(i = 0; i < n; i++)
+            out[i] = cos(phase[i] * OSC_TWOPI);
+    }
+    else // cos(2pi p) = sin(2pi(p + 1/4))
+        osc_polysin(phase, out, n, 0.25);
+}
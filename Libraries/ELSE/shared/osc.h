@@ -0,0 +1,36 @@
+#ifndef __osc_H__
+#define __osc_H__
+
+// oscillator core shared by sine~, cosine~, saw~, tri~, wavetable~, wt~ and the bl.* oscillators.
+// The phase of a chunk of samples is computed first, with the same frequency, sync and phase
+// offset rules for all of them, then each object turns the whole chunk into its waveform in a
+// loop the compiler can vectorize.
+
+#define OSC_CHUNK 64
+
+typedef struct _osc{
+    double  o_phase;
+    double  o_last_phase_offset;
+    double  o_sr;
+}t_osc;
+
+// turns the phases of a chunk into output samples, 'x' is the object
+typedef void (*t_osc_shapefn)(void *x, double *phase, t_float *out, int n);
+
+void osc_init(t_osc *o, double phase);
+// 'sync' is NULL when nothing is connected to the sync inlet
+void osc_perform(t_osc *o, void *x, t_osc_shapefn fn, t_float *freq, t_float *sync,
+    t_float *offset, t_float *out, int n);
+
+// just the phases of a chunk, for objects that need more than a waveform per sample. 'step' gets
+// the increment from each sample to the next one (it can be NULL), so a sample's phase is the
+// previous one plus its step, wrapped into [0, 1), unless it was synced or the offset moved
+void osc_phase(t_osc *o, t_float *freq, t_float *sync, t_float *offset, double *phase,
+    double *step, int n);
+
+// sine and cosine of the phases (in cycles). A polynomial is used unless 'precise' is set,
+// its error is below 4e-14, so it only shows with 64 bit floats, where libm can be chosen
+void osc_sin(double *phase, t_float *out, int n, int precise);
+void osc_cos(double *phase, t_float *out, int n, int precise);
+
+#endif
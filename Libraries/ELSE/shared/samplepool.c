@@ -0,0 +1,187 @@
+// memory-mapped sound files shared by the whole process, see samplepool.h
+
+#include "m_pd.h"
+#include "d_soundfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#define samplepool_stat _stat64
+#define samplepool_fstat _fstat64
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#define samplepool_stat stat
+#define samplepool_fstat fstat
+#endif
+#include "samplepool.h"
+
+#define SAMPLEPOOL_PRELOAD (256 * 1024) // bytes read ahead when a file is mapped
+
+// the files are shared by all pd instances, which may run in different threads
+static t_poolfile *samplepool_list;
+static pthread_mutex_t samplepool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static char *samplepool_resolve(const char *dir, const char *name){
+    char path[MAXPDSTRING];
+    snprintf(path, MAXPDSTRING, "%s/%s", dir, name);
+#ifdef _WIN32
+    return(_fullpath(NULL, path, 0));
+#else
+    return(realpath(path, NULL));
+#endif
+}
+
+static int samplepool_map(t_poolfile *f, int fd){
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA((HANDLE)_get_osfhandle(fd), NULL, PAGE_READONLY, 0, 0, NULL);
+    if(!mapping)
+        return(0);
+    f->f_map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!f->f_map){
+        CloseHandle(mapping);
+        return(0);
+    }
+    f->f_mapping = mapping;
+#else
+    f->f_map = mmap(NULL, f->f_maplen, PROT_READ, MAP_SHARED, fd, 0);
+    if(f->f_map == MAP_FAILED){
+        f->f_map = NULL;
+        return(0);
+    }
+#endif
+    return(1);
+}
+
+static void samplepool_unmap(t_poolfile *f){
+#ifdef _WIN32
+    UnmapViewOfFile(f->f_map);
+    CloseHandle((HANDLE)f->f_mapping);
+#else
+    munmap(f->f_map, f->f_maplen);
+#endif
+}
+
+// the start of the samples, so the first notes played don't wait for the disk
+static void samplepool_preload(t_poolfile *f){
+#ifndef _WIN32
+    size_t start = (size_t)(f->f_data - (const unsigned char *)f->f_map);
+    size_t page = (size_t)sysconf(_SC_PAGESIZE), len = f->f_maplen - start;
+    if(len > SAMPLEPOOL_PRELOAD)
+        len = SAMPLEPOOL_PRELOAD;
+    madvise((char *)f->f_map + start / page * page, len + start % page, MADV_WILLNEED);
+#endif
+}
+
+static t_poolfile *samplepool_load(t_canvas *canvas, const char *name, char *path){
+    t_soundfile sf;
+    struct samplepool_stat st;
+    t_poolfile *f;
+    size_t bytes;
+    int fd = open_soundfile_via_canvas(canvas, name, &sf, 0);
+    if(fd < 0)
+        return(NULL);
+    if(samplepool_fstat(fd, &st) < 0 || (sf.sf_bytespersample != 2 && sf.sf_bytespersample != 3
+    && sf.sf_bytespersample != 4) || (long long)st.st_size <= (long long)sf.sf_headersize){
+        sys_close(fd);
+        return(NULL);
+    }
+    for(f = samplepool_list; f; f = f->f_next){ // already open and unchanged
+        if(!strcmp(f->f_path, path) && f->f_size == (long long)st.st_size
+        && f->f_mtime == (long long)st.st_mtime){
+            f->f_refcount++;
+            sys_close(fd);
+            free(path);
+            return(f);
+        }
+    }
+    f = (t_poolfile *)getbytes(sizeof(t_poolfile));
+    f->f_maplen = (size_t)st.st_size;
+    if(!samplepool_map(f, fd)){
+        sys_close(fd);
+        freebytes(f, sizeof(t_poolfile));
+        return(NULL);
+    }
+    sys_close(fd); // the mapping keeps the file
+    bytes = f->f_maplen - sf.sf_headersize;
+    if(bytes > sf.sf_bytelimit)
+        bytes = sf.sf_bytelimit;
+    f->f_path = path;
+    f->f_size = (long long)st.st_size;
+    f->f_mtime = (long long)st.st_mtime;
+    f->f_refcount = 1;
+    f->f_data = (const unsigned char *)f->f_map + sf.sf_headersize;
+    f->f_nframes = (long)(bytes / sf.sf_bytesperframe);
+    f->f_nchannels = sf.sf_nchannels;
+    f->f_bytespersample = sf.sf_bytespersample;
+    f->f_bytesperframe = sf.sf_bytesperframe;
+    f->f_bigendian = sf.sf_bigendian;
+    f->f_sr = sf.sf_samplerate;
+    f->f_next = samplepool_list;
+    samplepool_list = f;
+    samplepool_preload(f);
+    return(f);
+}
+
+t_poolfile *samplepool_open(t_canvas *canvas, const char *name){
+    char dir[MAXPDSTRING], *filename, *path;
+    t_poolfile *f;
+    int fd = canvas_open(canvas, name, "", dir, &filename, MAXPDSTRING, 1);
+    if(fd < 0)
+        return(NULL);
+    sys_close(fd);
+    if(!(path = samplepool_resolve(dir, filename)))
+        return(NULL);
+    pthread_mutex_lock(&samplepool_mutex);
+    f = samplepool_load(canvas, name, path);
+    pthread_mutex_unlock(&samplepool_mutex);
+    if(!f)
+        free(path);
+    return(f);
+}
+
+void samplepool_close(t_poolfile *f){
+    t_poolfile **p;
+    pthread_mutex_lock(&samplepool_mutex);
+    if(--f->f_refcount == 0){
+        for(p = &samplepool_list; *p != f; p = &(*p)->f_next)
+            ;
+        *p = f->f_next;
+        samplepool_unmap(f);
+        free(f->f_path);
+        freebytes(f, sizeof(t_poolfile));
+    }
+    pthread_mutex_unlock(&samplepool_mutex);
+}
+
+void samplepool_read(const t_poolfile *f, int ch, long frame, int n, t_float *out){
+    const unsigned char *p = f->f_data + (size_t)frame * f->f_bytesperframe
+        + ch * f->f_bytespersample;
+    int i, stride = f->f_bytesperframe;
+    if(f->f_bytespersample == 2){
+        for(i = 0; i < n; i++, p += stride)
+            out[i] = (short)(f->f_bigendian ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0])
+                * (1. / 32768.);
+    }
+    else if(f->f_bytespersample == 3){
+        for(i = 0; i < n; i++, p += stride){
+            unsigned int u = f->f_bigendian ?
+                ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) :
+                ((unsigned int)p[2] << 24) | (p[1] << 16) | (p[0] << 8);
+            out[i] = (int)u * (1. / 2147483648.);
+        }
+    }
+    else{
+        for(i = 0; i < n; i++, p += stride){
+            union{unsigned int u; float f;} v;
+            v.u = f->f_bigendian ?
+                ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3] :
+                ((unsigned int)p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+            out[i] = v.f;
+        }
+    }
+}
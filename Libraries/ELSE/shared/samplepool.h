@@ -0,0 +1,36 @@
+#ifndef __samplepool_H__
+#define __samplepool_H__
+
+// read-only sound files shared by the whole process. A file is memory-mapped instead of loaded
+// into an array, so only the parts that get played take RAM, and the system can drop them again.
+// Opening a file that's already open (from any object or pd instance) gives the same mapping.
+
+#include <stddef.h>
+
+typedef struct _poolfile{
+    struct _poolfile *f_next;
+    char            *f_path;            // where it was found, resolved
+    long long        f_size;            // with the modification time, to tell if the file changed
+    long long        f_mtime;
+    int              f_refcount;
+    void            *f_map;             // the whole file
+    size_t           f_maplen;
+#ifdef _WIN32
+    void            *f_mapping;
+#endif
+    const unsigned char *f_data;        // the first frame
+    long             f_nframes;
+    int              f_nchannels;
+    int              f_bytespersample;  // 2 or 3 for integers, 4 for floats
+    int              f_bytesperframe;
+    int              f_bigendian;
+    t_float          f_sr;
+}t_poolfile;
+
+// finds the file in the canvas's path like soundfiler does, returns NULL if it can't be read
+t_poolfile *samplepool_open(t_canvas *canvas, const char *name);
+void samplepool_close(t_poolfile *f);
+// 'n' frames of a channel from 'frame' on, which must all be in the file
+void samplepool_read(const t_poolfile *f, int ch, long frame, int n, t_float *out);
+
+#endif
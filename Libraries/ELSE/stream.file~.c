@@ -0,0 +1,428 @@
+// plays sound files of any length from disk, a background thread reads ahead into a ring buffer
+
+#include "m_pd.h"
+#include "d_soundfile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+
+#define STREAM_RING     65536   // frames read ahead, a power of 2
+#define STREAM_CHUNK    4096    // most frames read at once
+#define STREAM_MAXCH    64
+#define STREAM_MAXSPEED 8.      // times the file's own rate
+
+// the ring's positions are only written by one side each, these make a write visible to the
+// other side after the data it covers
+#ifdef _MSC_VER
+#define stream_load(p)      InterlockedCompareExchange((volatile long *)(p), 0, 0)
+#define stream_store(p, v)  InterlockedExchange((volatile long *)(p), (v))
+#else
+#define stream_load(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define stream_store(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+static t_class *stream_class;
+
+typedef struct _stream{
+    t_object        x_obj;
+    int             x_nch;
+    t_float        *x_ring[STREAM_MAXCH];
+    volatile long   x_read;         // next frame to play, moved by the perform routine
+    volatile long   x_write;        // next frame to fill, moved by the thread
+    volatile long   x_ready;        // the request the ring has data for
+    volatile long   x_eof;          // no more frames for it
+    volatile long   x_failed;       // couldn't read the file
+    volatile long   x_loop;
+    long            x_request;      // the request the perform routine waits for
+    double          x_frac;
+    double          x_speed;
+    t_float         x_sr;
+    t_float         x_filesr;       // from the thread, valid once x_ready is x_request
+    int             x_playing;
+    int             x_underruns;
+    int             x_underrun;     // in one now
+    int             x_reported;
+    int             x_done;
+    // the request, under the mutex
+    char           *x_dir;
+    char           *x_file;
+    int             x_open;
+    t_float         x_onset;        // in ms
+    long            x_asked;
+    int             x_quit;
+    pthread_t       x_thread;
+    pthread_mutex_t x_mutex;
+    pthread_cond_t  x_cond;
+    t_canvas       *x_canvas;
+    t_clock        *x_clock;
+    t_outlet       *x_donelet;
+}t_stream;
+
+/////////////////////////////////////// thread ///////////////////////////////////////
+
+// what's free in the ring, the last frame is left empty to tell full from empty
+static long stream_space(t_stream *x){
+    return((stream_load(&x->x_read) - x->x_write - 1) & (STREAM_RING - 1));
+}
+
+// fills what's free in the ring from the file, returns 0 at its end
+static int stream_fill(t_stream *x, t_soundfile *sf, unsigned char *buf, t_float **vecs){
+    long write = x->x_write, frames = stream_space(x);
+    int ch, nch = sf->sf_nchannels < x->x_nch ? sf->sf_nchannels : x->x_nch;
+    if(frames > STREAM_RING - write) // up to the end of the ring, the rest next time
+        frames = STREAM_RING - write;
+    if(frames > STREAM_CHUNK)
+        frames = STREAM_CHUNK;
+    if(frames > (long)(sf->sf_bytelimit / sf->sf_bytesperframe))
+        frames = (long)(sf->sf_bytelimit / sf->sf_bytesperframe);
+    if(frames <= 0)
+        return(sf->sf_bytelimit >= sf->sf_bytesperframe);
+    int got = (int)read(sf->sf_fd, buf, (unsigned)(frames * sf->sf_bytesperframe));
+    if(got < sf->sf_bytesperframe)
+        return(0);
+    frames = got / sf->sf_bytesperframe;
+    sf->sf_bytelimit -= frames * sf->sf_bytesperframe;
+    for(ch = 0; ch < nch; ch++)
+        vecs[ch] = x->x_ring[ch];
+    soundfile_xferin_float(sf, nch, vecs, write, buf, frames);
+    for(ch = nch; ch < x->x_nch; ch++)
+        memset(x->x_ring[ch] + write, 0, frames * sizeof(t_float));
+    stream_store(&x->x_write, (write + frames) & (STREAM_RING - 1));
+    return(1);
+}
+
+// frames that aren't from the file, before the start and after the end, for the interpolation
+static void stream_pad(t_stream *x, int frames){
+    long write = x->x_write;
+    for(int i = 0; i < frames; i++, write = (write + 1) & (STREAM_RING - 1))
+        for(int ch = 0; ch < x->x_nch; ch++)
+            x->x_ring[ch][write] = 0;
+    stream_store(&x->x_write, write);
+}
+
+// 'pad' puts a silent frame before the first one when it starts from the beginning
+static int stream_open(t_stream *x, const char *dir, const char *file, t_float onset, int pad,
+t_soundfile *sf){
+    size_t skip = 0;
+    if(sf->sf_fd >= 0)
+        sys_close(sf->sf_fd);
+    // the file's rate comes from the header, so it's opened once to get it if there's an onset
+    if(onset > 0 && open_soundfile_via_namelist(dir, file, NULL, sf, 0) >= 0){
+        skip = (size_t)(onset * 0.001 * sf->sf_samplerate);
+        sys_close(sf->sf_fd);
+    }
+    sf->sf_fd = open_soundfile_via_namelist(dir, file, NULL, sf, skip ? skip - 1 : 0);
+    if(sf->sf_fd < 0)
+        return(0);
+    x->x_filesr = sf->sf_samplerate;
+    if(!skip && pad)
+        stream_pad(x, 1);
+    return(1);
+}
+
+static void *stream_thread(void *arg){
+    t_stream *x = (t_stream *)arg;
+    t_soundfile sf;
+    unsigned char *buf = NULL;
+    size_t bufsize = 0;
+    t_float *vecs[STREAM_MAXCH];
+    char *dir = NULL, *file = NULL;
+    long request = 0;
+    int reading = 0, ending = 0;
+    sf.sf_fd = -1;
+    pthread_mutex_lock(&x->x_mutex);
+    while(!x->x_quit){
+        if(x->x_asked != request){ // open or seek, the perform routine isn't reading now
+            t_float onset = x->x_onset;
+            request = x->x_asked;
+            if(x->x_open){
+                free(dir), free(file);
+                dir = strdup(x->x_dir), file = strdup(x->x_file);
+                x->x_open = 0;
+            }
+            pthread_mutex_unlock(&x->x_mutex);
+            stream_store(&x->x_write, stream_load(&x->x_read)); // empties the ring
+            stream_store(&x->x_eof, 0);
+            reading = file && stream_open(x, dir, file, onset, 1, &sf);
+            ending = 0;
+            stream_store(&x->x_failed, !reading);
+            if(reading && bufsize < (size_t)(STREAM_CHUNK * sf.sf_bytesperframe)){
+                free(buf);
+                buf = (unsigned char *)malloc(bufsize = STREAM_CHUNK * sf.sf_bytesperframe);
+            }
+            if(!reading)
+                stream_store(&x->x_eof, 1);
+            stream_store(&x->x_ready, request);
+            pthread_mutex_lock(&x->x_mutex);
+            continue;
+        }
+        if(reading && stream_space(x) > 0){
+            pthread_mutex_unlock(&x->x_mutex);
+            if(!stream_fill(x, &sf, buf, vecs)){
+                // a loop goes on from the start, right after the last frame
+                if(!stream_load(&x->x_loop) || !stream_open(x, dir, file, 0, 0, &sf))
+                    reading = 0, ending = 1;
+            }
+            pthread_mutex_lock(&x->x_mutex);
+            continue;
+        }
+        if(ending && stream_space(x) >= 3){ // silent frames to play the last ones with
+            stream_pad(x, 3);
+            stream_store(&x->x_eof, 1);
+            ending = 0;
+            continue;
+        }
+        pthread_cond_wait(&x->x_cond, &x->x_mutex);
+    }
+    pthread_mutex_unlock(&x->x_mutex);
+    if(sf.sf_fd >= 0)
+        sys_close(sf.sf_fd);
+    free(buf), free(dir), free(file);
+    return(NULL);
+}
+
+// from the perform routine, which doesn't wait for the lock: if it's taken the thread is awake
+static void stream_wake(t_stream *x){
+    if(!pthread_mutex_trylock(&x->x_mutex)){
+        pthread_cond_signal(&x->x_cond);
+        pthread_mutex_unlock(&x->x_mutex);
+    }
+}
+
+/////////////////////////////////////// object ///////////////////////////////////////
+
+// the thread starts over from 'onset' (in ms), and the ring is ignored until it did
+static void stream_ask(t_stream *x, t_float onset){
+    pthread_mutex_lock(&x->x_mutex);
+    x->x_onset = onset < 0 ? 0 : onset;
+    x->x_asked = ++x->x_request;
+    pthread_cond_signal(&x->x_cond);
+    pthread_mutex_unlock(&x->x_mutex);
+    x->x_frac = 0;
+    x->x_done = 0;
+}
+
+static void stream_tick(t_stream *x){
+    if(stream_load(&x->x_failed) && !x->x_reported){
+        pd_error(x, "[stream.file~]: can't read file");
+        x->x_reported = 1;
+    }
+    if(x->x_underruns){
+        pd_error(x, "[stream.file~]: %d underrun%s, the disk isn't keeping up", x->x_underruns,
+            x->x_underruns > 1 ? "s" : "");
+        x->x_underruns = 0;
+    }
+    if(x->x_done){
+        x->x_done = 0;
+        outlet_bang(x->x_donelet);
+    }
+}
+
+static void stream_open_file(t_stream *x, t_symbol *s){
+    char dir[MAXPDSTRING], *file;
+    int fd = canvas_open(x->x_canvas, s->s_name, "", dir, &file, MAXPDSTRING, 1);
+    if(fd < 0){
+        pd_error(x, "[stream.file~]: can't open '%s'", s->s_name);
+        return;
+    }
+    sys_close(fd);
+    pthread_mutex_lock(&x->x_mutex);
+    free(x->x_dir), free(x->x_file);
+    x->x_dir = strdup(dir), x->x_file = strdup(file);
+    x->x_open = 1;
+    pthread_mutex_unlock(&x->x_mutex);
+    x->x_reported = 0;
+    x->x_playing = 0;
+    stream_ask(x, 0);
+}
+
+static void stream_play(t_stream *x){
+    if(!x->x_file){ // only changed from here, it doesn't need the lock
+        pd_error(x, "[stream.file~]: no file to play");
+        return;
+    }
+    stream_ask(x, 0);
+    x->x_playing = 1;
+}
+
+static void stream_stop(t_stream *x){
+    if(x->x_playing){
+        x->x_playing = 0;
+        outlet_bang(x->x_donelet);
+    }
+}
+
+static void stream_float(t_stream *x, t_floatarg f){
+    f != 0 ? stream_play(x) : stream_stop(x);
+}
+
+static void stream_seek(t_stream *x, t_floatarg f){
+    stream_ask(x, f);
+}
+
+static void stream_pause(t_stream *x){
+    x->x_playing = 0;
+}
+
+static void stream_resume(t_stream *x){
+    x->x_playing = 1;
+}
+
+static void stream_loop(t_stream *x, t_floatarg f){
+    stream_store(&x->x_loop, f != 0);
+}
+
+static void stream_speed(t_stream *x, t_floatarg f){ // in percent, like tabplayer~
+    x->x_speed = f < 0 ? 0 : f * 0.01 > STREAM_MAXSPEED ? STREAM_MAXSPEED : f * 0.01;
+}
+
+static t_int *stream_perform(t_int *w){
+    t_stream *x = (t_stream *)(w[1]);
+    int n = (int)(w[2]), i = 0, ch;
+    t_float **outs = (t_float **)(w + 3);
+    if(x->x_playing && stream_load(&x->x_ready) == x->x_request){
+        long pos = x->x_read;
+        long avail = (stream_load(&x->x_write) - pos) & (STREAM_RING - 1);
+        double frac = x->x_frac, inc = x->x_speed * x->x_filesr / x->x_sr;
+        for(; i < n; i++){
+            if(avail < 4){ // the interpolation needs the frames around the one playing
+                int eof = (int)stream_load(&x->x_eof); // before the position, which is final then
+                avail = (stream_load(&x->x_write) - pos) & (STREAM_RING - 1);
+                if(avail < 4){
+                    if(eof){
+                        x->x_playing = 0;
+                        x->x_done = 1;
+                        clock_delay(x->x_clock, 0);
+                    }
+                    else if(!x->x_underrun){
+                        x->x_underrun = 1;
+                        x->x_underruns++;
+                        clock_delay(x->x_clock, 0);
+                    }
+                    break;
+                }
+            }
+            x->x_underrun = 0;
+            for(ch = 0; ch < x->x_nch; ch++){ // lagrange, like tabplayer~
+                t_float *ring = x->x_ring[ch];
+                t_float a = ring[pos], b = ring[(pos + 1) & (STREAM_RING - 1)];
+                t_float c = ring[(pos + 2) & (STREAM_RING - 1)];
+                t_float d = ring[(pos + 3) & (STREAM_RING - 1)];
+                t_float cmb = c - b, f = frac;
+                outs[ch][i] = b + f * (cmb - (1. - f) / 6. * ((d - a - 3.0 * cmb) * f + d + 2.0 * a
+                    - 3.0 * b));
+            }
+            frac += inc;
+            long adv = (long)frac;
+            if(adv > avail - 3)
+                adv = avail - 3;
+            frac -= adv;
+            pos = (pos + adv) & (STREAM_RING - 1);
+            avail -= adv;
+        }
+        x->x_frac = frac;
+        stream_store(&x->x_read, pos);
+        stream_wake(x);
+    }
+    else if(stream_load(&x->x_failed) && stream_load(&x->x_ready) == x->x_request && !x->x_reported)
+        clock_delay(x->x_clock, 0);
+    for(ch = 0; ch < x->x_nch; ch++)
+        memset(outs[ch] + i, 0, (n - i) * sizeof(t_float));
+    return(w + 3 + x->x_nch);
+}
+
+static void stream_dsp(t_stream *x, t_signal **sp){
+    x->x_sr = sp[0]->s_sr;
+    t_int *vec = (t_int *)getbytes((x->x_nch + 2) * sizeof(t_int));
+    vec[0] = (t_int)x;
+    vec[1] = (t_int)sp[0]->s_n;
+    for(int ch = 0; ch < x->x_nch; ch++)
+        vec[ch + 2] = (t_int)sp[ch]->s_vec;
+    dsp_addv(stream_perform, x->x_nch + 2, vec);
+    freebytes(vec, (x->x_nch + 2) * sizeof(t_int));
+}
+
+static void stream_free(t_stream *x){
+    pthread_mutex_lock(&x->x_mutex);
+    x->x_quit = 1;
+    pthread_cond_signal(&x->x_cond);
+    pthread_mutex_unlock(&x->x_mutex);
+    pthread_join(x->x_thread, NULL);
+    pthread_cond_destroy(&x->x_cond);
+    pthread_mutex_destroy(&x->x_mutex);
+    for(int ch = 0; ch < x->x_nch; ch++)
+        freebytes(x->x_ring[ch], STREAM_RING * sizeof(t_float));
+    free(x->x_dir), free(x->x_file);
+    clock_free(x->x_clock);
+}
+
+static void *stream_new(t_symbol *s, int ac, t_atom *av){
+    t_stream *x = (t_stream *)pd_new(stream_class);
+    t_symbol *file = NULL;
+    int loop = 0;
+    x->x_nch = 1;
+    x->x_speed = 1;
+    while(ac){
+        if(av->a_type == A_SYMBOL){
+            s = atom_getsymbolarg(0, ac, av);
+            if(s == gensym("-loop"))
+                loop = 1, ac--, av++;
+            else if(s == gensym("-speed") && ac >= 2){
+                stream_speed(x, atom_getfloatarg(1, ac, av));
+                ac -= 2, av += 2;
+            }
+            else if(!file)
+                file = s, ac--, av++;
+            else
+                goto errstate;
+        }
+        else{
+            int n = (int)atom_getfloatarg(0, ac, av);
+            x->x_nch = n < 1 ? 1 : n > STREAM_MAXCH ? STREAM_MAXCH : n;
+            ac--, av++;
+        }
+    }
+    x->x_loop = loop;
+    x->x_sr = sys_getsr();
+    x->x_filesr = x->x_sr;
+    x->x_canvas = canvas_getcurrent();
+    x->x_clock = clock_new(x, (t_method)stream_tick);
+    for(int ch = 0; ch < x->x_nch; ch++){
+        x->x_ring[ch] = (t_float *)getbytes(STREAM_RING * sizeof(t_float));
+        outlet_new(&x->x_obj, &s_signal);
+    }
+    x->x_donelet = outlet_new(&x->x_obj, &s_bang);
+    pthread_mutex_init(&x->x_mutex, NULL);
+    pthread_cond_init(&x->x_cond, NULL);
+    pthread_create(&x->x_thread, NULL, stream_thread, x);
+    if(file)
+        stream_open_file(x, file);
+    return(x);
+errstate:
+    pd_error(x, "[stream.file~]: improper args");
+    return(NULL);
+}
+
+void setup_stream0x2efile_tilde(void){
+    stream_class = class_new(gensym("stream.file~"), (t_newmethod)stream_new,
+        (t_method)stream_free, sizeof(t_stream), 0, A_GIMME, 0);
+    class_addbang(stream_class, stream_play);
+    class_addfloat(stream_class, stream_float);
+    class_addmethod(stream_class, (t_method)stream_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(stream_class, (t_method)stream_open_file, gensym("open"), A_SYMBOL, 0);
+    class_addmethod(stream_class, (t_method)stream_play, gensym("play"), 0);
+    class_addmethod(stream_class, (t_method)stream_stop, gensym("stop"), 0);
+    class_addmethod(stream_class, (t_method)stream_pause, gensym("pause"), 0);
+    class_addmethod(stream_class, (t_method)stream_resume, gensym("resume"), 0);
+    class_addmethod(stream_class, (t_method)stream_seek, gensym("seek"), A_FLOAT, 0);
+    class_addmethod(stream_class, (t_method)stream_loop, gensym("loop"), A_FLOAT, 0);
+    class_addmethod(stream_class, (t_method)stream_speed, gensym("speed"), A_FLOAT, 0);
+}
@@ -4,6 +4,7 @@
 #include "m_pd.h"
 #include "shared/magic.h"
 #include "shared/buffer.h"
+#include "shared/samplepool.h"
 #include <stdlib.h>
 
 #define HALF_PI (3.14159265358979323846 * 0.5)
@@ -129,6 +130,20 @@ static void tabplayer_set(t_play *x, t_symbol *s){
     tabplayer_range(x, x->x_range_start, x->x_range_end);
 }
 
+// plays a sound file from the shared pool instead of arrays, at its own sample rate
+static void tabplayer_open(t_play *x, t_symbol *s){
+    if(!buffer_setfile(x->x_buffer, x->x_glist, s)){
+        pd_error(x, "[tabplayer~]: can't open '%s'", s->s_name);
+        return;
+    }
+    x->x_npts = x->x_buffer->c_npts;
+    x->x_array_sr_khz = x->x_buffer->c_file->f_sr * 0.001;
+    if(x->x_array_sr_khz < 8)
+        x->x_array_sr_khz = 8;
+    x->x_sr_ratio = x->x_array_sr_khz/x->x_sr_khz;
+    tabplayer_range(x, x->x_range_start, x->x_range_end);
+}
+
 static void tabplayer_pos(t_play *x, t_floatarg f){
     x->x_position = 1;
     double position = f < 0 ? 0 : f > 1 ? 1 : (double)f;
@@ -237,9 +252,10 @@ static double tabplayer_fade_gain(t_play *x, double phase){
 
 static double tabplayer_interp(t_play *x, int ch, double phase){
     double out = 0.;
+    t_poolfile *file = x->x_buffer->c_file;
     t_word **vectable = x->x_buffer->c_vectors; // ??
     t_word *vp = vectable[ch]; // ??
-    if(vp){
+    if(vp || (file && ch < file->f_nchannels && x->x_npts > 3)){
         float f,  a,  b,  c,  d, cmb;
         int maxindex = x->x_npts - 3;
         if(phase < 0 || phase > maxindex)
@@ -255,11 +271,18 @@ static double tabplayer_interp(t_play *x, int ch, double phase){
         }
         else
             f = phase - ndx;
-        vp += ndx;
-        a = vp[-1].w_float;
-        b = vp[0].w_float;
-        c = vp[1].w_float;
-        d = vp[2].w_float;
+        if(file){
+            t_float p[4];
+            samplepool_read(file, ch, ndx - 1, 4, p);
+            a = p[0], b = p[1], c = p[2], d = p[3];
+        }
+        else{
+            vp += ndx;
+            a = vp[-1].w_float;
+            b = vp[0].w_float;
+            c = vp[1].w_float;
+            d = vp[2].w_float;
+        }
         cmb = c-b;
         out = b + f*(cmb - ONE_SIXTH*(1.-f)*((d - a - 3.0f*cmb)*f + (d + 2.0f*a - 3.0f*b)));
     }
@@ -389,6 +412,7 @@ static void *tabplayer_free(t_play *x){
 static void *tabplayer_new(t_symbol * s, int ac, t_atom *av){
     t_play *x = (t_play *)pd_new(tabplayer_class);
     t_symbol *arrname = NULL;
+    t_symbol *filename = NULL;
     t_float channels = 1;
     t_float fade = 0;
     t_float range_start = 0;
@@ -424,6 +448,10 @@ static void *tabplayer_new(t_symbol * s, int ac, t_atom *av){
                 x->x_rate = (double)atom_getfloatarg(1, ac, av) * 0.01;
                 ac-=2, av+=2;
             }
+            else if(s == gensym("-file") && ac >= 2){
+                filename = atom_getsymbolarg(1, ac, av);
+                ac-=2, av+=2;
+            }
             else if(s == gensym("-range") && ac >= 3){
                 range_start = atom_getfloatarg(1, ac, av);
                 range_end = atom_getfloatarg(2, ac, av);
@@ -438,7 +466,7 @@ static void *tabplayer_new(t_symbol * s, int ac, t_atom *av){
                 goto errstate;
         }
         else{
-            if(nameset){
+            if(nameset || filename){
                 channels = atom_getfloatarg(0, ac, av);
                 ac--, av++;
             }
@@ -465,6 +493,8 @@ static void *tabplayer_new(t_symbol * s, int ac, t_atom *av){
         x->x_playnew = 0;
         tabplayer_range(x, range_start, range_end);
         tabplayer_fade(x, fade);
+        if(filename)
+            tabplayer_open(x, filename);
     }
     return(x);
     errstate:
@@ -480,6 +510,7 @@ void tabplayer_tilde_setup(void){
     class_addfloat(tabplayer_class, tabplayer_float);
     class_addmethod(tabplayer_class, (t_method)tabplayer_dsp, gensym("dsp"), A_CANT, 0);
     class_addmethod(tabplayer_class, (t_method)tabplayer_set, gensym("set"), A_SYMBOL, 0);
+    class_addmethod(tabplayer_class, (t_method)tabplayer_open, gensym("open"), A_SYMBOL, 0);
     class_addmethod(tabplayer_class, (t_method)tabplayer_pos, gensym("pos"), A_FLOAT, 0);
     class_addmethod(tabplayer_class, (t_method)tabplayer_play, gensym("play"), A_GIMME, 0);
     class_addmethod(tabplayer_class, (t_method)tabplayer_stop, gensym("stop"), 0);
@@ -3,6 +3,7 @@
 #include "m_pd.h"
 #include "shared/magic.h"
 #include "shared/buffer.h"
+#include "shared/osc.h"
 #include <math.h>
 
 static t_class *wt_class;
@@ -10,13 +11,11 @@ static t_class *wt_class;
 typedef struct _wt{
     t_object  x_obj;
     t_buffer *x_buffer;
-    double    x_phase;
-    double    x_last_phase_offset;
+    t_osc     x_osc;
     t_float   x_freq;
     t_inlet  *x_inlet_phase;
     t_inlet  *x_inlet_sync;
     t_outlet *x_outlet;
-    t_float   x_sr;
 // MAGIC:
     t_glist  *x_glist; // object list
     t_float  *x_signalscalar; // right inlet's float field
@@ -42,6 +41,34 @@ static void wt_set(t_wt *x, t_symbol *s){
     ndx2 = ndx1 + 1; \
     if(ndx2 == endi) ndx2 = starti;
 
+static void wt_shape(t_wt *x, double *ph, t_float *out, int n){
+    t_word *vector = x->x_buffer->c_vectors[0];
+    if(!vector){ // ??? maybe we dont need "playable"?
+        for(int i = 0; i < n; i++)
+            out[i] = 0;
+        return;
+    }
+    t_int start = 0;
+    t_int end = (t_int)(x->x_buffer->c_npts - 1);
+    if(start > end)
+        start = end;
+    int size = end - start + 1;
+    int starti = start;
+    int endi = starti + size;
+    for(int i = 0; i < n; i++){
+        double phase = ph[i];
+        int ndx;
+        INDEX_4PT(); // read table
+        // lagrange interpolation
+        a = (double)vector[ndxm1].w_float;
+        b = (double)vector[ndx].w_float;
+        c = (double)vector[ndx1].w_float;
+        d = (double)vector[ndx2].w_float;
+        double cmb = c-b;
+        out[i] = (t_float)(b+frac*(cmb-(1.-frac)/6. * ((d-a-3.0*cmb) * frac+d+2.0*a-3.0*b)));
+    }
+}
+
 static t_int *wt_perform(t_int *w){
     t_wt *x = (t_wt *)(w[1]);
     int n = (t_int)(w[2]);
@@ -49,62 +76,21 @@ static t_int *wt_perform(t_int *w){
 //    t_float *in2 = (t_float *)(w[4]); // sync
     t_float *in3 = (t_float *)(w[5]); // phase
     t_float *out = (t_float *)(w[6]);
-    t_word *vector = x->x_buffer->c_vectors[0];
 // Magic Start
     t_float *scalar = x->x_signalscalar;
     if(!magic_isnan(*x->x_signalscalar)){
         t_float input_phase = fmod(*scalar, 1);
         if(input_phase < 0)
             input_phase += 1;
-        x->x_phase = input_phase;
+        x->x_osc.o_phase = input_phase;
         magic_setnan(x->x_signalscalar);
     }
 // Magic End
-    double phase = x->x_phase;
-    double last_phase_offset = x->x_last_phase_offset;
-    double sr = x->x_sr;
-    while(n--){
-        if(x->x_buffer->c_playable){
-            double hz = *in1++;
-            double phase_offset = (double)*in3++;
-            double phase_step = hz / sr; // phase_step
-            phase_step = phase_step > 0.5 ? 0.5 : phase_step < -0.5 ? -0.5 : phase_step; // clipped to nyq
-            double phase_dev = phase_offset - last_phase_offset;
-            if(phase_dev >= 1 || phase_dev <= -1)
-                phase_dev = fmod(phase_dev, 1); // fmod(phase_dev)
-            phase = phase + phase_dev;
-            if(phase <= 0)
-                phase = phase + 1.; // wrap deviated phase
-            if(phase >= 1)
-                phase = phase - 1.; // wrap deviated phase
-            t_int start = 0;
-            t_int end = (t_int)(x->x_buffer->c_npts - 1);
-            if(start > end)
-                start = end;
-            int ndx;
-            int size = end - start + 1;
-            int starti = start;
-            int endi = starti + size;
-            INDEX_4PT(); // read table
-            if(vector){ // lagrange interpolation
-                a = (double)vector[ndxm1].w_float;
-                b = (double)vector[ndx].w_float;
-                c = (double)vector[ndx1].w_float;
-                d = (double)vector[ndx2].w_float;
-                double cmb = c-b;
-                *out++ = (t_float)(b+frac*(cmb-(1.-frac)/6. * ((d-a-3.0*cmb) * frac+d+2.0*a-3.0*b)));
-            }
-            else // ??? maybe we dont need "playable"?
-                *out++ = 0;
-            phase = phase + phase_step; // next phase
-            last_phase_offset = phase_offset; // last phase offset
-        }
-        else
-            *out++ = 0;
-    }
-    x->x_phase = phase;
-    x->x_last_phase_offset = last_phase_offset;
-    return (w + 7);
+    if(x->x_buffer->c_playable)
+        osc_perform(&x->x_osc, x, (t_osc_shapefn)wt_shape, in1, NULL, in3, out, n);
+    else while(n--) // the phase holds
+        *out++ = 0;
+    return(w + 7);
 }
 
 static t_int *wt_perform_sig(t_int *w){
@@ -114,63 +100,17 @@ static t_int *wt_perform_sig(t_int *w){
     t_float *in2 = (t_float *)(w[4]); // sync
     t_float *in3 = (t_float *)(w[5]); // phase
     t_float *out = (t_float *)(w[6]);
-    t_word *vector = x->x_buffer->c_vectors[0];
-    double phase = x->x_phase;
-    double last_phase_offset = x->x_last_phase_offset;
-    double sr = x->x_sr;
-    while(n--){
-        if(x->x_buffer->c_playable){
-            double hz = *in1++;
-            t_float trig = *in2++;
-            double phase_offset = (double)*in3++;
-            double phase_step = hz / sr; // phase_step
-            phase_step = phase_step > 0.5 ? 0.5 : phase_step < -0.5 ? -0.5 : phase_step; // clipped to nyq
-            double phase_dev = phase_offset - last_phase_offset;
-            if(phase_dev >= 1 || phase_dev <= -1)
-                phase_dev = fmod(phase_dev, 1); // fmod(phase_dev)
-            if(trig > 0 && trig <= 1)
-                phase = trig;
-            else{
-                phase = phase + phase_dev;
-                if(phase <= 0)
-                    phase = phase + 1.; // wrap deviated phase
-                if(phase >= 1)
-                    phase = phase - 1.; // wrap deviated phase
-            }
-            t_int start = 0;
-            t_int end = (t_int)(x->x_buffer->c_npts - 1);
-            if(start > end)
-                start = end;
-            int ndx;
-            int size = end - start + 1;
-            int starti = start;
-            int endi = starti + size;
-            INDEX_4PT(); // read table
-            if(vector){ // lagrange interpolation
-                a = (double)vector[ndxm1].w_float;
-                b = (double)vector[ndx].w_float;
-                c = (double)vector[ndx1].w_float;
-                d = (double)vector[ndx2].w_float;
-                double cmb = c-b;
-                *out++ = (t_float)(b+frac*(cmb-(1.-frac)/6. * ((d-a-3.0*cmb) * frac+d+2.0*a-3.0*b)));
-            }
-            else // ??? maybe we dont need "playable"?
-                *out++ = 0;
-            phase += phase_step; // next phase
-            last_phase_offset = phase_offset; // last phase offset
-        }
-        else
-            *out++ = 0;
-    }
-    x->x_phase = phase;
-    x->x_last_phase_offset = last_phase_offset;
+    if(x->x_buffer->c_playable)
+        osc_perform(&x->x_osc, x, (t_osc_shapefn)wt_shape, in1, in2, in3, out, n);
+    else while(n--) // the phase holds
+        *out++ = 0;
     return(w + 7);
 }
 
 static void wt_dsp(t_wt *x, t_signal **sp){
     buffer_checkdsp(x->x_buffer);
     x->x_hasfeeders = magic_inlet_connection((t_object *)x, x->x_glist, 1, &s_signal); // magic feeder flag
-    x->x_sr = sp[0]->s_sr;
+    x->x_osc.o_sr = sp[0]->s_sr;
     if(x->x_hasfeeders){
         dsp_add(wt_perform_sig, 6, x, sp[0]->s_n,
             sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec);
@@ -192,7 +132,8 @@ static void *wt_new(t_symbol *s, int ac, t_atom *av){
     t_symbol *name = s;
     name = NULL;
     int nameset = 0, floatarg = 0;
-    x->x_freq = x->x_phase = x->x_last_phase_offset = 0.;
+    x->x_freq = 0.;
+    osc_init(&x->x_osc, 0.);
     t_float phaseoff = 0;
     while(ac){
         if(av->a_type == A_SYMBOL){
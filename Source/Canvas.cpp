@@ -6,6 +6,10 @@
 #include <m_pd.h>
 #include <m_imp.h>
 
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
 
 #include "Box.h"
 #include "Canvas.h"
@@ -73,34 +77,33 @@ void Canvas::synchronise(bool updatePosition)
 
     patch.setCurrent();
 
-    connections.clear();
-
     auto objects = patch.getObjects();
 
-    auto isObjectDeprecated = [&](pd::Object* obj) {
-        for (auto& pdobj : objects) {
-            if (pdobj == *obj) {
-                return false;
-            }
-        }
-        return true;
-    };
+    // Index of every pd object, so we can match and order boxes without searching
+    std::unordered_map<void*, int> objectIndices;
+    objectIndices.reserve(objects.size());
+    for (int i = 0; i < static_cast<int>(objects.size()); i++) {
+        objectIndices[objects[i].getPointer()] = i;
+    }
 
-    // Clear deleted boxes
+    // Clear deleted boxes, and keep track of the box that belongs to each pd object
+    std::unordered_map<void*, Box*> boxesByObject;
+    boxesByObject.reserve(objects.size());
     for (int n = boxes.size() - 1; n >= 0; n--) {
         auto* box = boxes[n];
-        if (isObjectDeprecated(box->pdObject.get())) {
+        auto* ptr = box->pdObject ? box->pdObject->getPointer() : nullptr;
+        if (!objectIndices.count(ptr)) {
             boxes.remove(n);
+        } else {
+            boxesByObject[ptr] = box;
         }
     }
 
     for (auto& object : objects) {
 
-        auto it = std::find_if(boxes.begin(), boxes.end(), [&object](Box* b) {
-            return b->pdObject.get() != nullptr && *b->pdObject.get() == object;
-        });
+        auto it = boxesByObject.find(object.getPointer());
 
-        if (it == boxes.end()) {
+        if (it == boxesByObject.end()) {
             auto [x, y, w, h] = object.getBounds();
             auto name = String(object.getText());
 
@@ -138,7 +141,7 @@ void Canvas::synchronise(bool updatePosition)
             if (!patch.checkObject(&object))
                 newBox->setVisible(false);
         } else {
-            auto* box = *it;
+            auto* box = it->second;
             auto [x, y, h, w] = object.getBounds();
             
             x += zeroPosition.x;
@@ -164,13 +167,23 @@ void Canvas::synchronise(bool updatePosition)
     }
 
     // Make sure objects have the same order
-    std::sort(boxes.begin(), boxes.end(), [&objects](Box* first, Box* second) mutable {
-        size_t idx1 = std::find(objects.begin(), objects.end(), *first->pdObject.get()) - objects.begin();
-        size_t idx2 = std::find(objects.begin(), objects.end(), *second->pdObject.get()) - objects.begin();
-
-        return idx1 < idx2;
+    std::sort(boxes.begin(), boxes.end(), [&objectIndices](Box* first, Box* second) {
+        return objectIndices.at(first->pdObject->getPointer()) < objectIndices.at(second->pdObject->getPointer());
     });
 
+    // Keep connections that still exist in pd, so we only have to create the new ones
+    using ConnectionKey = std::tuple<void*, int, void*, int>;
+    std::map<ConnectionKey, Connection*> oldConnections;
+    for (int n = connections.size() - 1; n >= 0; n--) {
+        auto* connection = connections[n];
+        // The edges are gone if one of the boxes was deleted
+        if (!connection->start || !connection->end) {
+            connections.remove(n);
+            continue;
+        }
+        oldConnections[{ connection->outObj->get()->getPointer(), connection->outIdx, connection->inObj->get()->getPointer(), connection->inIdx }] = connection;
+    }
+
     t_linetraverser t;
     t_outconnect* oc;
 
@@ -179,17 +192,34 @@ void Canvas::synchronise(bool updatePosition)
     // Get connections from pd
     linetraverser_start(&t, x);
     while ((oc = linetraverser_next(&t))) {
-        int srcno = canvas_getindex(x, &t.tr_ob->ob_g);
-        int sinkno = canvas_getindex(x, &t.tr_ob2->ob_g);
+        auto existing = oldConnections.find({ t.tr_ob, t.tr_outno, t.tr_ob2, t.tr_inno });
+        if (existing != oldConnections.end()) {
+            oldConnections.erase(existing);
+            continue;
+        }
+
+        auto srcIt = objectIndices.find(t.tr_ob);
+        auto sinkIt = objectIndices.find(t.tr_ob2);
+
+        if (srcIt == objectIndices.end() || sinkIt == objectIndices.end())
+            continue;
 
-        auto& srcEdges = boxes[srcno]->edges;
-        auto& sinkEdges = boxes[sinkno]->edges;
+        int srcno = srcIt->second;
+        int sinkno = sinkIt->second;
 
         if (srcno < boxes.size() && sinkno < boxes.size()) {
+            auto& srcEdges = boxes[srcno]->edges;
+            auto& sinkEdges = boxes[sinkno]->edges;
+
             connections.add(new Connection(this, srcEdges[boxes[srcno]->numInputs + t.tr_outno], sinkEdges[t.tr_inno], true));
         }
     }
 
+    // Whatever is left has been removed in pd
+    for (auto& [key, connection] : oldConnections) {
+        connections.removeObject(connection);
+    }
+
     patch.deselectAll();
 
     // Resize canvas to fit objects
@@ -564,6 +594,28 @@ void Canvas::paintOverChildren(Graphics& g)
         findDrawables(g, patch.getPointer());
     }
 
+    // Profiler heatmap: green for cheap objects, red as they take over the DSP chain
+    if (!cpuShares.empty()) {
+        g.setFont(11.0f);
+        for (auto* box : boxes) {
+            if (!box->pdObject)
+                continue;
+
+            auto it = cpuShares.find(box->pdObject->getPointer());
+            if (it == cpuShares.end())
+                continue;
+
+            auto bounds = box->getBounds().reduced(4).toFloat();
+            auto colour = Colours::green.interpolatedWith(Colours::red, std::sqrt(std::min(it->second, 1.0f)));
+
+            g.setColour(colour.withAlpha(0.4f));
+            g.fillRoundedRectangle(bounds, 2.0f);
+
+            g.setColour(Colours::white);
+            g.drawText(String(it->second * 100.0f, 1) + "%", bounds.translated(0, -14).withHeight(14), Justification::bottomRight);
+        }
+    }
+
     // Draw connections in the making over everything else
     if (Edge::connectingEdge && Edge::connectingEdge->box->cnv == this) {
         Point<float> mousePos = getMouseXYRelative().toFloat();
@@ -10,6 +10,7 @@
 #include "Pd/PdPatch.hpp"
 #include "PluginProcessor.h"
 #include <JuceHeader.h>
+#include <unordered_map>
 //==============================================================================
 /*
     This component lives inside our window, and this is where you should put all
@@ -109,6 +110,9 @@ public:
     
     Point<int> zeroPosition = {0, 0};
 
+    // Share of the DSP chain per pd object, drawn as a heatmap while profiling
+    std::unordered_map<void*, float> cpuShares;
+
 private:
     SafePointer<TabbedComponent> tabbar;
 
@@ -29,6 +29,8 @@ GUIComponent::GUIComponent(pd::Gui pdGui, Box* parent)
     sendSymbol = gui.getSendSymbol();
     receiveSymbol = gui.getReceiveSymbol();
 
+    gui.enableUpdateNotifications();
+
     setLookAndFeel(&guiLook);
 }
 
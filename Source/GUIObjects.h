@@ -121,6 +121,12 @@ struct GUIComponent : public Component {
 
     Box* box;
 
+    // True if pd reports value changes for this gui, so it doesn't need to be polled
+    bool pushesUpdates() const noexcept
+    {
+        return gui.pushesUpdates();
+    }
+
 protected:
     const std::string stringGui = std::string("gui");
     const std::string stringMouse = std::string("mouse");
@@ -0,0 +1,298 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+
+#include "../Pd/PdInstance.hpp"
+
+// Command line benchmark for the ELSE signal objects
+// Each object is loaded in a small patch with representative inputs, the patch is computed as fast
+// as the CPU allows and pd::Profiler measures the time the object spends in the DSP chain
+// The results are written as JSON, so runs can be compared to catch regressions
+//
+// Usage: PlugDataBenchmark [-o results.json] [-t ticks] [-r samplerate] [-f filter] [-v]
+
+struct BenchmarkCase {
+    String object;          // As typed in a box
+    StringArray inputs;     // Source of each signal inlet, from left to right
+    StringArray messages;   // Sent to the first inlet on load
+    String setup = {};      // Extra patch lines, like a table the object reads
+};
+
+// A table for the objects that read one, filled on load
+static String const tableSetup = "#N canvas 0 0 450 300 (subpatch) 0;\n#X array benchmark-table 44100 float 0;\n#X restore 400 300 graph;\n";
+
+static std::vector<BenchmarkCase> const benchmarkCases = {
+    // Filters
+    { "lowpass~ 1000 1", { "noise~" }, {} },
+    { "highpass~ 1000 1", { "noise~" }, {} },
+    { "bandpass~ 1000 1", { "noise~" }, {} },
+    { "bandstop~ 1000 1", { "noise~" }, {} },
+    { "lowshelf~ 1000 1 6", { "noise~" }, {} },
+    { "highshelf~ 1000 1 6", { "noise~" }, {} },
+    { "eq~ 1000 1 6", { "noise~" }, {} },
+    { "resonant~ 1000 100", { "noise~" }, {} },
+    { "svfilter~ 1000 1", { "noise~" }, {} },
+    { "allpass.2nd~ 1000 1", { "noise~" }, {} },
+    { "comb.filt~ 100 0.9", { "noise~" }, {} },
+    { "median~ 64", { "noise~" }, {} },
+    { "mov.avg~ 64", { "noise~" }, {} },
+    { "mov.rms~ 64", { "noise~" }, {} },
+
+    // Oscillators
+    { "sine~ 440", {}, {} },
+    { "sine~", { "osc~ 0.5" }, {} },
+    { "cosine~ 440", {}, {} },
+    { "saw~ 440", {}, {} },
+    { "saw2~ 440", {}, {} },
+    { "square~ 440", {}, {} },
+    { "tri~ 440", {}, {} },
+    { "vsaw~ 440", {}, {} },
+    { "parabolic~ 440", {}, {} },
+    { "imp~ 440", {}, {} },
+    { "bl.saw~ 440", {}, {} },
+    { "bl.square~ 440", {}, {} },
+    { "bl.tri~ 440", {}, {} },
+    { "bl.vsaw~ 440 0.5", {}, {} },
+    { "bl.imp~ 440", {}, {} },
+    { "bl.wavetable~ benchmark-table 440", {}, {}, tableSetup },
+    { "pulse~ 440", {}, {} },
+    { "pmosc~ 440 220 1", {}, {} },
+    { "pluck~ 440 0.9", { "impulse~ 2" }, {} },
+
+    // Noise and chaos
+    { "pinknoise~", {}, {} },
+    { "brown~", {}, {} },
+    { "gray~", {}, {} },
+    { "crackle~", {}, {} },
+    { "lfnoise~ 10", {}, {} },
+    { "rampnoise~ 10", {}, {} },
+    { "stepnoise~ 10", {}, {} },
+
+    // Envelopes and control rate helpers
+    { "adsr~ 10 100 0.5 200", {}, { "1" } },
+    { "glide~ 10", { "noise~" }, {} },
+    { "lag~ 10", { "noise~" }, {} },
+    { "sh~", { "noise~", "phasor~ 100" }, {} },
+
+    // Delays and reverbs
+    { "ffdelay~ 100", { "noise~" }, {} },
+    { "fbdelay~ 100 1000", { "noise~" }, {} },
+    { "freq.shift~ 100", { "noise~" }, {} },
+    { "fdn.rev~", { "noise~" }, {} },
+    { "giga.rev~", { "noise~" }, {} },
+    { "conv~ 1024 benchmark-table", { "noise~" }, {}, tableSetup },
+    { "conv~ -zero 1024 benchmark-table", { "noise~" }, {}, tableSetup },
+
+    // Distortion and dynamics
+    { "drive~ 2", { "noise~" }, {} },
+    { "fold~", { "noise~" }, {} },
+    { "quantizer~ 0.1", { "noise~" }, {} },
+    { "downsample~ 1000", { "noise~" }, {} },
+
+    // Routing
+    { "pan2~", { "noise~" }, {} },
+    { "pan4~", { "noise~" }, {} },
+    { "xfade~", { "noise~", "noise~" }, {} },
+    { "mtx~ 8 8", { "noise~", "noise~", "noise~", "noise~", "noise~", "noise~", "noise~", "noise~" },
+        { "0 0 1", "1 1 1", "2 2 1", "3 3 1", "4 4 1", "5 5 1", "6 6 1", "7 7 1" } },
+
+    // Tables
+    { "tabplayer~ benchmark-table", {}, { "loop 1", "play" }, tableSetup },
+};
+
+// The table is filled on load, since arrays saved without content start out silent
+static String const tableFill = "\\; benchmark-table sinesum 44097 1 0.5 0.25";
+
+static String makePatch(BenchmarkCase const& benchmark)
+{
+    String objects = "#N canvas 0 0 600 400 12;\n";
+    String connections;
+
+    objects << "#X obj 10 100 " << benchmark.object << ";\n";
+    int index = 1;
+
+    for (int i = 0; i < benchmark.inputs.size(); i++) {
+        objects << "#X obj " << 10 + i * 80 << " 10 " << benchmark.inputs[i] << ";\n";
+        connections << "#X connect " << index++ << " 0 0 " << i << ";\n";
+    }
+
+    // Like in a real patch, the output goes somewhere
+    objects << "#X obj 10 200 dac~ 1;\n";
+    connections << "#X connect 0 0 " << index++ << " 0;\n";
+
+    StringArray messages = benchmark.messages;
+    if (benchmark.setup.isNotEmpty())
+        messages.insert(0, tableFill);
+
+    if (!messages.isEmpty()) {
+        int const loadbang = index++;
+        objects << "#X obj 300 10 loadbang;\n";
+
+        for (auto const& message : messages) {
+            objects << "#X msg 300 40 " << message << ";\n";
+            connections << "#X connect " << loadbang << " 0 " << index << " 0;\n";
+            connections << "#X connect " << index++ << " 0 0 0;\n";
+        }
+    }
+
+    return objects + benchmark.setup + connections;
+}
+
+struct BenchmarkInstance : public pd::Instance {
+
+    BenchmarkInstance()
+        : pd::Instance("PlugDataBenchmark")
+    {
+    }
+
+    void receivePrint(const std::string& message) override
+    {
+        if (verbose && !message.empty()) {
+            std::cerr << message << std::endl;
+        }
+    }
+
+    bool verbose = false;
+};
+
+static void printUsage()
+{
+    std::cout << "Usage: PlugDataBenchmark [options]" << std::endl
+              << "  -o <file>     write the JSON results to a file (default: stdout)" << std::endl
+              << "  -t <ticks>    number of 64 sample ticks to measure per object (default: 25600)" << std::endl
+              << "  -r <rate>     samplerate (default: 44100)" << std::endl
+              << "  -f <text>     only run the objects that contain this text" << std::endl
+              << "  -v            show pd's console output" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args;
+    for (int i = 1; i < argc; i++)
+        args.add(String(CharPointer_UTF8(argv[i])));
+
+    auto getOption = [&args](String const& flag) -> String {
+        int idx = args.indexOf(flag);
+        if (idx >= 0 && idx + 1 < args.size())
+            return args[idx + 1];
+
+        return {};
+    };
+
+    if (args.contains("-h") || args.contains("--help")) {
+        printUsage();
+        return 0;
+    }
+
+    double const sampleRate = getOption("-r").isNotEmpty() ? getOption("-r").getDoubleValue() : 44100.0;
+    int const requestedTicks = getOption("-t").isNotEmpty() ? getOption("-t").getIntValue() : 25600;
+    auto const filter = getOption("-f");
+    auto const outputPath = getOption("-o");
+
+    if (sampleRate <= 0 || requestedTicks <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    // The profiler publishes its results once per window
+    int const ticksPerWindow = 256;
+    int const numWindows = std::max(1, (requestedTicks + ticksPerWindow - 1) / ticksPerWindow);
+
+    auto directory = File::getSpecialLocation(File::tempDirectory).getChildFile("PlugDataBenchmark");
+    directory.createDirectory();
+    auto patchFile = directory.getChildFile("benchmark.pd");
+
+    BenchmarkInstance pd;
+    pd.verbose = args.contains("-v");
+    pd.setBlockSize(64);
+    pd.prepareDSP(2, 2, sampleRate);
+    pd.startDSP();
+    pd.profiler.setEnabled(true);
+
+    std::vector<float> inputs(2 * 64, 0.0f);
+    std::vector<float> outputs(2 * 64, 0.0f);
+    std::vector<pd::Profiler::Entry> entries;
+
+    Array<var> results;
+    for (auto const& benchmark : benchmarkCases) {
+        if (filter.isNotEmpty() && !benchmark.object.contains(filter))
+            continue;
+
+        auto const className = benchmark.object.upToFirstOccurrenceOf(" ", false, false);
+
+        patchFile.replaceWithText(makePatch(benchmark));
+        pd.openPatch(directory.getFullPathName().toStdString(), patchFile.getFileName().toStdString());
+
+        // Compiles the chain with the new patch
+        pd.startDSP();
+
+        // The first window covers loading and the first compilation, so it isn't measured
+        double time = 0.0;
+        bool found = true;
+        for (int window = 0; window <= numWindows && found; window++) {
+            for (int tick = 0; tick < ticksPerWindow; tick++) {
+                pd.performDSP(inputs.data(), outputs.data());
+            }
+
+            double total = 0.0;
+            if (window == 0 || !pd.profiler.getResults(entries, total))
+                continue;
+
+            auto it = std::find_if(entries.begin(), entries.end(), [&className](auto const& entry) {
+                return className == entry.name;
+            });
+
+            found = it != entries.end();
+            if (found)
+                time += it->time;
+        }
+
+        pd.processPrints();
+        pd.closePatch();
+
+        auto* result = new DynamicObject();
+        result->setProperty("object", benchmark.object);
+
+        if (found) {
+            double const nsPerTick = time / numWindows;
+            result->setProperty("ns_per_sample", nsPerTick / 64.0);
+            result->setProperty("ns_per_tick", nsPerTick);
+            std::cerr << benchmark.object << ": " << String(nsPerTick / 64.0, 2) << " ns/sample" << std::endl;
+        } else {
+            result->setProperty("error", "not in the DSP chain, the object may have failed to create");
+            std::cerr << benchmark.object << ": failed" << std::endl;
+        }
+
+        results.add(var(result));
+    }
+
+    pd.profiler.setEnabled(false);
+    pd.releaseDSP();
+
+    auto* report = new DynamicObject();
+    report->setProperty("samplerate", sampleRate);
+    report->setProperty("blocksize", 64);
+    report->setProperty("ticks", numWindows * ticksPerWindow);
+    report->setProperty("results", results);
+
+    auto const json = JSON::toString(var(report));
+    if (outputPath.isNotEmpty()) {
+        auto outputFile = File::getCurrentWorkingDirectory().getChildFile(outputPath);
+        if (!outputFile.replaceWithText(json)) {
+            std::cerr << "Failed to write " << outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    } else {
+        std::cout << json << std::endl;
+    }
+
+    directory.deleteRecursively();
+    return 0;
+}
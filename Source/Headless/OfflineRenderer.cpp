@@ -0,0 +1,228 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+
+#include "../PluginProcessor.h"
+
+// Command line renderer that runs a patch through PlugDataAudioProcessor without an editor or audio device
+// Audio is processed as fast as the CPU allows, so this can be used for regression tests and batch rendering
+//
+// Usage: PlugDataRender <patch.pd> -o <output.wav> [-i input.wav] [-m input.mid] [-l seconds]
+//                       [-r samplerate] [-b blocksize] [-p pdblocksize] [-c channels] [-d bitdepth]
+
+struct OfflineRenderer : public PlugDataAudioProcessor {
+
+    OfflineRenderer(Console* console)
+        : PlugDataAudioProcessor(console)
+    {
+    }
+
+    // There is no console component to look at, so forward pd prints to stdout
+    void receivePrint(const std::string& message) override
+    {
+        if (!message.empty()) {
+            std::cout << message << std::endl;
+        }
+    }
+};
+
+static void printUsage()
+{
+    std::cout << "Usage: PlugDataRender <patch.pd> -o <output.wav> [options]" << std::endl
+              << "  -i <file>     audio file to feed into the patch (default: silence)" << std::endl
+              << "  -m <file>     MIDI file to feed into the patch" << std::endl
+              << "  -l <seconds>  length of the render (default: length of input, or 10 seconds)" << std::endl
+              << "  -r <rate>     samplerate (default: samplerate of input, or 44100)" << std::endl
+              << "  -b <size>     host block size (default: 512)" << std::endl
+              << "  -p <size>     pd block size, a multiple of 64 (default: from settings)" << std::endl
+              << "  -c <num>      number of output channels (default: 2)" << std::endl
+              << "  -d <bits>     bit depth of the output file: 16, 24 or 32 (default: 24)" << std::endl;
+}
+
+static MidiBuffer readMidiFile(File const& file, double sampleRate)
+{
+    MidiBuffer result;
+
+    FileInputStream stream(file);
+    MidiFile midiFile;
+
+    if (!stream.openedOk() || !midiFile.readFrom(stream)) {
+        std::cerr << "Failed to read MIDI file: " << file.getFullPathName() << std::endl;
+        return result;
+    }
+
+    midiFile.convertTimestampTicksToSeconds();
+
+    // Merge all tracks into a single buffer with sample positions as timestamps
+    for (int t = 0; t < midiFile.getNumTracks(); t++) {
+        auto* track = midiFile.getTrack(t);
+        for (auto* event : *track) {
+            auto const& message = event->message;
+            if (message.isMetaEvent())
+                continue;
+
+            result.addEvent(message, roundToInt(message.getTimeStamp() * sampleRate));
+        }
+    }
+
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args;
+    for (int i = 1; i < argc; i++)
+        args.add(String(CharPointer_UTF8(argv[i])));
+
+    auto getOption = [&args](String const& flag) -> String {
+        int idx = args.indexOf(flag);
+        if (idx >= 0 && idx + 1 < args.size())
+            return args[idx + 1];
+
+        return {};
+    };
+
+    if (args.isEmpty() || args.contains("-h") || args.contains("--help")) {
+        printUsage();
+        return args.isEmpty() ? 1 : 0;
+    }
+
+    auto patchFile = File::getCurrentWorkingDirectory().getChildFile(args[0]);
+    auto outputPath = getOption("-o");
+    auto inputPath = getOption("-i");
+    auto midiPath = getOption("-m");
+
+    if (!patchFile.existsAsFile() || outputPath.isEmpty()) {
+        printUsage();
+        return 1;
+    }
+
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<AudioFormatReader> reader;
+    if (inputPath.isNotEmpty()) {
+        reader.reset(formatManager.createReaderFor(File::getCurrentWorkingDirectory().getChildFile(inputPath)));
+        if (!reader) {
+            std::cerr << "Failed to read audio file: " << inputPath << std::endl;
+            return 1;
+        }
+    }
+
+    double const sampleRate = getOption("-r").isNotEmpty() ? getOption("-r").getDoubleValue() : (reader ? reader->sampleRate : 44100.0);
+    int const blockSize = getOption("-b").isNotEmpty() ? getOption("-b").getIntValue() : 512;
+    int const numChannels = getOption("-c").isNotEmpty() ? getOption("-c").getIntValue() : 2;
+    int const bitDepth = getOption("-d").isNotEmpty() ? getOption("-d").getIntValue() : 24;
+
+    int64 lengthInSamples = static_cast<int64>(10.0 * sampleRate);
+    if (getOption("-l").isNotEmpty()) {
+        lengthInSamples = static_cast<int64>(getOption("-l").getDoubleValue() * sampleRate);
+    } else if (reader) {
+        lengthInSamples = static_cast<int64>(reader->lengthInSamples * (sampleRate / reader->sampleRate));
+    }
+
+    if (sampleRate <= 0 || blockSize <= 0 || numChannels <= 0 || lengthInSamples <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    // Resample the input if the requested samplerate doesn't match the file
+    std::unique_ptr<AudioFormatReaderSource> readerSource;
+    std::unique_ptr<ResamplingAudioSource> resampler;
+    if (reader) {
+        readerSource = std::make_unique<AudioFormatReaderSource>(reader.get(), false);
+        resampler = std::make_unique<ResamplingAudioSource>(readerSource.get(), false, static_cast<int>(reader->numChannels));
+        resampler->setResamplingRatio(reader->sampleRate / sampleRate);
+        resampler->prepareToPlay(blockSize, sampleRate);
+    }
+
+    MidiBuffer midiInput;
+    if (midiPath.isNotEmpty()) {
+        midiInput = readMidiFile(File::getCurrentWorkingDirectory().getChildFile(midiPath), sampleRate);
+    }
+
+    auto outputFile = File::getCurrentWorkingDirectory().getChildFile(outputPath);
+    outputFile.deleteFile();
+
+    std::unique_ptr<FileOutputStream> outputStream(outputFile.createOutputStream());
+    if (!outputStream) {
+        std::cerr << "Failed to open output file: " << outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    WavAudioFormat wavFormat;
+    std::unique_ptr<AudioFormatWriter> writer(wavFormat.createWriterFor(outputStream.get(), sampleRate, static_cast<unsigned int>(numChannels), bitDepth, {}, 0));
+    if (!writer) {
+        std::cerr << "Unsupported output format" << std::endl;
+        return 1;
+    }
+    // The writer owns the stream now
+    outputStream.release();
+
+    Console console(false, false);
+    OfflineRenderer processor(&console);
+
+    processor.setNonRealtime(true);
+
+    // Render at unity gain instead of the plugin's default volume
+    processor.parameters.getParameter("volume")->setValueNotifyingHost(1.0f);
+
+    if (getOption("-p").isNotEmpty()) {
+        processor.pdBlockSize = getOption("-p").getIntValue();
+    }
+
+    processor.setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    processor.loadPatch(patchFile.getFullPathName());
+
+    AudioBuffer<float> buffer(numChannels, blockSize);
+    AudioBuffer<float> inputBuffer(reader ? static_cast<int>(reader->numChannels) : 0, blockSize);
+    MidiBuffer midiBlock;
+
+    auto startTime = Time::getMillisecondCounterHiRes();
+
+    for (int64 pos = 0; pos < lengthInSamples; pos += blockSize) {
+        int const numSamples = static_cast<int>(std::min<int64>(blockSize, lengthInSamples - pos));
+
+        buffer.setSize(numChannels, numSamples, false, false, true);
+        buffer.clear();
+
+        if (resampler) {
+            inputBuffer.setSize(inputBuffer.getNumChannels(), numSamples, false, false, true);
+            resampler->getNextAudioBlock(AudioSourceChannelInfo(&inputBuffer, 0, numSamples));
+
+            for (int ch = 0; ch < numChannels; ch++) {
+                buffer.copyFrom(ch, 0, inputBuffer, ch % inputBuffer.getNumChannels(), 0, numSamples);
+            }
+        }
+
+        midiBlock.clear();
+        midiBlock.addEvents(midiInput, static_cast<int>(pos), numSamples, -static_cast<int>(pos));
+
+        {
+            // Hosts hold the callback lock while processing, pd's background thread relies on that
+            const ScopedLock lock(*processor.getCallbackLock());
+            processor.processBlock(buffer, midiBlock);
+        }
+
+        writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+    }
+
+    processor.releaseResources();
+    writer.reset();
+
+    auto elapsed = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    auto rendered = static_cast<double>(lengthInSamples) / sampleRate;
+
+    std::cout << "Rendered " << rendered << "s of audio in " << elapsed << "s (" << (elapsed > 0 ? rendered / elapsed : 0.0) << "x realtime)" << std::endl;
+
+    return 0;
+}
@@ -6,6 +6,15 @@
 
 #pragma once
 
+#include <m_pd.h>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
 namespace pd
 {
 // ==================================================================================== //
@@ -13,49 +22,258 @@ namespace pd
 // ==================================================================================== //
 
 //! @brief The Pd atom.
-//! @details The class is a copy of the Pd atom.
-//! @see Instance, Gui
-class Atom
+//! @details The class is a compact copy of the Pd atom that fits in 16 bytes.
+//! Floats, symbols interned by Pd and symbols of up to 14 characters are stored inline,
+//! only longer symbols that don't come from Pd are copied to the heap.
+//! @see Instance, Gui, AtomList
+class alignas(8) Atom
 {
 public:
     //! @brief The default constructor.
-    inline Atom() : type(FLOAT), value(0), symbol() {}
-    
+    inline Atom() noexcept { setFloat(0); }
+
     //! @brief The float constructor.
-    inline Atom(const float val) : type(FLOAT), value(val), symbol() {}
-    
+    inline Atom(const float val) noexcept { setFloat(val); }
+
     //! @brief The string constructor.
-    inline Atom(const std::string& sym) : type(SYMBOL), value(0), symbol(sym) {}
-    
+    inline Atom(const std::string& sym) { setString(sym.data(), sym.size()); }
+
     //! @brief The c-string constructor.
-    inline Atom(const char* sym) : type(SYMBOL), value(0), symbol(sym) {}
-    
+    inline Atom(const char* sym) { setString(sym, std::strlen(sym)); }
+
+    //! @brief The interned symbol constructor.
+    inline Atom(t_symbol* sym) noexcept { setPointer(INTERNED, sym); }
+
+    //! @brief The Pd atom constructor.
+    //! @details Pointers and other atom types are converted to 0.
+    inline Atom(t_atom const& atom) noexcept
+    {
+        if(atom.a_type == A_SYMBOL)
+            setPointer(INTERNED, atom.a_w.w_symbol);
+        else if(atom.a_type == A_FLOAT)
+            setFloat(atom.a_w.w_float);
+        else
+            setFloat(0);
+    }
+
+    inline Atom(Atom const& other) { copy(other); }
+
+    inline Atom(Atom&& other) noexcept
+    {
+        std::memcpy(this, &other, sizeof(Atom));
+        other.setFloat(0);
+    }
+
+    inline Atom& operator=(Atom const& other)
+    {
+        if(this != &other)
+        {
+            release();
+            copy(other);
+        }
+        return *this;
+    }
+
+    inline Atom& operator=(Atom&& other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            std::memcpy(this, &other, sizeof(Atom));
+            other.setFloat(0);
+        }
+        return *this;
+    }
+
+    inline ~Atom() { release(); }
+
     //! @brief Check if the atom is a float.
-    inline bool isFloat() const noexcept { return type == FLOAT; }
-    
+    inline bool isFloat() const noexcept { return m_type == FLOAT; }
+
     //! @brief Check if the atom is a string.
-    inline bool isSymbol() const noexcept { return type == SYMBOL; }
-    
+    inline bool isSymbol() const noexcept { return m_type != FLOAT; }
+
     //! @brief Get the float value.
-    inline float getFloat() const noexcept { return value; }
-    
+    inline float getFloat() const noexcept
+    {
+        float value = 0;
+        if(m_type == FLOAT) std::memcpy(&value, m_data, sizeof(float));
+        return value;
+    }
+
     //! @brief Get the string.
-    inline std::string const& getSymbol() const noexcept { return symbol; }
-    
+    //! @details Returns an empty string if the atom is a float.
+    inline const char* getSymbol() const noexcept
+    {
+        if(m_type == INTERNED) return getPointer<t_symbol>()->s_name;
+        if(m_type == HEAP)     return getPointer<char>();
+        if(m_type == INLINE)   return m_data;
+        return "";
+    }
+
+    //! @brief Get the symbol as a Pd symbol.
+    //! @details Symbols that are not interned yet are passed to gensym, so this must only be called
+    //! from the Pd thread with the right instance set.
+    inline t_symbol* getPdSymbol() const noexcept
+    {
+        return m_type == INTERNED ? getPointer<t_symbol>() : gensym(getSymbol());
+    }
+
     //! @brief Compare two atoms.
     inline bool operator==(Atom const& other) const noexcept
     {
-        if(type == SYMBOL) { return other.type == SYMBOL && symbol == other.symbol; }
-        else { return other.type == FLOAT && value == other.value; }
+        if(isSymbol()) { return other.isSymbol() && std::strcmp(getSymbol(), other.getSymbol()) == 0; }
+        else { return other.isFloat() && getFloat() == other.getFloat(); }
     }
 private:
-    enum Type
+    enum Type : uint8_t
     {
         FLOAT,
-        SYMBOL
+        INTERNED,
+        INLINE,
+        HEAP
     };
-    Type        type = FLOAT;
-    float       value = 0;
-    std::string symbol;
+
+    static constexpr size_t inlineSize = 14;
+
+    inline void setFloat(float value) noexcept
+    {
+        m_type = FLOAT;
+        std::memcpy(m_data, &value, sizeof(float));
+    }
+
+    template<typename T>
+    inline void setPointer(Type type, T* ptr) noexcept
+    {
+        m_type = type;
+        std::memcpy(m_data, &ptr, sizeof(T*));
+    }
+
+    template<typename T>
+    inline T* getPointer() const noexcept
+    {
+        T* ptr;
+        std::memcpy(&ptr, m_data, sizeof(T*));
+        return ptr;
+    }
+
+    inline void setString(const char* sym, size_t size)
+    {
+        if(size <= inlineSize)
+        {
+            m_type = INLINE;
+            std::memcpy(m_data, sym, size);
+            m_data[size] = '\0';
+        }
+        else
+        {
+            char* copy = static_cast<char*>(std::malloc(size + 1));
+            std::memcpy(copy, sym, size);
+            copy[size] = '\0';
+            setPointer(HEAP, copy);
+        }
+    }
+
+    inline void copy(Atom const& other)
+    {
+        if(other.m_type == HEAP)
+        {
+            const char* sym = other.getPointer<char>();
+            setString(sym, std::strlen(sym));
+        }
+        else
+        {
+            std::memcpy(this, &other, sizeof(Atom));
+        }
+    }
+
+    inline void release() noexcept
+    {
+        if(m_type == HEAP) std::free(getPointer<char>());
+    }
+
+    char m_data[inlineSize + 1];
+    Type m_type;
+};
+
+static_assert(sizeof(Atom) == 16, "pd::Atom should fit in 16 bytes");
+
+// ==================================================================================== //
+//                                      ATOM LIST                                       //
+// ==================================================================================== //
+
+//! @brief A list of atoms that only allocates when it gets long.
+//! @details The first inlineSize atoms are stored inline so short lists can be queued between
+//! threads without allocating, longer lists move to the heap.
+//! @see Atom, Instance
+class AtomList
+{
+public:
+    static constexpr int inlineSize = 32;
+
+    //! @brief The default constructor.
+    inline AtomList() noexcept = default;
+
+    //! @brief The initializer list constructor.
+    inline AtomList(std::initializer_list<Atom> atoms)
+    {
+        for(auto const& atom : atoms)
+            add(atom);
+    }
+
+    //! @brief The Pd atoms constructor.
+    inline AtomList(int argc, t_atom const* argv)
+    {
+        for(int i = 0; i < argc; ++i)
+            add(Atom(argv[i]));
+    }
+
+    //! @brief Add an atom at the end of the list.
+    inline void add(Atom const& atom)
+    {
+        if(m_heap.empty() && m_size < inlineSize)
+        {
+            m_atoms[m_size++] = atom;
+            return;
+        }
+
+        if(m_heap.empty())
+        {
+            m_heap.reserve(2 * inlineSize);
+            for(int i = 0; i < m_size; ++i)
+                m_heap.push_back(std::move(m_atoms[i]));
+        }
+
+        m_heap.push_back(atom);
+        m_size++;
+    }
+
+    //! @brief Remove all the atoms.
+    inline void clear() noexcept
+    {
+        for(int i = 0; i < m_size && i < inlineSize; ++i)
+            m_atoms[i] = Atom();
+        m_heap.clear();
+        m_size = 0;
+    }
+
+    //! @brief Get the number of atoms.
+    inline int size() const noexcept { return m_size; }
+
+    //! @brief Check if the list is empty.
+    inline bool empty() const noexcept { return m_size == 0; }
+
+    inline Atom& operator[](int idx) noexcept { return begin()[idx]; }
+    inline Atom const& operator[](int idx) const noexcept { return begin()[idx]; }
+
+    inline Atom* begin() noexcept { return m_heap.empty() ? m_atoms.data() : m_heap.data(); }
+    inline Atom* end() noexcept { return begin() + m_size; }
+    inline Atom const* begin() const noexcept { return m_heap.empty() ? m_atoms.data() : m_heap.data(); }
+    inline Atom const* end() const noexcept { return begin() + m_size; }
+
+private:
+    std::array<Atom, inlineSize> m_atoms;
+    std::vector<Atom> m_heap;
+    int m_size = 0;
 };
 }
@@ -6,8 +6,10 @@
 
 #include "PdGui.hpp"
 #include "PdInstance.hpp"
+#include <atomic>
 #include <limits>
 #include <cmath>
+#include <mutex>
 
 extern "C"
 {
@@ -18,10 +20,40 @@ extern "C"
 #include <g_canvas.h>
 #include <g_all_guis.h>
 #include "x_libpd_extra_utils.h"
+#include "x_libpd_multi.h"
 }
 
 namespace pd
 {
+// iemguis redraw through the x_draw function pointer of the object whenever their value changes
+// We replace it with a function that reports the change to the instance, and then calls the original
+struct IemguiDraw
+{
+    t_class*    cls  = nullptr;
+    t_iemfunptr draw = nullptr;
+};
+
+static std::mutex iemguiDrawMutex;
+static std::array<IemguiDraw, 32> iemguiDraws;
+static std::atomic<int> numIemguiDraws = 0;
+
+static void iemgui_draw_notify(void* x, t_glist* glist, int mode)
+{
+    if(mode == IEM_GUI_DRAW_MODE_UPDATE)
+        libpd_multi_gui_changed(x);
+    
+    t_class* cls = pd_class(static_cast<t_pd*>(x));
+    int num = numIemguiDraws.load(std::memory_order_acquire);
+    for(int i = 0; i < num; i++)
+    {
+        if(iemguiDraws[i].cls == cls)
+        {
+            iemguiDraws[i].draw(x, glist, mode);
+            return;
+        }
+    }
+}
+
 // ==================================================================================== //
 //                                      GUI                                             //
 // ==================================================================================== //
@@ -428,38 +460,21 @@ void Gui::setValue(float value) noexcept
     
 }
 
-std::vector<Atom> Gui::getList() const noexcept
+AtomList Gui::getList() const noexcept
 {
     if(!m_ptr || m_type != Type::AtomList)
         return {};
     else
     {
-        std::vector<Atom> array;
         m_instance->setThis();
         
         int ac = binbuf_getnatom(static_cast<t_fake_gatom*>(m_ptr)->a_text.te_binbuf);
         t_atom *av = binbuf_getvec(static_cast<t_fake_gatom*>(m_ptr)->a_text.te_binbuf);
-        array.reserve(ac);
-        for(int i = 0; i < ac; ++i)
-        {
-            if(av[i].a_type == A_FLOAT)
-            {
-                array.push_back({atom_getfloat(av+i)});
-            }
-            else if(av[i].a_type == A_SYMBOL)
-            {
-                array.push_back({atom_getsymbol(av+i)->s_name});
-            }
-            else
-            {
-                array.push_back({});
-            }
-        }
-        return array;
+        return AtomList(ac, av);
     }
 }
 
-void Gui::setList(std::vector<Atom> const& value) noexcept
+void Gui::setList(AtomList const& value) noexcept
 {
     if(!m_ptr || m_type != Type::AtomList)
         return;
@@ -467,6 +482,55 @@ void Gui::setList(std::vector<Atom> const& value) noexcept
     m_instance->enqueueDirectMessages(m_ptr, value);
 }
 
+// These only change their value through x_draw, number boxes and others redraw in other ways
+static bool canNotify(Type type) noexcept
+{
+    return type == Type::Bang || type == Type::Toggle ||
+           type == Type::HorizontalSlider || type == Type::VerticalSlider ||
+           type == Type::HorizontalRadio || type == Type::VerticalRadio;
+}
+
+void Gui::enableUpdateNotifications() noexcept
+{
+    if(!m_ptr || !canNotify(m_type))
+        return;
+    
+    m_instance->enqueueFunction([ptr = m_ptr]() {
+        auto* iemgui = static_cast<t_iemgui*>(ptr);
+        if(iemgui->x_draw == iemgui_draw_notify)
+            return;
+        
+        t_class* cls = pd_class(static_cast<t_pd*>(ptr));
+        
+        std::lock_guard<std::mutex> lock(iemguiDrawMutex);
+        int num = numIemguiDraws.load(std::memory_order_relaxed);
+        bool known = false;
+        for(int i = 0; i < num; i++)
+        {
+            known = known || iemguiDraws[i].cls == cls;
+        }
+        if(!known)
+        {
+            // The gui stays polled then
+            if(num == static_cast<int>(iemguiDraws.size()))
+                return;
+            
+            iemguiDraws[num] = {cls, iemgui->x_draw};
+            numIemguiDraws.store(num + 1, std::memory_order_release);
+        }
+        
+        iemgui->x_draw = iemgui_draw_notify;
+        
+        // It was polled until now, a change since the last poll is reported like any other
+        libpd_multi_gui_changed(ptr);
+    });
+}
+
+bool Gui::pushesUpdates() const noexcept
+{
+    return m_ptr && canNotify(m_type) && static_cast<t_iemgui*>(m_ptr)->x_draw == iemgui_draw_notify;
+}
+
 
 
 bool Gui::jumpOnClick() const noexcept
@@ -109,9 +109,18 @@ namespace pd
             
         Patch getPatch() const noexcept;
         
-        std::vector<Atom> getList() const noexcept;
+        AtomList getList() const noexcept;
         
-        void setList(std::vector<Atom> const& value) noexcept;
+        void setList(AtomList const& value) noexcept;
+        
+        //! @brief Makes pd report value changes of this gui to the instance.
+        //! @details This is done on the pd thread. Until it is, or if this type of gui can't report
+        //! changes, pushesUpdates() returns false and the gui has to be polled.
+        //! @see Instance::dequeueGuiUpdates
+        void enableUpdateNotifications() noexcept;
+        
+        //! @brief Checks if pd reports value changes of this gui, so it doesn't need to be polled.
+        bool pushesUpdates() const noexcept;
         
         Gui(void* ptr, Patch* patch, Instance* instance) noexcept;
     private:
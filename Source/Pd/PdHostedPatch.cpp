@@ -0,0 +1,300 @@
+/*
+ // Copyright (c) 2015-2018 Pierre Guillot.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+extern "C"
+{
+#include <g_canvas.h>
+#include <s_stuff.h>
+#include "x_libpd_multi.h"
+#include "x_libpd_mod_utils.h"
+
+void glob_setfilename(void *dummy, t_symbol *name, t_symbol *dir);
+}
+
+#include "PdHostedPatch.hpp"
+#include "PdInstance.hpp"
+
+namespace pd
+{
+// ==================================================================================== //
+//                                      HOSTED PATCH                                    //
+// ==================================================================================== //
+
+HostedPatch::HostedPatch(std::string directory, std::string text, int nins, int nouts, float samplerate) :
+m_directory(std::move(directory)),
+m_text(std::move(text)),
+m_nins(std::max(nins, 0)),
+m_nouts(std::max(nouts, 0)),
+m_next_samplerate(samplerate)
+{
+    t_libpd_multi_printhook hook = nullptr;
+    libpd_multi_print_gethook(libpd_multi_print_current(), &m_owner_ptr, &hook);
+    m_owner_hook = hook;
+    m_atoms.reserve(AtomList::inlineSize);
+}
+
+HostedPatch::~HostedPatch()
+{
+    if(!m_instance)
+        return;
+
+    libpd_set_instance(static_cast<t_pdinstance *>(m_instance));
+
+    // Stop printing first, the owner instance may already be gone
+    if(m_print_receiver)
+        pd_free(static_cast<t_pd*>(m_print_receiver));
+
+    if(m_canvas)
+        libpd_closefile(m_canvas);
+
+    Instance::instanceLock.lock();
+    libpd_free_instance(static_cast<t_pdinstance *>(m_instance));
+    Instance::instanceLock.unlock();
+}
+
+static t_object* createObject(t_canvas* cnv, int x, int y, std::string const& text)
+{
+    // Same as typing the object in a box, without the undo step since nobody edits this canvas
+    std::string const message = std::to_string(x) + " " + std::to_string(y) + " " + text;
+    t_binbuf* b = binbuf_new();
+    binbuf_text(b, message.c_str(), static_cast<int>(message.size()));
+    pd_typedmess(&cnv->gl_pd, gensym("obj"), binbuf_getnatom(b), binbuf_getvec(b));
+    binbuf_free(b);
+
+    // Objects that fail to create are kept as plain text boxes
+    t_pd* newest = libpd_newest(cnv);
+    if(!newest || std::strcmp(class_getname(pd_class(newest)), "text") == 0)
+        return nullptr;
+
+    return pd_checkobject(newest);
+}
+
+void HostedPatch::print(void* ptr, char const* message)
+{
+    auto* x = static_cast<HostedPatch*>(ptr);
+    std::lock_guard<std::mutex> lock(x->m_owner_mutex);
+    if(x->m_owner_hook)
+        x->m_owner_hook(x->m_owner_ptr, message);
+}
+
+void HostedPatch::detach()
+{
+    std::lock_guard<std::mutex> lock(m_owner_mutex);
+    m_owner_hook = nullptr;
+    m_owner_ptr = nullptr;
+    m_detached = true;
+}
+
+void HostedPatch::load()
+{
+    if(m_detached)
+    {
+        m_state = Failed;
+        return;
+    }
+
+    Instance::instanceLock.lock();
+    m_instance = libpd_new_instance();
+    Instance::instanceLock.unlock();
+
+    libpd_set_instance(static_cast<t_pdinstance *>(m_instance));
+    m_print_receiver = libpd_multi_print_new(this, reinterpret_cast<t_libpd_multi_printhook>(&HostedPatch::print));
+
+    sys_lock();
+
+    // The wrapper canvas uses the owner's directory, so the object is found like it would be there
+    glob_setfilename(nullptr, gensym("hosted"), gensym(m_directory.c_str()));
+    auto* cnv = canvas_new(nullptr, nullptr, 0, nullptr);
+    glob_setfilename(nullptr, &s_, &s_);
+    pd_vmess(&cnv->gl_pd, gensym("pop"), const_cast<char*>("i"), 0);
+    m_canvas = cnv;
+
+    t_object* object = createObject(cnv, 10, 40, m_text);
+    if(!object)
+    {
+        pd_error(nullptr, "%s: couldn't create", m_text.c_str());
+        sys_unlock();
+        m_state = Failed;
+        return;
+    }
+
+    std::string adc = "adc~";
+    std::string dac = "dac~";
+    for(int ch = 1; ch <= m_nins; ch++)
+        adc += " " + std::to_string(ch);
+    for(int ch = 1; ch <= m_nouts; ch++)
+        dac += " " + std::to_string(ch);
+
+    // Channels are matched to the signal iolets in order, the ones left over stay unconnected
+    if(m_nins > 0)
+    {
+        if(auto* input = createObject(cnv, 10, 10, adc))
+        {
+            for(int ch = 0, n = 0; n < obj_ninlets(object) && ch < m_nins; n++)
+            {
+                if(obj_issignalinlet(object, n))
+                    obj_connect(input, ch++, object, n);
+            }
+        }
+    }
+
+    if(m_nouts > 0)
+    {
+        if(auto* output = createObject(cnv, 10, 70, dac))
+        {
+            for(int ch = 0, n = 0; n < obj_noutlets(object) && ch < m_nouts; n++)
+            {
+                if(obj_issignaloutlet(object, n))
+                    obj_connect(object, n, output, ch++);
+            }
+        }
+    }
+
+    m_receiver = gensym("__hosted_in");
+    if(obj_ninlets(object) > 0)
+    {
+        if(auto* receiver = createObject(cnv, 100, 10, "receive __hosted_in"))
+            obj_connect(receiver, 0, object, 0);
+    }
+
+    canvas_loadbang(cnv);
+    sys_unlock();
+
+    startAudio(m_next_samplerate);
+    m_state = Ready;
+}
+
+void HostedPatch::startAudio(float samplerate)
+{
+    // dac~ and adc~ point into the sound buffers, so the chain is rebuilt after they're reallocated
+    setDSP(false);
+    libpd_init_audio(m_nins, m_nouts, static_cast<int>(samplerate));
+    setDSP(true);
+    m_samplerate = samplerate;
+}
+
+void HostedPatch::setSampleRate(float samplerate)
+{
+    m_next_samplerate = samplerate;
+    if(getState() != Ready || samplerate == m_samplerate)
+        return;
+
+    auto* previous = libpd_this_instance();
+    libpd_set_instance(static_cast<t_pdinstance *>(m_instance));
+    startAudio(samplerate);
+    libpd_set_instance(previous);
+}
+
+HostedPatch::State HostedPatch::getState() const noexcept
+{
+    return m_state.load(std::memory_order_acquire);
+}
+
+int HostedPatch::getNumInputs() const noexcept
+{
+    return m_nins;
+}
+
+int HostedPatch::getNumOutputs() const noexcept
+{
+    return m_nouts;
+}
+
+void HostedPatch::setDSP(bool state)
+{
+    t_atom av;
+    libpd_set_float(&av, state ? 1.f : 0.f);
+    libpd_message("pd", "dsp", 1, &av);
+}
+
+void HostedPatch::process(float const* inputs, float* outputs, int blockSize, float samplerate, t_binbuf* messages)
+{
+    // This may run on the owner's audio thread while it helps the workers
+    auto* previous = libpd_this_instance();
+    libpd_set_instance(static_cast<t_pdinstance *>(m_instance));
+
+    // Only when the rate changed while loading, setSampleRate() handles it otherwise
+    if(samplerate != m_samplerate)
+        startAudio(samplerate);
+
+    // Same as Instance::performDSP
+    const int ticksize = libpd_blocksize();
+
+    sys_lock();
+    if(messages)
+        dispatch(messages);
+
+    for(int offset = 0; offset < blockSize; offset += ticksize)
+    {
+        for(int ch = 0; ch < m_nins; ch++)
+        {
+            std::copy_n(inputs + ch * blockSize + offset, ticksize, STUFF->st_soundin + ch * ticksize);
+        }
+
+        std::fill_n(STUFF->st_soundout, m_nouts * ticksize, 0.f);
+        sched_tick();
+
+        for(int ch = 0; ch < m_nouts; ch++)
+        {
+            std::copy_n(STUFF->st_soundout + ch * ticksize, ticksize, outputs + ch * blockSize + offset);
+        }
+    }
+    sys_unlock();
+
+    libpd_set_instance(previous);
+}
+
+bool HostedPatch::hasClocks() const noexcept
+{
+    return m_instance && static_cast<t_pdinstance *>(m_instance)->pd_clock_setlist != nullptr;
+}
+
+bool HostedPatch::isSilent(float const* samples, size_t size) noexcept
+{
+    return std::all_of(samples, samples + size, [](float sample){
+        return std::fabs(sample) < 1e-5f;
+    });
+}
+
+void HostedPatch::dispatch(t_binbuf* messages)
+{
+    const int argc = binbuf_getnatom(messages);
+    t_atom const* argv = binbuf_getvec(messages);
+    t_pd* receiver = m_receiver->s_thing;
+
+    // Symbols belong to the owner's symbol table, so they're looked up again in this instance
+    int start = 0;
+    for(int i = 0; i <= argc; i++)
+    {
+        if(i < argc && argv[i].a_type != A_SEMI)
+            continue;
+
+        if(receiver && i > start && argv[start].a_type == A_SYMBOL)
+        {
+            m_atoms.resize(i - start - 1);
+            for(int j = start + 1; j < i; j++)
+            {
+                if(argv[j].a_type == A_SYMBOL)
+                    SETSYMBOL(&m_atoms[j - start - 1], gensym(argv[j].a_w.w_symbol->s_name));
+                else if(argv[j].a_type == A_FLOAT)
+                    SETFLOAT(&m_atoms[j - start - 1], argv[j].a_w.w_float);
+                else
+                    SETFLOAT(&m_atoms[j - start - 1], 0);
+            }
+
+            pd_typedmess(receiver, gensym(argv[start].a_w.w_symbol->s_name), static_cast<int>(m_atoms.size()), m_atoms.data());
+        }
+
+        start = i + 1;
+    }
+
+    binbuf_clear(messages);
+}
+}
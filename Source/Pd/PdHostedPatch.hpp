@@ -0,0 +1,123 @@
+/*
+ // Copyright (c) 2015-2018 Pierre Guillot.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <m_pd.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pd
+{
+// ==================================================================================== //
+//                                      HOSTED PATCH                                    //
+// ==================================================================================== //
+
+//! @brief An object running in a pd instance of its own.
+//! @details The object is created in a hidden canvas, with an adc~ feeding its signal inlets
+//! and a dac~ collecting its signal outlets, so the instance can compute it independently of
+//! the instance that owns it. Messages are sent to its first inlet.
+//! Since the instance has its own DSP chain and lock, blocks of different hosted patches can be
+//! computed on different threads at the same time.
+//! The instance is isolated from the owner: sends, receives, arrays, values, throw~/catch~ and
+//! everything else looked up by name only reach objects of the hosted instance. Only the
+//! printing goes through the owner, until it detaches.
+//! @see WorkerPool, Loader
+class HostedPatch
+{
+public:
+    enum State
+    {
+        Loading,
+        Ready,
+        Failed
+    };
+
+    //! @brief Prepares a hosted patch, without creating anything yet.
+    //! @details This must be called from the owner's thread, with the owner instance set.
+    //! @param directory The directory where the object is looked for, usually the owner's.
+    //! @param text The object to create, like "myabstraction 1 2".
+    //! @param nins The number of input channels, fed to the signal inlets from left to right.
+    //! @param nouts The number of output channels, taken from the signal outlets from left to right.
+    //! @param samplerate The sample rate the instance is started with once loaded.
+    HostedPatch(std::string directory, std::string text, int nins, int nouts, float samplerate);
+
+    HostedPatch(HostedPatch const& other) = delete;
+
+    //! @brief Frees the instance.
+    //! @details This locks pd's instance list and frees the whole patch, so it should run on the Loader.
+    ~HostedPatch();
+
+    //! @brief Creates the instance and the object.
+    //! @details This can take a while, so it should run on the Loader. The DSP is started at the
+    //! end, so the first block doesn't have to allocate anything.
+    //! Once detached, this does nothing and the state becomes Failed.
+    void load();
+
+    //! @brief Stops printing through the owner and cancels the load if it hasn't started yet.
+    //! @details The owner calls this before it goes away, from its own thread, so the hosted patch can
+    //! be released on the Loader without waiting for the load to finish.
+    void detach();
+
+    //! @brief Restarts the DSP with another sample rate.
+    //! @details This allocates, so it's meant for the owner's dsp method, when the hosted patch isn't
+    //! processing. Before the patch is Ready, the rate is only kept for load().
+    void setSampleRate(float samplerate);
+
+    //! @brief Gets the loading state.
+    State getState() const noexcept;
+
+    int getNumInputs() const noexcept;
+    int getNumOutputs() const noexcept;
+
+    //! @brief Sends the pending messages to the object and computes a block.
+    //! @details The buffers contain one channel after another, each blockSize samples long.
+    //! The block size must be a multiple of pd's 64 sample tick. The messages are atoms of the owner
+    //! instance separated by semicolons, the binbuf is cleared afterwards.
+    //! Only one thread may process a hosted patch at a time, and only once it's Ready.
+    void process(float const* inputs, float* outputs, int blockSize, float samplerate, t_binbuf* messages);
+
+    //! @brief Checks if a clock is set in the instance, like a running metro or a pending delay.
+    //! @details Clocks only advance while the patch is processed, so it can't be skipped while this is true.
+    //! Only call this when the patch isn't processing.
+    bool hasClocks() const noexcept;
+
+    //! @brief Checks if all the samples are below -100dB.
+    //! @details Used to decide when a hosted patch can stop being computed.
+    static bool isSilent(float const* samples, size_t size) noexcept;
+
+private:
+    void setDSP(bool state);
+    void startAudio(float samplerate);
+    void dispatch(t_binbuf* messages);
+
+    static void print(void* ptr, char const* message);
+
+    using PrintHook = void (*)(void*, char const*);
+
+    std::string m_directory;
+    std::string m_text;
+    int m_nins;
+    int m_nouts;
+
+    void* m_instance        = nullptr;
+    void* m_canvas          = nullptr;
+    void* m_owner_ptr       = nullptr;
+    PrintHook m_owner_hook  = nullptr;
+    void* m_print_receiver  = nullptr;
+    t_symbol* m_receiver    = nullptr;
+    float m_samplerate      = 0.f;
+
+    std::mutex m_owner_mutex;
+    std::atomic<bool> m_detached = false;
+    std::atomic<float> m_next_samplerate;
+
+    std::vector<t_atom> m_atoms;
+    std::atomic<State> m_state = Loading;
+};
+}
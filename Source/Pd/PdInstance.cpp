@@ -10,6 +10,7 @@
 extern "C"
 {
 #include <g_undo.h>
+#include <s_stuff.h>
 #include "x_libpd_multi.h"
 #include "x_libpd_extra_utils.h"
 #include "x_libpd_mod_utils.h"
@@ -24,45 +25,45 @@ extern "C"
 
 struct pd::Instance::internal
 {
-    static void instance_multi_bang(pd::Instance* ptr, const char *recv)
+    static void enqueue_message(pd::Instance* ptr, decltype(Message::type) type, t_symbol* recv, t_symbol* sel, int argc, t_atom const* argv)
     {
-        ptr->m_message_queue.try_enqueue({std::string("bang"), std::string(recv)});
+        // Longer lists would allocate here, on the audio thread
+        if(argc > AtomList::inlineSize)
+        {
+            pd_error(nullptr, "plugdata: message to %s cut to %d atoms", recv->s_name, AtomList::inlineSize);
+            argc = AtomList::inlineSize;
+        }
+        
+        ptr->m_message_queue.try_enqueue(Message{type, recv, sel, AtomList(argc, argv)});
     }
     
-    static void instance_multi_float(pd::Instance* ptr, const char *recv, float f)
+    static void instance_multi_bang(pd::Instance* ptr, t_symbol *recv)
     {
-        ptr->m_message_queue.try_enqueue({std::string("float"), std::string(recv), std::vector<Atom>(1, f)});
+        enqueue_message(ptr, Message::BANG, recv, &s_bang, 0, nullptr);
     }
     
-    static void instance_multi_symbol(pd::Instance* ptr, const char *recv, const char *sym)
+    static void instance_multi_float(pd::Instance* ptr, t_symbol *recv, float f)
     {
-        ptr->m_message_queue.try_enqueue({std::string("symbol"), std::string(recv), std::vector<Atom>(1, std::string(sym))});
+        t_atom atom;
+        SETFLOAT(&atom, f);
+        enqueue_message(ptr, Message::FLOAT, recv, &s_float, 1, &atom);
     }
     
-    static void instance_multi_list(pd::Instance* ptr, const char *recv, int argc, t_atom *argv)
+    static void instance_multi_symbol(pd::Instance* ptr, t_symbol *recv, t_symbol *sym)
     {
-        Message mess{std::string("list"), std::string(recv), std::vector<Atom>(argc)};
-        for(int i = 0; i < argc; ++i)
-        {
-            if(argv[i].a_type == A_FLOAT)
-                mess.list[i] = Atom(atom_getfloat(argv+i));
-            else if(argv[i].a_type == A_SYMBOL)
-                mess.list[i] = Atom(std::string(atom_getsymbol(argv+i)->s_name));
-        }
-        ptr->m_message_queue.try_enqueue(std::move(mess));
+        t_atom atom;
+        SETSYMBOL(&atom, sym);
+        enqueue_message(ptr, Message::SYMBOL, recv, &s_symbol, 1, &atom);
     }
     
-    static void instance_multi_message(pd::Instance* ptr, const char *recv, const char *msg, int argc, t_atom *argv)
+    static void instance_multi_list(pd::Instance* ptr, t_symbol *recv, int argc, t_atom *argv)
     {
-        Message mess{msg, std::string(recv), std::vector<Atom>(argc)};
-        for(int i = 0; i < argc; ++i)
-        {
-            if(argv[i].a_type == A_FLOAT)
-                mess.list[i] = Atom(atom_getfloat(argv+i));
-            else if(argv[i].a_type == A_SYMBOL)
-                mess.list[i] = Atom(std::string(atom_getsymbol(argv+i)->s_name));
-        }
-        ptr->m_message_queue.try_enqueue(std::move(mess));
+        enqueue_message(ptr, Message::LIST, recv, &s_list, argc, argv);
+    }
+    
+    static void instance_multi_message(pd::Instance* ptr, t_symbol *recv, t_symbol *msg, int argc, t_atom *argv)
+    {
+        enqueue_message(ptr, Message::ANYTHING, recv, msg, argc, argv);
     }
     
     //////////////////////////////////////////////////////////////////////////////////////////
@@ -110,6 +111,48 @@ struct pd::Instance::internal
     {
         ptr->m_print_queue.try_enqueue(std::string(s));
     }
+    
+    static void instance_multi_gui(pd::Instance* ptr, void* object)
+    {
+        if(!ptr->m_gui_queue.try_enqueue(object))
+            ptr->m_gui_queue_overflow = true;
+    }
+    
+    //////////////////////////////////////////////////////////////////////////////////////////
+    //////////////////////////////////////////////////////////////////////////////////////////
+    
+    // The receivers are created in the current pd instance
+    static void* midi_new(pd::Instance* ptr)
+    {
+        return libpd_multi_midi_new(ptr,
+                                    reinterpret_cast<t_libpd_multi_noteonhook>(instance_multi_noteon),
+                                    reinterpret_cast<t_libpd_multi_controlchangehook>(instance_multi_controlchange),
+                                    reinterpret_cast<t_libpd_multi_programchangehook>(instance_multi_programchange),
+                                    reinterpret_cast<t_libpd_multi_pitchbendhook>(instance_multi_pitchbend),
+                                    reinterpret_cast<t_libpd_multi_aftertouchhook>(instance_multi_aftertouch),
+                                    reinterpret_cast<t_libpd_multi_polyaftertouchhook>(instance_multi_polyaftertouch),
+                                    reinterpret_cast<t_libpd_multi_midibytehook>(instance_multi_midibyte));
+    }
+    
+    static void* print_new(pd::Instance* ptr)
+    {
+        return libpd_multi_print_new(ptr, reinterpret_cast<t_libpd_multi_printhook>(instance_multi_print));
+    }
+    
+    static void* gui_new(pd::Instance* ptr)
+    {
+        return libpd_multi_gui_new(ptr, reinterpret_cast<t_libpd_multi_guihook>(instance_multi_gui));
+    }
+    
+    static void* receiver_new(pd::Instance* ptr, const char* sym)
+    {
+        return libpd_multi_receiver_new(ptr, sym,
+                                        reinterpret_cast<t_libpd_multi_banghook>(instance_multi_bang),
+                                        reinterpret_cast<t_libpd_multi_floathook>(instance_multi_float),
+                                        reinterpret_cast<t_libpd_multi_symbolhook>(instance_multi_symbol),
+                                        reinterpret_cast<t_libpd_multi_listhook>(instance_multi_list),
+                                        reinterpret_cast<t_libpd_multi_messagehook>(instance_multi_message));
+    }
 };
 
 }
@@ -123,28 +166,16 @@ Instance::Instance(std::string const& symbol)
 {
     libpd_multi_init();
     
-    canvasLock.lock();
+    instanceLock.lock();
     m_instance = libpd_new_instance();
-    canvasLock.unlock();
+    instanceLock.unlock();
     libpd_set_instance(static_cast<t_pdinstance *>(m_instance));
-    m_midi_receiver = libpd_multi_midi_new(this,
-                                           reinterpret_cast<t_libpd_multi_noteonhook>(internal::instance_multi_noteon),
-                                           reinterpret_cast<t_libpd_multi_controlchangehook>(internal::instance_multi_controlchange),
-                                           reinterpret_cast<t_libpd_multi_programchangehook>(internal::instance_multi_programchange),
-                                           reinterpret_cast<t_libpd_multi_pitchbendhook>(internal::instance_multi_pitchbend),
-                                           reinterpret_cast<t_libpd_multi_aftertouchhook>(internal::instance_multi_aftertouch),
-                                           reinterpret_cast<t_libpd_multi_polyaftertouchhook>(internal::instance_multi_polyaftertouch),
-                                           reinterpret_cast<t_libpd_multi_midibytehook>(internal::instance_multi_midibyte));
-    m_print_receiver = libpd_multi_print_new(this,
-                                             reinterpret_cast<t_libpd_multi_printhook>(internal::instance_multi_print));
-    
-    m_message_receiver[0] = libpd_multi_receiver_new(this, symbol.c_str(),
-                                                     reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang),
-                                                     reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float),
-                                                     reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
-                                                     reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list),
-                                                     reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message));
-    m_atoms = malloc(sizeof(t_atom) * 512);
+    m_midi_receiver = internal::midi_new(this);
+    m_print_receiver = internal::print_new(this);
+    m_gui_receiver = internal::gui_new(this);
+    
+    m_message_receiver[0] = internal::receiver_new(this, symbol.c_str());
+    m_receiver_names.push_back(symbol);
     
     
     libpd_set_verbose(0);
@@ -161,9 +192,13 @@ Instance::~Instance()
     
     pd_free((t_pd *)m_midi_receiver);
     pd_free((t_pd *)m_print_receiver);
+    pd_free((t_pd *)m_gui_receiver);
     
     libpd_set_instance(static_cast<t_pdinstance *>(m_instance));
+    
+    instanceLock.lock();
     libpd_free_instance(static_cast<t_pdinstance *>(m_instance));
+    instanceLock.unlock();
     
     
 }
@@ -175,25 +210,32 @@ Instance::~Instance()
 
 int Instance::getBlockSize() const noexcept
 {
-    return libpd_blocksize();
+    return m_block_size;
+}
+
+void Instance::setBlockSize(int blockSize) noexcept
+{
+    // Round up to a whole number of pd ticks
+    const int ticksize = libpd_blocksize();
+    m_block_size = std::max(ticksize, ((blockSize + ticksize - 1) / ticksize) * ticksize);
 }
 
 void Instance::addListener(const char* sym)
 {
-    
-    m_message_receiver.push_back(libpd_multi_receiver_new(this, sym,
-                                                          reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang),
-                                                          reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float),
-                                                          reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
-                                                          reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list),
-                                                          reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message)));
-    
+    m_message_receiver.push_back(internal::receiver_new(this, sym));
+    m_receiver_names.push_back(sym);
 }
 
 void Instance::prepareDSP(const int nins, const int nouts, const double samplerate)
 {
     libpd_set_instance(static_cast<t_pdinstance *>(m_instance));
     libpd_init_audio(nins, nouts, (int)samplerate);
+    
+    canvasLock.lock();
+    m_nins = nins;
+    m_nouts = nouts;
+    m_samplerate = samplerate;
+    canvasLock.unlock();
 }
 
 void Instance::startDSP()
@@ -211,10 +253,48 @@ void Instance::releaseDSP()
     libpd_message("pd", "dsp", 1, &av);
 }
 
+// Same as libpd_process_raw, but for a block of several ticks
+// The buffers contain one channel after another, each blockSize samples long
+static void performTicks(float const* inputs, float* outputs, int blockSize, Profiler* profiler)
+{
+    const int ticksize = libpd_blocksize();
+    const int nins = STUFF->st_inchannels;
+    const int nouts = STUFF->st_outchannels;
+    
+    sys_lock();
+    sys_pollgui();
+    for(int offset = 0; offset < blockSize; offset += ticksize)
+    {
+        for(int ch = 0; ch < nins; ch++)
+        {
+            std::copy_n(inputs + ch * blockSize + offset, ticksize, STUFF->st_soundin + ch * ticksize);
+        }
+        
+        std::fill_n(STUFF->st_soundout, nouts * ticksize, 0.f);
+        if(profiler)
+            profiler->tick();
+        else
+            sched_tick();
+        
+        for(int ch = 0; ch < nouts; ch++)
+        {
+            std::copy_n(STUFF->st_soundout + ch * ticksize, ticksize, outputs + ch * blockSize + offset);
+        }
+    }
+    sys_unlock();
+}
+
 void Instance::performDSP(float const* inputs, float* outputs)
 {
     libpd_set_instance(static_cast<t_pdinstance *>(m_instance));
-    libpd_process_raw(inputs, outputs);
+    performTicks(inputs, outputs, m_block_size, &profiler);
+}
+
+void Instance::performDSP(LoadedInstance& other, float const* inputs, float* outputs)
+{
+    libpd_set_instance(static_cast<t_pdinstance *>(other.instance));
+    performTicks(inputs, outputs, m_block_size, nullptr);
+    setThis();
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -304,38 +384,51 @@ void Instance::sendSymbol(const char* receiver, const char* symbol) const
     libpd_symbol(receiver, symbol);
 }
 
-void Instance::sendList(const char* receiver, const std::vector<Atom>& list) const
+// Converts a list to pd atoms, on the stack unless it's longer than AtomList::inlineSize
+// Symbols are interned, so this must run with the instance set
+class PdAtoms
+{
+public:
+    PdAtoms(AtomList const& list)
+    {
+        if(list.size() > AtomList::inlineSize)
+            m_heap.resize(list.size());
+        
+        t_atom* argv = data();
+        for(int i = 0; i < list.size(); ++i)
+        {
+            if(list[i].isFloat())
+                SETFLOAT(argv+i, list[i].getFloat());
+            else
+                SETSYMBOL(argv+i, list[i].getPdSymbol());
+        }
+    }
+    
+    t_atom* data() noexcept { return m_heap.empty() ? m_stack : m_heap.data(); }
+    
+private:
+    t_atom m_stack[AtomList::inlineSize];
+    std::vector<t_atom> m_heap;
+};
+
+void Instance::sendList(const char* receiver, const AtomList& list) const
 {
     if(!static_cast<t_pdinstance *>(m_instance))
         return;
     
-    t_atom* argv = static_cast<t_atom*>(m_atoms);
     libpd_set_instance(static_cast<t_pdinstance *>(m_instance));
-    for(size_t i = 0; i < list.size(); ++i)
-    {
-        if(list[i].isFloat())
-            libpd_set_float(argv+i, list[i].getFloat());
-        else
-            libpd_set_symbol(argv+i, list[i].getSymbol().c_str());
-    }
-    libpd_list(receiver, (int)list.size(), argv);
+    PdAtoms argv(list);
+    libpd_list(receiver, (int)list.size(), argv.data());
 }
 
-void Instance::sendMessage(const char* receiver, const char* msg, const std::vector<Atom>& list) const
+void Instance::sendMessage(const char* receiver, const char* msg, const AtomList& list) const
 {
     if(!static_cast<t_pdinstance *>(m_instance))
         return;
     
-    t_atom* argv = static_cast<t_atom*>(m_atoms);
     libpd_set_instance(static_cast<t_pdinstance *>(m_instance));
-    for(size_t i = 0; i < list.size(); ++i)
-    {
-        if(list[i].isFloat())
-            libpd_set_float(argv+i, list[i].getFloat());
-        else
-            libpd_set_symbol(argv+i, list[i].getSymbol().c_str());
-    }
-    libpd_message(receiver, msg, (int)list.size(), argv);
+    PdAtoms argv(list);
+    libpd_message(receiver, msg, (int)list.size(), argv.data());
 }
 
 void Instance::processMessages()
@@ -343,16 +436,18 @@ void Instance::processMessages()
     Message mess;
     while(m_message_queue.try_dequeue(mess))
     {
-        if(mess.selector == "bang")
-            receiveBang(mess.destination);
-        else if(mess.selector == "float")
-            receiveFloat(mess.destination, mess.list[0].getFloat());
-        else if(mess.selector == "symbol")
-            receiveSymbol(mess.destination, mess.list[0].getSymbol());
-        else if(mess.selector == "list")
-            receiveList(mess.destination, mess.list);
+        const char* dest = mess.destination->s_name;
+        
+        if(mess.type == Message::BANG)
+            receiveBang(dest);
+        else if(mess.type == Message::FLOAT)
+            receiveFloat(dest, mess.list[0].getFloat());
+        else if(mess.type == Message::SYMBOL)
+            receiveSymbol(dest, mess.list[0].getSymbol());
+        else if(mess.type == Message::LIST)
+            receiveList(dest, mess.list);
         else
-            receiveMessage(mess.destination, mess.selector, mess.list);
+            receiveMessage(dest, mess.selector->s_name, mess.list);
     }
 }
 
@@ -400,6 +495,17 @@ void Instance::processPrints()
     }
 }
 
+bool Instance::dequeueGuiUpdates(std::unordered_set<void*>& changed)
+{
+    void* object;
+    while(m_gui_queue.try_dequeue(object))
+    {
+        changed.insert(object);
+    }
+    
+    return !m_gui_queue_overflow.exchange(false);
+}
+
 void Instance::enqueueFunction(std::function<void(void)> fn) {
     
     //sys_lock();
@@ -412,13 +518,13 @@ void Instance::enqueueFunction(std::function<void(void)> fn) {
     messageEnqueued();
 }
 
-void Instance::enqueueMessages(const std::string& dest, const std::string& msg, std::vector<Atom>&& list)
+void Instance::enqueueMessages(const std::string& dest, const std::string& msg, AtomList&& list)
 {
     m_send_queue.try_enqueue(dmessage{nullptr, dest, msg, std::move(list)});
     messageEnqueued();
 }
 
-void Instance::enqueueDirectMessages(void* object, std::vector<Atom> const& list)
+void Instance::enqueueDirectMessages(void* object, AtomList const& list)
 {
     m_send_queue.try_enqueue(dmessage{object, std::string(), "list", list});
     messageEnqueued();
@@ -426,26 +532,26 @@ void Instance::enqueueDirectMessages(void* object, std::vector<Atom> const& list
 
 void Instance::enqueueDirectMessages(void* object, const std::string& msg)
 {
-    m_send_queue.try_enqueue(dmessage{object, std::string(), "s", std::vector<Atom>(1, msg)});
+    m_send_queue.try_enqueue(dmessage{object, std::string(), "symbol", AtomList{msg}});
     messageEnqueued();
 }
 
 void Instance::enqueueDirectMessages(void* object, const float msg)
 {
-    m_send_queue.try_enqueue(dmessage{object, std::string(), "float", std::vector<Atom>(1, msg)});
+    m_send_queue.try_enqueue(dmessage{object, std::string(), "float", AtomList{msg}});
     messageEnqueued();
 }
 
 void Instance::waitForStateUpdate() {
-    // Need to wait twice to ensure that pd has processed all changes
+    // Append an empty function to the end of the queue
+    // Once it has run, any actions we performed before are definitely finished
+    waitForResult(enqueueFunctionAsync([](){}));
+}
+
+void Instance::pollFunctionQueue() {
     if(audioStarted) {
-        // Append signal to resume thread at the end of the queue
-        // This will make sure that any actions we performed are definitely finished now
-        enqueueFunction([this](){
-            updateWait.signal();
-        });
-        
-        updateWait.wait();
+        // Dequeues from this thread if the audio callback isn't holding the lock
+        messageEnqueued();
     }
     // Should ensure that patches are loaded correctly when audio hasn't started yet
     else {
@@ -477,22 +583,9 @@ void Instance::sendMessagesFromQueue()
         {
             if(mess.selector == "list")
             {
-                t_atom* argv = static_cast<t_atom*>(m_atoms);
-                for(size_t i = 0; i < mess.list.size(); ++i)
-                {
-                    if(mess.list[i].isFloat())
-                        SETFLOAT(argv+i, mess.list[i].getFloat());
-                    else if(mess.list[i].isSymbol())
-                    {
-                        sys_lock();
-                        SETSYMBOL(argv+i, gensym(mess.list[i].getSymbol().data()));
-                        sys_unlock();
-                    }
-                    else
-                        SETFLOAT(argv+i, 0.0);
-                }
                 sys_lock();
-                pd_list(static_cast<t_pd *>(mess.object), gensym("list"), static_cast<int>(mess.list.size()), argv);
+                PdAtoms argv(mess.list);
+                pd_list(static_cast<t_pd *>(mess.object), &s_list, mess.list.size(), argv.data());
                 sys_unlock();
             }
             else if(mess.selector == "float" && mess.list[0].isFloat())
@@ -504,7 +597,7 @@ void Instance::sendMessagesFromQueue()
             else if(mess.selector == "symbol")
             {
                 sys_lock();
-                pd_symbol(static_cast<t_pd *>(mess.object), gensym(mess.list[0].getSymbol().c_str()));
+                pd_symbol(static_cast<t_pd *>(mess.object), mess.list[0].getPdSymbol());
                 sys_unlock();
             }
         }
@@ -514,8 +607,10 @@ void Instance::sendMessagesFromQueue()
         }
     }
     
+    canvasLock.lock();
     canUndo = libpd_can_undo(Patch::getCurrent());
     canRedo = libpd_can_redo(Patch::getCurrent());
+    canvasLock.unlock();
     
 }
 
@@ -550,6 +645,112 @@ Patch Instance::getPatch()
     return Patch(m_patch, this);
 }
 
+std::unique_ptr<Instance::LoadedInstance> Instance::prepareInstance(std::string const& path, std::string const& name)
+{
+    auto* previous = libpd_this_instance();
+    auto loaded = std::make_unique<LoadedInstance>();
+    
+    instanceLock.lock();
+    loaded->instance = libpd_new_instance();
+    instanceLock.unlock();
+    libpd_set_instance(static_cast<t_pdinstance *>(loaded->instance));
+    
+    loaded->midi_receiver = internal::midi_new(this);
+    loaded->print_receiver = internal::print_new(this);
+    loaded->gui_receiver = internal::gui_new(this);
+    for(auto const& symbol : m_receiver_names)
+        loaded->message_receivers.push_back(internal::receiver_new(this, symbol.c_str()));
+    
+    initialiseInstance();
+    
+    // DSP is off, so the chain isn't compiled again for every object that gets created
+    loaded->patch = libpd_create_canvas(name.c_str(), path.c_str());
+    if(loaded->patch)
+        canvas_setcurrent(static_cast<t_canvas*>(loaded->patch));
+    
+    // Compiling the chain here spares the audio thread from doing it when the patch comes in
+    restartInstance(*loaded);
+    
+    libpd_set_instance(previous);
+    return loaded;
+}
+
+void Instance::restartInstance(LoadedInstance& loaded)
+{
+    auto* previous = libpd_this_instance();
+    libpd_set_instance(static_cast<t_pdinstance *>(loaded.instance));
+    
+    canvasLock.lock();
+    loaded.nins = m_nins;
+    loaded.nouts = m_nouts;
+    loaded.samplerate = m_samplerate;
+    canvasLock.unlock();
+    
+    if(loaded.samplerate > 0)
+    {
+        // dac~ and adc~ point into the sound buffers, so the chain is rebuilt after they're reallocated
+        t_atom av;
+        libpd_set_float(&av, 0.f);
+        libpd_message("pd", "dsp", 1, &av);
+        libpd_init_audio(loaded.nins, loaded.nouts, (int)loaded.samplerate);
+        startDSP();
+    }
+    
+    libpd_set_instance(previous);
+}
+
+bool Instance::matchesSettings(LoadedInstance const& loaded) const noexcept
+{
+    return loaded.samplerate == m_samplerate && loaded.nins == m_nins && loaded.nouts == m_nouts;
+}
+
+std::unique_ptr<Instance::LoadedInstance> Instance::swapInstance(std::unique_ptr<LoadedInstance> next)
+{
+    // The gui closed the previous patch's canvases before this, what it queued until then is for that patch
+    setThis();
+    std::function<void(void)> callback;
+    while(m_function_queue.try_dequeue(callback))
+    {
+        callback();
+    }
+    
+    // The profiler follows the running instance, it starts over on the next tick
+    profiler.reset();
+    
+    std::swap(m_instance, next->instance);
+    std::swap(m_patch, next->patch);
+    std::swap(m_midi_receiver, next->midi_receiver);
+    std::swap(m_print_receiver, next->print_receiver);
+    std::swap(m_gui_receiver, next->gui_receiver);
+    std::swap(m_message_receiver, next->message_receivers);
+    
+    setThis();
+    return next;
+}
+
+Instance::LoadedInstance::~LoadedInstance()
+{
+    if(!instance)
+        return;
+    
+    libpd_set_instance(static_cast<t_pdinstance *>(instance));
+    
+    // Stop forwarding first, anything sent while the patch closes would outlive its symbols
+    for(auto* receiver : message_receivers)
+        pd_free(static_cast<t_pd*>(receiver));
+    
+    pd_free(static_cast<t_pd*>(midi_receiver));
+    pd_free(static_cast<t_pd*>(print_receiver));
+    pd_free(static_cast<t_pd*>(gui_receiver));
+    
+    if(patch)
+        libpd_closefile(patch);
+    
+    instanceLock.lock();
+    libpd_free_instance(static_cast<t_pdinstance *>(instance));
+    instanceLock.unlock();
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 
@@ -8,10 +8,13 @@
 
 #include <z_libpd.h>
 #include <JuceHeader.h>
+#include <future>
 #include <map>
+#include <unordered_set>
 #include <utility>
 #include "PdPatch.hpp"
 #include "PdAtom.hpp"
+#include "PdProfiler.hpp"
 
 #include "concurrentqueue.h"
 
@@ -34,7 +37,10 @@ public:
     void startDSP();
     void releaseDSP();
     void performDSP(float const* inputs, float* outputs);
+    
+    // Number of samples computed per performDSP call, always a multiple of pd's 64 sample tick
     int getBlockSize() const noexcept;
+    void setBlockSize(int blockSize) noexcept;
     
     void sendNoteOn(const int channel, const int pitch, const int velocity) const;
     void sendControlChange(const int channel, const int controller, const int value) const;
@@ -57,23 +63,63 @@ public:
     void sendBang(const char* receiver) const;
     void sendFloat(const char* receiver, float const value) const;
     void sendSymbol(const char* receiver, const char* symbol) const;
-    void sendList(const char* receiver, const std::vector<Atom>& list) const;
-    void sendMessage(const char* receiver, const char* msg, const std::vector<Atom>& list) const;
+    void sendList(const char* receiver, const AtomList& list) const;
+    void sendMessage(const char* receiver, const char* msg, const AtomList& list) const;
     
     virtual void receivePrint(const std::string& message) {
         
     };
     
-    virtual void receiveBang(const std::string& dest) {}
-    virtual void receiveFloat(const std::string& dest, float num) {}
-    virtual void receiveSymbol(const std::string& dest, const std::string& symbol) {}
-    virtual void receiveList(const std::string& dest, const std::vector<Atom>& list) {}
-    virtual void receiveMessage(const std::string& dest, const std::string& msg, const std::vector<Atom>& list) {}
+    // These are called from processMessages, which may run on the audio thread, so they don't take allocating types
+    virtual void receiveBang(const char* dest) {}
+    virtual void receiveFloat(const char* dest, float num) {}
+    virtual void receiveSymbol(const char* dest, const char* symbol) {}
+    virtual void receiveList(const char* dest, const AtomList& list) {}
+    virtual void receiveMessage(const char* dest, const char* msg, const AtomList& list) {}
     
     void enqueueFunction(std::function<void(void)> fn);
-    void enqueueMessages(const std::string& dest, const std::string& msg, std::vector<Atom>&& list);
     
-    void enqueueDirectMessages(void* object, std::vector<Atom> const& list);
+    //! @brief Enqueues a function for the pd thread and returns a future for its result.
+    //! @details Functions enqueued before the next audio block are all run in the same dequeue,
+    //! so callers that need many results should enqueue everything first and only then wait.
+    template<typename F>
+    auto enqueueFunctionAsync(F fn) -> std::future<std::invoke_result_t<F>>
+    {
+        using T = std::invoke_result_t<F>;
+        
+        auto promise = std::make_shared<std::promise<T>>();
+        auto future = promise->get_future();
+        
+        enqueueFunction([promise, fn]() mutable {
+            if constexpr (std::is_void_v<T>) {
+                fn();
+                promise->set_value();
+            }
+            else {
+                promise->set_value(fn());
+            }
+        });
+        
+        return future;
+    }
+    
+    //! @brief Waits for a result from the pd thread.
+    //! @details Doesn't rely on the audio callback running: while waiting, the queue is dequeued
+    //! from this thread whenever the callback lock is free.
+    template<typename T>
+    T waitForResult(std::future<T> future)
+    {
+        while(future.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready)
+        {
+            pollFunctionQueue();
+        }
+        
+        return future.get();
+    }
+    
+    void enqueueMessages(const std::string& dest, const std::string& msg, AtomList&& list);
+    
+    void enqueueDirectMessages(void* object, AtomList const& list);
     void enqueueDirectMessages(void* object, const std::string& msg);
     void enqueueDirectMessages(void* object, const float msg);
     
@@ -84,6 +130,11 @@ public:
     void sendMessagesFromQueue();
     void processMessages();
     void processPrints();
+    
+    //! @brief Collects the gui objects that reported a value change since the last call.
+    //! @details Returns false if changes were lost because nobody collected them in time,
+    //! in which case all guis should be updated.
+    bool dequeueGuiUpdates(std::unordered_set<void*>& changed);
     void processMidi();
     
     void openPatch(std::string const& path, std::string const& name);
@@ -91,6 +142,55 @@ public:
     void closePatch();
     Patch getPatch();
     
+    //! @brief A pd instance with a patch open in it, ready to take over from the running one.
+    //! @details Made by prepareInstance() and put in place by swapInstance(), which hands back the
+    //! previous instance in the same form. Deleting it frees the instance and its patch.
+    struct LoadedInstance
+    {
+        LoadedInstance() = default;
+        LoadedInstance(LoadedInstance const& other) = delete;
+        ~LoadedInstance();
+        
+        void* instance                          = nullptr;
+        void* patch                             = nullptr;
+        void* midi_receiver                     = nullptr;
+        void* print_receiver                    = nullptr;
+        void* gui_receiver                      = nullptr;
+        std::vector<void*> message_receivers;
+        
+        // The audio settings it was prepared with, no audio yet if the samplerate is 0
+        int nins                                = 0;
+        int nouts                               = 0;
+        double samplerate                       = 0;
+    };
+    
+    //! @brief Opens a patch in a new pd instance, with the same receivers as this one.
+    //! @details Nothing of the running instance is touched or locked, so this can take its time on
+    //! any thread but the audio thread while the current patch keeps playing. The patch is opened
+    //! with DSP off, then DSP is started with the settings of the last prepareDSP().
+    std::unique_ptr<LoadedInstance> prepareInstance(std::string const& path, std::string const& name);
+    
+    //! @brief Starts the DSP of a prepared instance again with the settings of the last prepareDSP().
+    //! @details For when the settings changed since prepareInstance(), this allocates like it does.
+    void restartInstance(LoadedInstance& loaded);
+    
+    //! @brief Checks if a prepared instance has the audio settings of the running one.
+    //! @details Must be called with canvasLock locked, like swapInstance().
+    bool matchesSettings(LoadedInstance const& loaded) const noexcept;
+    
+    //! @brief Puts a prepared instance in place of the running one and returns the previous one.
+    //! @details This must run between two blocks, from the audio thread or with it held off, and with
+    //! canvasLock locked. It only swaps pointers, so the prepared instance has to match the audio
+    //! settings already, see matchesSettings(). Functions still queued for the previous patch run
+    //! first, with it set. The previous instance can still be computed with performDSP() to fade it out.
+    std::unique_ptr<LoadedInstance> swapInstance(std::unique_ptr<LoadedInstance> next);
+    
+    //! @brief Computes a block of an instance that was swapped out, with the same buffer layout.
+    void performDSP(LoadedInstance& other, float const* inputs, float* outputs);
+    
+    //! @brief Called with a new instance set, before prepareInstance() opens the patch in it.
+    virtual void initialiseInstance() {}
+    
     void setThis();
     Array getArray(std::string const& name);
     
@@ -101,6 +201,7 @@ public:
     t_canvas* getCurrentCanvas();
 
     void waitForStateUpdate();
+    void pollFunctionQueue();
     
     virtual const CriticalSection* getCallbackLock() { return nullptr; };
     
@@ -109,9 +210,9 @@ public:
     
     void* m_instance                         = nullptr;
     void* m_patch                            = nullptr;
-    void* m_atoms                            = nullptr;
     void* m_midi_receiver                    = nullptr;
     void* m_print_receiver                   = nullptr;
+    void* m_gui_receiver                     = nullptr;
     std::vector<void*> m_message_receiver    = std::vector<void*>(1, nullptr);
     
     moodycamel::ConcurrentQueue<std::function<void(void)>> m_function_queue = moodycamel::ConcurrentQueue<std::function<void(void)>>(4096);
@@ -119,14 +220,34 @@ public:
     std::atomic<bool> audioStarted = false;
     std::atomic<bool> canUndo = false;
     std::atomic<bool> canRedo = false;
-    static inline std::recursive_mutex canvasLock;
+    // Guards this instance's canvas state between the gui and the audio thread
+    // Each instance has its own lock, so plugin instances don't serialize each other's DSP
+    std::recursive_mutex canvasLock;
+    
+    // Per-object DSP timing, disabled until the gui asks for it
+    Profiler profiler;
+    
+    // Only used while creating and freeing pd instances, which touches pd's global instance list
+    static inline std::mutex instanceLock;
     
     private:
+    // Fixed-size record for messages coming from pd
+    // Symbols are already interned by pd, so the hooks only copy pointers and never allocate
+    // Lists longer than AtomList::inlineSize are cut, with an error
     struct Message
     {
-        std::string       selector;
-        std::string       destination;
-        std::vector<Atom> list;
+        enum
+        {
+            BANG,
+            FLOAT,
+            SYMBOL,
+            LIST,
+            ANYTHING
+        } type;
+        
+        t_symbol* destination;
+        t_symbol* selector;
+        AtomList  list;
     };
     
     struct dmessage
@@ -134,7 +255,7 @@ public:
         void*       object;
         std::string destination;
         std::string selector;
-        std::vector<Atom> list;
+        AtomList    list;
     };
     
     typedef struct midievent
@@ -161,10 +282,17 @@ public:
     moodycamel::ConcurrentQueue<Message> m_message_queue = moodycamel::ConcurrentQueue<Message>(4096);
     moodycamel::ConcurrentQueue<midievent> m_midi_queue = moodycamel::ConcurrentQueue<midievent>(4096);
     moodycamel::ConcurrentQueue<std::string> m_print_queue = moodycamel::ConcurrentQueue<std::string>(4096);
+    moodycamel::ConcurrentQueue<void*> m_gui_queue = moodycamel::ConcurrentQueue<void*>(4096);
+    std::atomic<bool> m_gui_queue_overflow = false;
 
-
     
-    WaitableEvent updateWait;
+    int m_block_size = 64;
+    
+    // Kept to set up the instances made by prepareInstance() the same way, guarded by canvasLock
+    int m_nins = 0;
+    int m_nouts = 0;
+    double m_samplerate = 0;
+    std::vector<std::string> m_receiver_names;
     
     struct internal;
     
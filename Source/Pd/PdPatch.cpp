@@ -72,25 +72,23 @@ std::array<int, 4> Patch::getBounds() const noexcept
 }
 
 void Patch::setCurrent() {
+    setCurrent(getPointer(), m_instance);
+}
+
+void Patch::setCurrent(t_canvas* cnv, Instance* instance)
+{
+    instance->setThis();
     
-    m_instance->setThis();
-    
-    
-    m_instance->canvasLock.lock();
-    canvas_setcurrent(getPointer());
-    canvas_vis(getPointer(), 1.);
-    m_instance->canvasLock.unlock();
-    
-    
+    instance->canvasLock.lock();
+    canvas_setcurrent(cnv);
+    canvas_vis(cnv, 1.);
+    instance->canvasLock.unlock();
 }
 
 t_canvas* Patch::getCurrent()
 {
-       
-    Instance::canvasLock.lock();
-    auto* current = canvas_getcurrent();
-    Instance::canvasLock.unlock();
-    return current;
+    // The caller should hold the canvasLock of the current instance
+    return canvas_getcurrent();
 }
 
 std::vector<Object> Patch::getObjects(bool only_gui) noexcept
@@ -123,52 +121,80 @@ std::vector<Object> Patch::getObjects(bool only_gui) noexcept
 }
 
 
+// The functions for the pd thread capture the canvas and instance by value, since they may run
+// after this Patch is gone. The owner pointer is only handed to the new objects, never read.
+
+std::future<std::unique_ptr<Object>> Patch::createGraphOnParentAsync(int x, int y) {
+    return m_instance->enqueueFunctionAsync([owner = this, cnv = getPointer(), instance = m_instance, x, y]() -> std::unique_ptr<Object> {
+        instance->setThis();
+        auto* pdobject = libpd_creategraphonparent(cnv, x, y);
+        
+        assert(pdobject);
+        
+        return std::make_unique<Gui>(pdobject, owner, instance);
+    });
+}
+
 std::unique_ptr<Object> Patch::createGraphOnParent(int x, int y) {
-    t_pd* pdobject = nullptr;
-    m_instance->enqueueFunction([this, x, y, &pdobject]() mutable {
-        m_instance->setThis();
-        pdobject = libpd_creategraphonparent(static_cast<t_canvas*>(m_ptr), x, y);
+    return m_instance->waitForResult(createGraphOnParentAsync(x, y));
+}
+
+std::future<std::unique_ptr<Object>> Patch::createGraphAsync(String name, int size, int x, int y)
+{
+    return m_instance->enqueueFunctionAsync([owner = this, cnv = getPointer(), instance = m_instance, name, size, x, y]() -> std::unique_ptr<Object> {
+        instance->setThis();
+        auto* pdobject = libpd_creategraph(cnv, name.toRawUTF8(), size, x, y);
+        
+        assert(pdobject);
+        
+        return std::make_unique<Gui>(pdobject, owner, instance);
     });
-    
-    m_instance->waitForStateUpdate();
-    
-    
-    assert(pdobject);
-    
-    return std::make_unique<Gui>(pdobject, this, m_instance);
 }
 
 std::unique_ptr<Object> Patch::createGraph(String name, int size, int x, int y)
 {
-    t_pd* pdobject = nullptr;
-    m_instance->enqueueFunction([this, name, size, x, y, &pdobject]() mutable {
-        m_instance->setThis();
-        pdobject = libpd_creategraph(static_cast<t_canvas*>(m_ptr), name.toRawUTF8(), size, x, y);
-    });
-    
-    m_instance->waitForStateUpdate();
-    
-    assert(pdobject);
-    
-    return std::make_unique<Gui>(pdobject, this, m_instance);
+    return m_instance->waitForResult(createGraphAsync(name, size, x, y));
 }
 
-std::unique_ptr<Object> Patch::createObject(String name, int x, int y)
+std::future<std::unique_ptr<Object>> Patch::createObjectAsync(String name, int x, int y)
 {
-    
-    if(!m_ptr) return nullptr;
+    if(!m_ptr) {
+        std::promise<std::unique_ptr<Object>> none;
+        none.set_value(nullptr);
+        return none.get_future();
+    }
     
     x /= zoom;
     y /= zoom;
     
+    return m_instance->enqueueFunctionAsync([owner = this, cnv = getPointer(), instance = m_instance, name, x, y]() -> std::unique_ptr<Object> {
+        instance->setThis();
+        
+        sys_lock();
+        auto* pdobject = createObjectFromText(cnv, name, x, y);
+        sys_unlock();
+        
+        assert(pdobject);
+        
+        return wrapObject(pdobject, owner, instance);
+    });
+}
+
+std::unique_ptr<Object> Patch::createObject(String name, int x, int y)
+{
+    return m_instance->waitForResult(createObjectAsync(name, x, y));
+}
+
+t_pd* Patch::createObjectFromText(t_canvas* cnv, String const& name, int x, int y)
+{
     StringArray tokens;
     tokens.addTokens(name, " ", "");
     
     if(tokens[0] == "graph" && tokens.size() == 3) {
-        return createGraph(tokens[1], tokens[2].getIntValue(), x, y);
+        return libpd_creategraph(cnv, tokens[1].toRawUTF8(), tokens[2].getIntValue(), x, y);
     }
     else if(tokens[0] == "graph") {
-        return createGraphOnParent(x, y);
+        return libpd_creategraphonparent(cnv, x, y);
     }
     
     t_symbol* typesymbol = gensym("obj");
@@ -206,29 +232,22 @@ std::unique_ptr<Object> Patch::createObject(String name, int x, int y)
             SETSYMBOL(argv.data() + i + 2, gensym(tokens[i].toRawUTF8()));
         }
     }
-    t_pd* pdobject = nullptr;
-    m_instance->enqueueFunction([this, argc, argv, typesymbol, &pdobject]() mutable {
-        m_instance->setThis();
-        pdobject = libpd_createobj(static_cast<t_canvas*>(m_ptr), typesymbol, argc, argv.data());
-    });
     
-    while(!pdobject) {
-        m_instance->waitForStateUpdate();
-    }
-    
-    assert(pdobject);
-    
-    bool isGui = Gui::getType(pdobject) != Type::Undefined;
+    return libpd_createobj_locked(cnv, typesymbol, argc, argv.data());
+}
+
+std::unique_ptr<Object> Patch::wrapObject(t_pd* ptr, Patch* owner, Instance* instance)
+{
+    bool isGui = Gui::getType(ptr) != Type::Undefined;
     
     if(isGui) {
-        return std::make_unique<Gui>(pdobject, this, m_instance);
+        return std::make_unique<Gui>(ptr, owner, instance);
     }
     else {
-        return std::make_unique<Object>(pdobject, this, m_instance);
+        return std::make_unique<Object>(ptr, owner, instance);
     }
 }
 
-
 void Patch::copy() {
     m_instance->enqueueFunction([this]() {
         libpd_copy(getPointer());
@@ -273,41 +292,41 @@ void Patch::removeObject(Object* obj)
     
 }
 
-bool Patch::canConnect(Object* src, int nout, Object* sink, int nin) {
-    
-    bool can_connect = false;
-    
-    m_instance->enqueueFunction([this, &can_connect, src, nout, sink, nin]() mutable {
-        
-        can_connect = libpd_canconnect(getPointer(), checkObject(src), nout, checkObject(sink), nin);
+std::future<bool> Patch::canConnectAsync(Object* src, int nout, Object* sink, int nin) {
+    return m_instance->enqueueFunctionAsync([cnv = getPointer(), src, nout, sink, nin]() -> bool {
+        return libpd_canconnect(cnv, checkObject(src), nout, checkObject(sink), nin);
     });
-                                
-    m_instance->waitForStateUpdate();
+}
 
-    return can_connect;
+bool Patch::canConnect(Object* src, int nout, Object* sink, int nin) {
+    return m_instance->waitForResult(canConnectAsync(src, nout, sink, nin));
 }
 
-bool Patch::createConnection(Object* src, int nout, Object* sink, int nin)
+std::future<bool> Patch::createConnectionAsync(Object* src, int nout, Object* sink, int nin)
 {
-    if(!src || !sink || !m_ptr) return false;
-    
-    bool can_connect = false;
+    if(!src || !sink || !m_ptr) {
+        std::promise<bool> none;
+        none.set_value(false);
+        return none.get_future();
+    }
     
-    m_instance->enqueueFunction([this, &can_connect, src, nout, sink, nin]() mutable {
+    return m_instance->enqueueFunctionAsync([cnv = getPointer(), instance = m_instance, src, nout, sink, nin]() -> bool {
         
-        can_connect = libpd_canconnect(getPointer(), checkObject(src), nout, checkObject(sink), nin);
+        bool can_connect = libpd_canconnect(cnv, checkObject(src), nout, checkObject(sink), nin);
         
-        if(!can_connect) return;
+        if(!can_connect) return false;
         
-        m_instance->setThis();
+        instance->setThis();
         
-        libpd_createconnection(getPointer(), checkObject(src), nout, checkObject(sink), nin);
+        libpd_createconnection(cnv, checkObject(src), nout, checkObject(sink), nin);
+        
+        return true;
     });
-    
-    m_instance->waitForStateUpdate();
-    
-    
-    return can_connect;
+}
+
+bool Patch::createConnection(Object* src, int nout, Object* sink, int nin)
+{
+    return m_instance->waitForResult(createConnectionAsync(src, nout, sink, nin));
 }
 
 void Patch::removeConnection(Object* src, int nout, Object* sink, int nin)
@@ -352,19 +371,113 @@ std::unique_ptr<Object> Patch::renameObject(Object* obj, String name) {
 void Patch::moveObjects(std::vector<Object*> objects, int dx, int dy) {
     //if(!obj || !m_ptr) return;
     
-    m_instance->enqueueFunction([this, objects, dx, dy]() mutable {
-        setCurrent();
+    Transaction transaction(this);
+    transaction.moveObjects(objects, dx, dy);
+    transaction.apply();
+}
+
+int Patch::Transaction::createObject(String name, int x, int y)
+{
+    x /= zoom;
+    y /= zoom;
+    
+    m_operations.push_back([name, x, y](t_canvas* cnv, std::vector<t_pd*>& created) {
+        created.push_back(createObjectFromText(cnv, name, x, y));
+    });
+    
+    return m_num_created++;
+}
+
+void Patch::Transaction::removeObject(ObjectRef obj)
+{
+    m_operations.push_back([obj](t_canvas* cnv, std::vector<t_pd*>& created) {
+        if(auto* object = resolve(obj, created)) {
+            libpd_removeobj_undoable(cnv, &object->te_g);
+            
+            // Created earlier in this transaction and freed now, later steps and the result skip it
+            if(!obj.object) {
+                created[obj.index] = nullptr;
+            }
+        }
+    });
+}
+
+void Patch::Transaction::createConnection(ObjectRef src, int nout, ObjectRef sink, int nin)
+{
+    m_operations.push_back([src, nout, sink, nin](t_canvas* cnv, std::vector<t_pd*>& created) {
+        auto* srcObject = resolve(src, created);
+        auto* sinkObject = resolve(sink, created);
+        
+        if(!srcObject || !sinkObject) return;
         
+        if(libpd_canconnect(cnv, srcObject, nout, sinkObject, nin)) {
+            libpd_createconnection(cnv, srcObject, nout, sinkObject, nin);
+        }
+    });
+}
+
+void Patch::Transaction::moveObjects(std::vector<Object*> objects, int dx, int dy)
+{
+    m_operations.push_back([objects, dx, dy](t_canvas* cnv, std::vector<t_pd*>&) {
         for(auto* obj : objects) {
             if(!obj) continue;
-            glist_select(getPointer(), &checkObject(obj)->te_g);
+            glist_select(cnv, &checkObject(obj)->te_g);
         }
         
-        libpd_moveselection(getPointer(), dx / zoom, dy / zoom);
+        libpd_moveselection(cnv, dx / zoom, dy / zoom);
         
-        glist_noselect(getPointer());
+        glist_noselect(cnv);
         EDITOR->canvas_undo_already_set_move = 0;
-        setCurrent();
+    });
+}
+
+t_object* Patch::Transaction::resolve(ObjectRef ref, std::vector<t_pd*> const& created)
+{
+    if(ref.object) {
+        return checkObject(ref.object);
+    }
+    if(ref.index >= 0 && ref.index < static_cast<int>(created.size()) && created[ref.index]) {
+        return pd_checkobject(created[ref.index]);
+    }
+    
+    return nullptr;
+}
+
+std::future<std::vector<std::unique_ptr<Object>>> Patch::Transaction::apply()
+{
+    auto operations = std::move(m_operations);
+    int numCreated = m_num_created;
+    
+    m_operations.clear();
+    m_num_created = 0;
+    
+    // Like the patch edits, this may run after the Patch is gone, so it doesn't read it
+    return m_patch->m_instance->enqueueFunctionAsync([owner = m_patch, cnv = m_patch->getPointer(), instance = m_patch->m_instance, operations, numCreated]() {
+        std::vector<t_pd*> created;
+        created.reserve(numCreated);
+        
+        setCurrent(cnv, instance);
+        
+        sys_lock();
+        libpd_start_undo_sequence(cnv, "transaction");
+        
+        for(auto const& operation : operations) {
+            operation(cnv, created);
+        }
+        
+        libpd_end_undo_sequence(cnv, "transaction");
+        sys_unlock();
+        
+        setCurrent(cnv, instance);
+        
+        std::vector<std::unique_ptr<Object>> result;
+        result.reserve(created.size());
+        
+        for(auto* ptr : created) {
+            result.push_back(ptr ? wrapObject(ptr, owner, instance) : nullptr);
+        }
+        
+        return result;
     });
 }
 
@@ -410,7 +523,7 @@ void Patch::setZoom(int zoom)
     pd_typedmess((t_pd*)getPointer(), gensym("zoom"), 2, &arg);
 }
 
-t_object* Patch::checkObject(Object* obj) const noexcept {
+t_object* Patch::checkObject(Object* obj) noexcept {
     return pd_checkobject(static_cast<t_pd*>(obj->getPointer()));
 }
 
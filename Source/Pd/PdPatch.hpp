@@ -8,6 +8,7 @@
 #include "PdGui.hpp"
 #include "x_libpd_mod_utils.h"
 #include <array>
+#include <future>
 #include <vector>
 #include <JuceHeader.h>
 
@@ -48,6 +49,13 @@ public:
     //! @brief Gets the bounds of the patch.
     std::array<int, 4> getBounds() const noexcept;
     
+    // The async versions return as soon as the edit is queued for the pd thread, they capture
+    // everything by value so the future stays valid after this Patch is gone
+    // The blocking versions wait for that result, without depending on the audio callback
+    std::future<std::unique_ptr<Object>> createGraphAsync(String name, int size, int x, int y);
+    std::future<std::unique_ptr<Object>> createGraphOnParentAsync(int x, int y);
+    std::future<std::unique_ptr<Object>> createObjectAsync(String name, int x, int y);
+    
     std::unique_ptr<Object> createGraph(String name, int size, int x, int y);
     std::unique_ptr<Object> createGraphOnParent(int x, int y);
     
@@ -81,6 +89,9 @@ public:
     void setCurrent();
     static t_canvas* getCurrent();
     
+    std::future<bool> canConnectAsync(Object* src, int nout, Object* sink, int nin);
+    std::future<bool> createConnectionAsync(Object* src, int nout, Object* sink, int nin);
+    
     bool canConnect(Object* src, int nout, Object* sink, int nin);
     bool createConnection(Object* src, int nout, Object* sink, int nin);
     void removeConnection(Object* src, int nout, Object*sink, int nin);
@@ -106,13 +117,61 @@ public:
         return String(buf, bufsize);
     }
 
-    t_object* checkObject(Object* obj) const noexcept;
+    static t_object* checkObject(Object* obj) noexcept;
     
     void keyPress(int keycode, int shift);
     
     static inline float zoom = 1.7f;
     
+    //! @brief A batch of edits that is applied to the patch at once.
+    //! @details All operations run in a single function on the pd thread, under a single pd lock,
+    //! and are grouped into a single undo step. Positions use the same zoomed coordinates as Patch.
+    class Transaction
+    {
+    public:
+        //! @brief Refers to an existing object, or to an object created earlier in the same transaction.
+        struct ObjectRef
+        {
+            ObjectRef(Object* obj) : object(obj) {}
+            ObjectRef(int idx) : index(idx) {}
+            
+            Object* object = nullptr;
+            int     index  = -1;
+        };
+        
+        Transaction(Patch* patch) noexcept : m_patch(patch) {}
+        
+        //! @brief Creates an object from its text.
+        //! @details Returns the index of the new object in the result of apply.
+        int createObject(String name, int x, int y);
+        
+        void removeObject(ObjectRef obj);
+        void createConnection(ObjectRef src, int nout, ObjectRef sink, int nin);
+        void moveObjects(std::vector<Object*> objects, int dx, int dy);
+        
+        //! @brief Queues all operations for the pd thread and clears the transaction.
+        //! @details The future holds the created objects, in the order they were added. Objects that
+        //! failed to create, or were removed again in the same transaction, are nullptr.
+        std::future<std::vector<std::unique_ptr<Object>>> apply();
+        
+    private:
+        using Operation = std::function<void(t_canvas*, std::vector<t_pd*>&)>;
+        
+        static t_object* resolve(ObjectRef ref, std::vector<t_pd*> const& created);
+        
+        Patch*                 m_patch;
+        std::vector<Operation> m_operations;
+        int                    m_num_created = 0;
+    };
+    
 private:
+    
+    static void setCurrent(t_canvas* cnv, Instance* instance);
+    
+    // Parses the text of an object and creates it, the caller should hold the pd lock
+    static t_pd* createObjectFromText(t_canvas* cnv, String const& name, int x, int y);
+    
+    static std::unique_ptr<Object> wrapObject(t_pd* ptr, Patch* owner, Instance* instance);
 
     
     void*     m_ptr      = nullptr;
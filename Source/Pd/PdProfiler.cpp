@@ -0,0 +1,381 @@
+/*
+ // Copyright (c) 2015-2018 Pierre Guillot.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+extern "C"
+{
+#include <m_imp.h>
+#include <g_canvas.h>
+#include <s_stuff.h>
+}
+
+#include "PdProfiler.hpp"
+
+namespace pd
+{
+namespace
+{
+// The beginning of pd's private DSP state, see struct _instanceugen in d_ugen.c.
+// It has started with these two fields since pd 0.47, check it again before allowing a newer pd.
+#if PD_MAJOR_VERSION != 0 || PD_MINOR_VERSION < 47 || PD_MINOR_VERSION > 55
+#error "pd::Profiler: check that struct _instanceugen in d_ugen.c still starts with u_dspchain and u_dspchainsize"
+#endif
+
+struct instanceugen
+{
+    t_int* u_dspchain;
+    int u_dspchainsize;
+};
+
+instanceugen* getUgen()
+{
+    return reinterpret_cast<instanceugen*>(pd_this->pd_ugen);
+}
+
+t_methodentry* findMethod(t_class* c, t_symbol* s, int instance)
+{
+    t_methodentry* mlist;
+#ifdef PDINSTANCE
+    mlist = c->c_methods[instance];
+#else
+    mlist = c->c_methods;
+#endif
+
+    for(int i = 0; i < c->c_nmethod; i++)
+    {
+        if(mlist[i].me_name == s)
+            return mlist + i;
+    }
+    return nullptr;
+}
+
+// Classes are shared by all the instances, the profilers are looked up by instance
+std::mutex registryMutex;
+std::unordered_map<t_class*, t_gotfn> originalMethods;
+std::unordered_map<t_pdinstance*, Profiler*> profilers;
+
+// The profiler computing a tick on this thread, for the first entry of its chain to find it
+thread_local Profiler* ticking = nullptr;
+
+// About a third of a second at 44.1kHz
+constexpr int ticksPerResult = 256;
+}
+
+// ==================================================================================== //
+//                                      PROFILER                                        //
+// ==================================================================================== //
+
+Profiler::~Profiler()
+{
+    // The instance is gone by now, and its method tables and chain with it
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto it = profilers.find(m_instance);
+    if(it != profilers.end() && it->second == this)
+        profilers.erase(it);
+}
+
+void Profiler::setEnabled(bool state) noexcept
+{
+    m_enabled = state;
+}
+
+bool Profiler::isEnabled() const noexcept
+{
+    return m_enabled;
+}
+
+bool Profiler::getResults(std::vector<Entry>& entries, double& total)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!m_hasResults)
+        return false;
+
+    entries = m_published;
+    total = m_total;
+    return true;
+}
+
+void Profiler::reset()
+{
+    if(m_active)
+        stop();
+}
+
+void Profiler::tick()
+{
+    const bool enabled = m_enabled.load(std::memory_order_relaxed);
+    if(enabled != m_active)
+        enabled ? start() : stop();
+
+    auto* ugen = getUgen();
+
+    // The chain was compiled again since the last tick
+    if(m_active && (ugen->u_dspchain != m_chain || (m_chain && ugen->u_dspchainsize != m_chainsize) || !m_records.empty()))
+        adoptChain();
+
+    if(!m_active || !m_chain)
+    {
+        sched_tick();
+        return;
+    }
+
+    // The first routine of the chain is replaced by one that runs the chain with timing. The rest of
+    // the chain stays in place, since clocks in the tick may run parts of it, like a switch~ banged
+    // by a metro does with block_bang
+    m_first = m_chain[0];
+    m_chain[0] = reinterpret_cast<t_int>(perform);
+    ticking = this;
+
+    sched_tick();
+
+    ticking = nullptr;
+
+    // A message in the tick may have compiled the chain again, then pd freed this one already
+    if(ugen->u_dspchain == m_chain && ugen->u_dspchainsize == m_chainsize && m_chain[0] == reinterpret_cast<t_int>(perform))
+    {
+        m_chain[0] = m_first;
+
+        if(++m_ticks >= ticksPerResult)
+            publish();
+    }
+}
+
+void Profiler::start()
+{
+    m_instance = pd_this;
+    m_active = true;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    profilers[m_instance] = this;
+}
+
+void Profiler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        profilers.erase(m_instance);
+
+        // Instances created meanwhile copied the wrapped methods, they're restored there too
+        // unless another profiler is using them
+        t_symbol* dsp = gensym("dsp");
+#ifdef PDINSTANCE
+        const int ninstances = pd_ninstances;
+#else
+        const int ninstances = 1;
+#endif
+        for(int i = 0; i < ninstances; i++)
+        {
+#ifdef PDINSTANCE
+            if(profilers.count(pd_instances[i]))
+                continue;
+#endif
+            for(auto* c : m_wrapped)
+            {
+                auto* method = findMethod(c, dsp, i);
+                if(method && method->me_fun == reinterpret_cast<t_gotfn>(dspMethod))
+                    method->me_fun = originalMethods[c];
+            }
+        }
+    }
+
+    // The chain stays as it is, the records just aren't needed anymore
+    m_wrapped.clear();
+    m_records.clear();
+    m_ranges.clear();
+    m_chain = nullptr;
+    m_chainsize = 0;
+    m_active = false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_published.clear();
+    m_hasResults = false;
+}
+
+bool Profiler::wrapClasses()
+{
+    bool wrapped = false;
+    for(t_canvas* cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next)
+    {
+        wrapCanvas(cnv, wrapped);
+    }
+    return wrapped;
+}
+
+void Profiler::wrapCanvas(t_canvas* cnv, bool& wrapped)
+{
+    t_symbol* dsp = gensym("dsp");
+    for(t_gobj* y = cnv->gl_list; y; y = y->g_next)
+    {
+        t_class* c = pd_class(&y->g_pd);
+        if(c == canvas_class)
+            wrapCanvas(reinterpret_cast<t_canvas*>(y), wrapped);
+
+        if(!m_wrapped.insert(c).second)
+            continue;
+
+        // New instances copy their methods from the first one, so it may already be wrapped
+#ifdef PDINSTANCE
+        auto* method = findMethod(c, dsp, pd_this->pd_instanceno);
+#else
+        auto* method = findMethod(c, dsp, 0);
+#endif
+        if(!method || method->me_fun == reinterpret_cast<t_gotfn>(dspMethod))
+            continue;
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        originalMethods.emplace(c, method->me_fun);
+        method->me_fun = reinterpret_cast<t_gotfn>(dspMethod);
+        wrapped = true;
+    }
+}
+
+void Profiler::dspMethod(t_pd* x, t_signal** sp)
+{
+    t_gotfn original = nullptr;
+    Profiler* profiler = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto method = originalMethods.find(pd_class(x));
+        if(method == originalMethods.end())
+            return;
+
+        original = method->second;
+        auto it = profilers.find(pd_this);
+        if(it != profilers.end())
+            profiler = it->second;
+    }
+
+    // Everything the object adds to the chain belongs to it, for a subpatch that's its content
+    auto* ugen = getUgen();
+    const int start = ugen->u_dspchainsize;
+    reinterpret_cast<void(*)(t_pd*, t_signal**)>(original)(x, sp);
+
+    if(profiler)
+        profiler->m_records.push_back({x, start, ugen->u_dspchainsize});
+}
+
+void Profiler::adoptChain()
+{
+    auto* ugen = getUgen();
+
+    // Objects created since the last compilation may be of classes that aren't wrapped yet
+    if(ugen->u_dspchain && wrapClasses())
+        canvas_update_dsp();
+
+    m_chain = ugen->u_dspchain;
+    m_chainsize = m_chain ? ugen->u_dspchainsize : 0;
+    m_ranges.clear();
+
+    if(m_chain)
+    {
+        // The records may span several compilations, the end only goes down when a new one starts
+        size_t first = 0;
+        for(size_t i = 1; i < m_records.size(); i++)
+        {
+            if(m_records[i].end < m_records[i - 1].end)
+                first = i;
+        }
+
+        // A subpatch is recorded after its content, so it's sorted before it when the ranges are equal
+        std::vector<Record> records(m_records.rbegin(), m_records.rend() - first);
+        std::stable_sort(records.begin(), records.end(), [](Record const& lhs, Record const& rhs){
+            return lhs.start < rhs.start || (lhs.start == rhs.start && lhs.end > rhs.end);
+        });
+
+        m_ranges.reserve(records.size());
+        std::vector<Range const*> parents;
+        for(auto const& record : records)
+        {
+            while(!parents.empty())
+            {
+                auto const* parent = parents.back();
+                if(parent->start < parent->end && record.start >= parent->start && record.end <= parent->end)
+                    break;
+                parents.pop_back();
+            }
+
+            auto* object = static_cast<t_pd*>(record.object);
+            const bool isCanvas = pd_class(object) == canvas_class;
+
+            Entry entry;
+            entry.object = record.object;
+            entry.name = isCanvas ? reinterpret_cast<t_canvas*>(object)->gl_name->s_name : class_getname(pd_class(object));
+            entry.parent = parents.empty() ? nullptr : parents.back()->entry.object;
+            entry.parentName = parents.empty() ? nullptr : parents.back()->entry.name;
+            entry.time = 0;
+
+            m_ranges.push_back({entry, record.start, record.end});
+            if(isCanvas)
+                parents.push_back(&m_ranges.back());
+        }
+    }
+
+    m_records.clear();
+    m_times.assign(m_chainsize, 0.0);
+    m_sums.assign(m_chainsize + 1, 0.0);
+    m_entries.reserve(m_ranges.size());
+    m_ticks = 0;
+}
+
+t_int* Profiler::perform(t_int* w)
+{
+    // Runs like the caller would, until a routine ends the chain. That's dsp_tick, or block_bang
+    // for a switch~ at the top of the chain, whose epilog ends it early
+    ticking->run(w);
+    return nullptr;
+}
+
+void Profiler::run(t_int* ip)
+{
+    using clock = std::chrono::steady_clock;
+
+    auto last = clock::now();
+    while(ip)
+    {
+        double& time = m_times[ip - m_chain];
+        const t_int routine = ip == m_chain ? m_first : *ip;
+        ip = (*reinterpret_cast<t_perfroutine>(routine))(ip);
+
+        const auto now = clock::now();
+        time += std::chrono::duration<double, std::nano>(now - last).count();
+        last = now;
+    }
+}
+
+void Profiler::publish()
+{
+    // Each range covers its perform routines and those of the objects it contains
+    for(int i = 0; i < m_chainsize; i++)
+    {
+        m_sums[i + 1] = m_sums[i] + m_times[i];
+    }
+
+    m_entries.clear();
+    for(auto const& range : m_ranges)
+    {
+        Entry entry = range.entry;
+        entry.time = (m_sums[range.end] - m_sums[range.start]) / m_ticks;
+        m_entries.push_back(entry);
+    }
+
+    const double total = m_sums[m_chainsize] / m_ticks;
+
+    // The gui may be reading, then these results are skipped
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if(lock.owns_lock())
+    {
+        std::swap(m_entries, m_published);
+        m_total = total;
+        m_hasResults = true;
+    }
+
+    std::fill(m_times.begin(), m_times.end(), 0.0);
+    m_ticks = 0;
+}
+}
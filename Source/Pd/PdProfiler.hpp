@@ -0,0 +1,107 @@
+/*
+ // Copyright (c) 2015-2018 Pierre Guillot.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <m_pd.h>
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace pd
+{
+// ==================================================================================== //
+//                                      PROFILER                                        //
+// ==================================================================================== //
+
+//! @brief Measures how much time each object spends in the DSP chain of an instance.
+//! @details While enabled, the dsp methods of the objects are wrapped to record which part of
+//! the chain each object adds, and the chain is run step by step to time every perform routine.
+//! The times are summed per object, a subpatch includes the objects it contains.
+//! When disabled, the only cost is a check per tick.
+class Profiler
+{
+public:
+    struct Entry
+    {
+        void* object;           // The object, only meant to be compared since it may be gone
+        void* parent;           // The subpatch that contains it, nullptr at the top level
+        const char* name;       // The class name, or the name of a subpatch
+        const char* parentName; // The name of the subpatch that contains it
+        double time;            // The average nanoseconds spent per tick
+    };
+
+    Profiler() = default;
+    Profiler(Profiler const& other) = delete;
+    ~Profiler();
+
+    //! @brief Enables or disables the profiling, from any thread.
+    //! @details This takes effect on the next tick.
+    void setEnabled(bool state) noexcept;
+    bool isEnabled() const noexcept;
+
+    //! @brief Computes a tick, replacing sched_tick.
+    //! @details This must be called with the instance set and locked.
+    void tick();
+
+    //! @brief Gets the last measurements, from any thread.
+    //! @details Returns false if nothing was measured yet.
+    //! @param total The average nanoseconds spent in the whole chain per tick.
+    bool getResults(std::vector<Entry>& entries, double& total);
+
+    //! @brief Stops measuring the instance, the next tick starts over with the instance set then.
+    //! @details Used when the instance is replaced, this must be called with the old one still set.
+    void reset();
+
+private:
+    struct Record
+    {
+        void* object;
+        int start;
+        int end;
+    };
+
+    struct Range
+    {
+        Entry entry;
+        int start;
+        int end;
+    };
+
+    void start();
+    void stop();
+    bool wrapClasses();
+    void wrapCanvas(t_canvas* cnv, bool& wrapped);
+    void adoptChain();
+    void publish();
+    void run(t_int* ip);
+
+    static void dspMethod(t_pd* x, t_signal** sp);
+    static t_int* perform(t_int* w);
+
+    std::atomic<bool> m_enabled = false;
+    bool m_active               = false;
+    t_pdinstance* m_instance    = nullptr;
+
+    t_int* m_chain              = nullptr;
+    int m_chainsize             = 0;
+    t_int m_first               = 0;
+    std::unordered_set<t_class*> m_wrapped;
+
+    std::vector<Record> m_records;
+    std::vector<Range> m_ranges;
+    std::vector<double> m_times;
+    std::vector<double> m_sums;
+    int m_ticks = 0;
+
+    std::vector<Entry> m_entries;
+    std::vector<Entry> m_published;
+    double m_total      = 0;
+    bool m_hasResults   = false;
+    std::mutex m_mutex;
+};
+}
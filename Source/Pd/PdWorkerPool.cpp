@@ -0,0 +1,162 @@
+/*
+ // Copyright (c) 2015-2018 Pierre Guillot.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <algorithm>
+#include <chrono>
+
+#include "PdWorkerPool.hpp"
+
+namespace pd
+{
+// ==================================================================================== //
+//                                      WORKER POOL                                     //
+// ==================================================================================== //
+
+WorkerPool& WorkerPool::getInstance()
+{
+    // Leave one core for the audio thread, which helps with the jobs anyway
+    static WorkerPool pool(std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1));
+    return pool;
+}
+
+WorkerPool::WorkerPool(int numThreads)
+{
+    for(int i = 0; i < numThreads; i++)
+    {
+        m_threads.emplace_back([this](){ workerLoop(); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    m_running = false;
+    m_condition.notify_all();
+
+    for(auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+int WorkerPool::getNumThreads() const noexcept
+{
+    return static_cast<int>(m_threads.size());
+}
+
+void WorkerPool::submit(Job& job)
+{
+    job.m_done.store(false, std::memory_order_relaxed);
+    job.m_pending = true;
+
+    m_queued++;
+    if(!m_queue.try_enqueue(&job))
+    {
+        // The queue is full, so do the work now rather than dropping the block
+        m_queued--;
+        job.run();
+        job.m_done.store(true, std::memory_order_release);
+        return;
+    }
+
+    m_condition.notify_one();
+}
+
+void WorkerPool::wait(Job& job)
+{
+    if(!job.m_pending)
+        return;
+
+    while(!job.m_done.load(std::memory_order_acquire))
+    {
+        // Our job is either running on a worker or still queued behind other jobs
+        if(!runOne())
+            std::this_thread::yield();
+    }
+
+    job.m_pending = false;
+}
+
+bool WorkerPool::runOne()
+{
+    Job* job = nullptr;
+    if(!m_queue.try_dequeue(job))
+        return false;
+
+    m_queued--;
+    job->run();
+    job->m_done.store(true, std::memory_order_release);
+    return true;
+}
+
+void WorkerPool::workerLoop()
+{
+    while(m_running)
+    {
+        if(runOne())
+            continue;
+
+        // Submitting doesn't take the mutex, so a notification can be missed; the timeout bounds that
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait_for(lock, std::chrono::milliseconds(1), [this](){
+            return m_queued > 0 || !m_running;
+        });
+    }
+}
+
+// ==================================================================================== //
+//                                      LOADER                                          //
+// ==================================================================================== //
+
+Loader& Loader::getInstance()
+{
+    static Loader loader;
+    return loader;
+}
+
+Loader::Loader()
+{
+    m_thread = std::thread([this](){ loaderLoop(); });
+}
+
+Loader::~Loader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+}
+
+void Loader::enqueue(std::function<void(void)> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void Loader::loaderLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true)
+    {
+        m_condition.wait(lock, [this](){ return !m_tasks.empty() || !m_running; });
+
+        // Tasks left at exit are dropped, pd is being torn down anyway
+        if(!m_running)
+            return;
+
+        auto task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+}
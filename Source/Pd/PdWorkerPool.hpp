@@ -0,0 +1,118 @@
+/*
+ // Copyright (c) 2015-2018 Pierre Guillot.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "concurrentqueue.h"
+
+namespace pd
+{
+// ==================================================================================== //
+//                                      WORKER POOL                                     //
+// ==================================================================================== //
+
+//! @brief A pool of threads that render DSP jobs for the audio thread.
+//! @details Jobs are submitted from the audio thread and collected later in the same callback.
+//! A thread that waits for a job doesn't sleep: it takes queued jobs from the pool and runs them
+//! itself, so the audio thread never waits for a worker that hasn't started yet.
+//! @see HostedPatch
+class WorkerPool
+{
+public:
+    //! @brief A unit of work for the pool.
+    //! @details The owner must keep the job alive until wait() has returned.
+    class Job
+    {
+    public:
+        virtual ~Job() = default;
+
+        //! @brief Does the work, on whichever thread picked up the job.
+        virtual void run() = 0;
+
+        //! @brief Checks if the job was submitted and hasn't been waited for yet.
+        bool isPending() const noexcept { return m_pending; }
+
+    private:
+        std::atomic<bool> m_done = true;
+        bool m_pending = false;
+
+        friend class WorkerPool;
+    };
+
+    //! @brief Gets the pool shared by all instances.
+    //! @details The threads are started by the first call.
+    static WorkerPool& getInstance();
+
+    WorkerPool(WorkerPool const& other) = delete;
+    ~WorkerPool();
+
+    //! @brief Queues a job.
+    //! @details Doesn't allocate or lock, so it's safe to call from the audio thread.
+    void submit(Job& job);
+
+    //! @brief Waits until a submitted job is done, helping with queued jobs meanwhile.
+    //! @details Returns immediately if the job wasn't submitted.
+    void wait(Job& job);
+
+    //! @brief Gets the number of worker threads, not counting the threads that help in wait().
+    int getNumThreads() const noexcept;
+
+private:
+    WorkerPool(int numThreads);
+
+    void workerLoop();
+    bool runOne();
+
+    moodycamel::ConcurrentQueue<Job*> m_queue = moodycamel::ConcurrentQueue<Job*>(1024);
+    std::atomic<int> m_queued = 0;
+    std::atomic<bool> m_running = true;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<std::thread> m_threads;
+};
+
+// ==================================================================================== //
+//                                      LOADER                                          //
+// ==================================================================================== //
+
+//! @brief A background thread for the slow parts of hosting patches.
+//! @details Creating and freeing pd instances and loading patches can't happen in an object's
+//! constructor or destructor, because these run on the audio thread with the instance locked.
+//! The tasks are run one after another in the order they were added.
+class Loader
+{
+public:
+    //! @brief Gets the loader shared by all instances.
+    static Loader& getInstance();
+
+    Loader(Loader const& other) = delete;
+    ~Loader();
+
+    //! @brief Adds a task at the end of the queue.
+    void enqueue(std::function<void(void)> task);
+
+private:
+    Loader();
+
+    void loaderLoop();
+
+    std::deque<std::function<void(void)>> m_tasks;
+    bool m_running = true;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_thread;
+};
+}
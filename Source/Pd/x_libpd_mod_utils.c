@@ -163,6 +163,16 @@ void libpd_removeselection(t_canvas* x)
     canvas_undo_add(x, UNDO_SEQUENCE_END, "clear", 0);
 }
 
+void libpd_start_undo_sequence(t_canvas* x, const char* name)
+{
+    canvas_undo_add(x, UNDO_SEQUENCE_START, name, 0);
+}
+
+void libpd_end_undo_sequence(t_canvas* x, const char* name)
+{
+    canvas_undo_add(x, UNDO_SEQUENCE_END, name, 0);
+}
+
 void canvas_savedeclarationsto(t_canvas *x, t_binbuf *b);
 
 
@@ -484,9 +494,16 @@ t_pd* libpd_creategraph(t_canvas* cnv, const char* name, int size, int x, int y)
 t_pd* libpd_createobj(t_canvas* cnv, t_symbol *s, int argc, t_atom *argv) {
         
     sys_lock();
-    pd_typedmess((t_pd*)cnv, s, argc, argv);
+    t_pd* result = libpd_createobj_locked(cnv, s, argc, argv);
     sys_unlock();
     
+    return result;
+}
+
+t_pd* libpd_createobj_locked(t_canvas* cnv, t_symbol *s, int argc, t_atom *argv) {
+    
+    pd_typedmess((t_pd*)cnv, s, argc, argv);
+    
     // Needed here but not for graphs??
     canvas_undo_add(cnv, UNDO_CREATE, "create",
                     (void *)canvas_undo_set_create(cnv));
@@ -510,6 +527,19 @@ void libpd_removeobj(t_canvas* cnv, t_gobj* obj)
     glist_noselect(cnv);
 }
 
+void libpd_removeobj_undoable(t_canvas* cnv, t_gobj* obj)
+{
+    glist_noselect(cnv);
+    glist_select(cnv, obj);
+    
+    canvas_undo_add(cnv, UNDO_CUT, "clear",
+                    canvas_undo_set_cut(cnv, 2));
+    
+    libpd_canvas_doclear(cnv);
+    
+    glist_noselect(cnv);
+}
+
 
 void libpd_renameobj(t_canvas* cnv, t_gobj* obj, const char* buf, int bufsize)
 {
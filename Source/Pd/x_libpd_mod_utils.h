@@ -22,10 +22,14 @@ extern "C"
 t_pd* libpd_newest(t_canvas* cnv);
 
 t_pd* libpd_createobj(t_canvas* cnv, t_symbol *s, int argc, t_atom *argv);
+// Same as libpd_createobj, for callers that already hold the pd lock
+t_pd* libpd_createobj_locked(t_canvas* cnv, t_symbol *s, int argc, t_atom *argv);
 t_pd* libpd_creategraph(t_canvas* cnv, const char* name, int size, int x, int y);
 t_pd* libpd_creategraphonparent(t_canvas* cnv, int x, int y);
 
 void libpd_removeobj(t_canvas* cnv, t_gobj* obj);
+// Same as libpd_removeobj, but also adds the removal to the undo history
+void libpd_removeobj_undoable(t_canvas* cnv, t_gobj* obj);
 void libpd_renameobj(t_canvas* cnv, t_gobj* obj, const char* buf, int bufsize);
 void libpd_moveobj(t_canvas* cnv, t_gobj* obj, int x, int y);
 
@@ -40,6 +44,10 @@ void libpd_redo(t_canvas *x);
 // Start and end of remove action, to group them together for undo/redo
 void libpd_removeselection(t_canvas* x);
 
+// Group all undo actions between start and end into a single undo step
+void libpd_start_undo_sequence(t_canvas* x, const char* name);
+void libpd_end_undo_sequence(t_canvas* x, const char* name);
+
 void libpd_moveselection(t_canvas* cnv, int dx, int dy);
 
 void libpd_createconnection(t_canvas* cnv, t_object*src, int nout, t_object*sink, int nin);
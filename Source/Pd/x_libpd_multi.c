@@ -33,31 +33,31 @@ typedef struct _libpd_multi_receiver
 static void libpd_multi_receiver_bang(t_libpd_multi_receiver *x)
 {
     if(x->x_hook_bang)
-        x->x_hook_bang(x->x_ptr, x->x_sym->s_name);
+        x->x_hook_bang(x->x_ptr, x->x_sym);
 }
 
 static void libpd_multi_receiver_float(t_libpd_multi_receiver *x, t_float f)
 {
     if(x->x_hook_float)
-        x->x_hook_float(x->x_ptr, x->x_sym->s_name, f);
+        x->x_hook_float(x->x_ptr, x->x_sym, f);
 }
 
 static void libpd_multi_receiver_symbol(t_libpd_multi_receiver *x, t_symbol *s)
 {
     if(x->x_hook_symbol)
-        x->x_hook_symbol(x->x_ptr, x->x_sym->s_name, s->s_name);
+        x->x_hook_symbol(x->x_ptr, x->x_sym, s);
 }
 
 static void libpd_multi_receiver_list(t_libpd_multi_receiver *x, t_symbol *s, int argc, t_atom *argv)
 {
     if(x->x_hook_list)
-        x->x_hook_list(x->x_ptr, x->x_sym->s_name, argc, argv);
+        x->x_hook_list(x->x_ptr, x->x_sym, argc, argv);
 }
 
 static void libpd_multi_receiver_anything(t_libpd_multi_receiver *x, t_symbol *s, int argc, t_atom *argv)
 {
     if(x->x_hook_message)
-        x->x_hook_message(x->x_ptr, x->x_sym->s_name, s->s_name, argc, argv);
+        x->x_hook_message(x->x_ptr, x->x_sym, s, argc, argv);
 }
 
 static void libpd_multi_receiver_free(t_libpd_multi_receiver *x)
@@ -252,10 +252,15 @@ static void libpd_multi_print(const char* message)
     }
 }
 
+static void libpd_multi_print_free(t_libpd_multi_print *x)
+{
+    pd_unbind(&x->x_obj.ob_pd, gensym("#libpd_multi_print"));
+}
+
 static void libpd_multi_print_setup(void)
 {
     sys_lock();
-    libpd_multi_print_class = class_new(gensym("libpd_multi_print"), (t_newmethod)NULL, (t_method)NULL,
+    libpd_multi_print_class = class_new(gensym("libpd_multi_print"), (t_newmethod)NULL, (t_method)libpd_multi_print_free,
                                        sizeof(t_libpd_multi_print), CLASS_DEFAULT, A_NULL, 0);
     sys_unlock();
 }
@@ -276,8 +281,89 @@ void* libpd_multi_print_new(void* ptr, t_libpd_multi_printhook hook_print)
     return x;
 }
 
+void* libpd_multi_print_current(void)
+{
+    return gensym("#libpd_multi_print")->s_thing;
+}
+
+void libpd_multi_print_gethook(void* receiver, void** ptr, t_libpd_multi_printhook* hook_print)
+{
+    t_libpd_multi_print* x = (t_libpd_multi_print*)receiver;
+    *ptr = x ? x->x_ptr : NULL;
+    *hook_print = x ? x->x_hook : NULL;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+static t_class *libpd_multi_gui_class;
+
+typedef struct _libpd_multi_gui
+{
+    t_object    x_obj;
+    void*       x_ptr;
+    t_libpd_multi_guihook x_hook;
+} t_libpd_multi_gui;
+
+void libpd_multi_gui_changed(void* object)
+{
+    t_libpd_multi_gui* x = (t_libpd_multi_gui*)gensym("#libpd_multi_gui")->s_thing;
+    if(x && x->x_hook)
+    {
+        x->x_hook(x->x_ptr, object);
+    }
+}
+
+static void libpd_multi_gui_free(t_libpd_multi_gui *x)
+{
+    pd_unbind(&x->x_obj.ob_pd, gensym("#libpd_multi_gui"));
+}
+
+static void libpd_multi_gui_setup(void)
+{
+    sys_lock();
+    libpd_multi_gui_class = class_new(gensym("libpd_multi_gui"), (t_newmethod)NULL, (t_method)libpd_multi_gui_free,
+                                      sizeof(t_libpd_multi_gui), CLASS_DEFAULT, A_NULL, 0);
+    sys_unlock();
+}
+
+void* libpd_multi_gui_new(void* ptr, t_libpd_multi_guihook hook_gui)
+{
+
+    t_libpd_multi_gui *x = (t_libpd_multi_gui *)pd_new(libpd_multi_gui_class);
+    if(x)
+    {
+        sys_lock();
+        t_symbol* s = gensym("#libpd_multi_gui");
+        sys_unlock();
+        pd_bind(&x->x_obj.ob_pd, s);
+        x->x_ptr = ptr;
+        x->x_hook = hook_gui;
+    }
+    return x;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+
+// [; pd telemetry( is passed on to the plugin, which listens to "__telemetry" and answers on [r telemetry]
+static void libpd_multi_telemetry(t_pd *x, t_symbol *s, int argc, t_atom *argv)
+{
+    t_symbol* receiver = gensym("__telemetry");
+    if(receiver->s_thing)
+        pd_typedmess(receiver->s_thing, s, argc, argv);
+}
+
+static void libpd_multi_telemetry_setup(void)
+{
+    class_addmethod(pd_class(gensym("pd")->s_thing), (t_method)libpd_multi_telemetry, gensym("telemetry"), A_GIMME, 0);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -324,6 +410,12 @@ void setup_bend0x2ein(void);
 void setup_bend0x2eout(void);
 void bicoeff_setup(void);
 void biquads_tilde_setup(void);
+void setup_bl0x2eimp_tilde(void);
+void setup_bl0x2esaw_tilde(void);
+void setup_bl0x2esquare_tilde(void);
+void setup_bl0x2etri_tilde(void);
+void setup_bl0x2evsaw_tilde(void);
+void setup_bl0x2ewavetable_tilde(void);
 void blocksize_tilde_setup(void);
 void break_setup(void);
 void brown_tilde_setup(void);
@@ -358,6 +450,7 @@ void colors_setup(void);
 void setup_comb0x2efilt_tilde(void);
 void setup_comb0x2erev_tilde(void);
 void setup_common0x2ediv(void);
+void conv_tilde_setup(void);
 void cosine_tilde_setup(void);
 void crackle_tilde_setup(void);
 void crossover_tilde_setup(void);
@@ -521,6 +614,7 @@ void standard_tilde_setup(void);
 void status_tilde_setup(void);
 void stepnoise_tilde_setup(void);
 void store_setup(void);
+void setup_stream0x2efile_tilde(void);
 void susloop_tilde_setup(void);
 void suspedal_setup(void);
 void svfilter_tilde_setup(void);
@@ -561,6 +655,11 @@ void zerocross_tilde_setup(void);
 void pvtuner_tilde_setup(void);
 // end fftease objects functions declaration
 
+// plugdata objects functions declaration
+void parallel_tilde_setup(void);
+void poly_tilde_setup(void);
+// end plugdata objects functions declaration
+
 void libpd_multi_init(void)
 {
     static int initialized = 0;
@@ -580,6 +679,8 @@ void libpd_multi_init(void)
         libpd_multi_receiver_setup();
         libpd_multi_midi_setup();
         libpd_multi_print_setup();
+        libpd_multi_gui_setup();
+        libpd_multi_telemetry_setup();
         libpd_defaultfont_init();
         libpd_set_verbose(4);
 
@@ -602,6 +703,12 @@ void libpd_multi_init(void)
         setup_bend0x2eout();
         bicoeff_setup();
         biquads_tilde_setup();
+        setup_bl0x2eimp_tilde();
+        setup_bl0x2esaw_tilde();
+        setup_bl0x2esquare_tilde();
+        setup_bl0x2etri_tilde();
+        setup_bl0x2evsaw_tilde();
+        setup_bl0x2ewavetable_tilde();
         blocksize_tilde_setup();
         break_setup();
         brown_tilde_setup();
@@ -636,6 +743,7 @@ void libpd_multi_init(void)
         setup_comb0x2efilt_tilde();
         setup_comb0x2erev_tilde();
         setup_common0x2ediv();
+        conv_tilde_setup();
         cosine_tilde_setup();
         crackle_tilde_setup();
         crossover_tilde_setup();
@@ -801,6 +909,7 @@ void libpd_multi_init(void)
         status_tilde_setup();
         stepnoise_tilde_setup();
         store_setup();
+        setup_stream0x2efile_tilde();
         susloop_tilde_setup();
         suspedal_setup();
         svfilter_tilde_setup();
@@ -841,6 +950,11 @@ void libpd_multi_init(void)
         pvtuner_tilde_setup();
         // end fftease objects initialization
 
+        // plugdata objects initialization
+        parallel_tilde_setup();
+        poly_tilde_setup();
+        // end plugdata objects initialization
+
         initialized = 1;
     }
 }
@@ -16,11 +16,11 @@ extern "C"
 
 void libpd_multi_init(void);
 
-typedef void (*t_libpd_multi_banghook)(void* ptr, const char *recv);
-typedef void (*t_libpd_multi_floathook)(void* ptr, const char *recv, float f);
-typedef void (*t_libpd_multi_symbolhook)(void* ptr, const char *recv, const char *s);
-typedef void (*t_libpd_multi_listhook)(void* ptr, const char *recv, int argc, t_atom *argv);
-typedef void (*t_libpd_multi_messagehook)(void* ptr, const char *recv, const char *msg, int argc, t_atom *argv);
+typedef void (*t_libpd_multi_banghook)(void* ptr, t_symbol *recv);
+typedef void (*t_libpd_multi_floathook)(void* ptr, t_symbol *recv, float f);
+typedef void (*t_libpd_multi_symbolhook)(void* ptr, t_symbol *recv, t_symbol *s);
+typedef void (*t_libpd_multi_listhook)(void* ptr, t_symbol *recv, int argc, t_atom *argv);
+typedef void (*t_libpd_multi_messagehook)(void* ptr, t_symbol *recv, t_symbol *msg, int argc, t_atom *argv);
 
 void* libpd_multi_receiver_new(void* ptr, char const *s,
                                t_libpd_multi_banghook hook_bang,
@@ -51,6 +51,19 @@ typedef void (*t_libpd_multi_printhook)(void* ptr, const char *recv);
 
 void* libpd_multi_print_new(void* ptr, t_libpd_multi_printhook hook_print);
 
+// Gets the print receiver of the current instance, if any
+void* libpd_multi_print_current(void);
+
+// Gets the pointer and the hook a print receiver was created with, so another instance can print through them
+void libpd_multi_print_gethook(void* receiver, void** ptr, t_libpd_multi_printhook* hook_print);
+
+typedef void (*t_libpd_multi_guihook)(void* ptr, void* object);
+
+void* libpd_multi_gui_new(void* ptr, t_libpd_multi_guihook hook_gui);
+
+// Tells the gui receiver of the current instance that the value of a gui object changed
+void libpd_multi_gui_changed(void* object);
+
 #ifdef __cplusplus
 }
 #endif
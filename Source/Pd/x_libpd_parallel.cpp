@@ -0,0 +1,251 @@
+/*
+ // Copyright (c) 2015-2018 Pierre Guillot.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+extern "C"
+{
+#include <z_libpd.h>
+#include <g_canvas.h>
+}
+
+#include "PdHostedPatch.hpp"
+#include "PdWorkerPool.hpp"
+
+// [parallel~ -ninsig <n> -noutsig <n> -suspend <ms> <object> <args...>]
+// Computes an object, usually an abstraction, in a pd instance of its own on the worker pool.
+// Each block, the object computes the input of the previous block while the rest of the patch
+// runs, so the outputs are delayed by one block. Messages go to the object's first inlet.
+// Since it's a separate instance, sends, receives, arrays, values and throw~/catch~ inside the
+// object don't reach the owner patch, and the other way around. Only printing goes through.
+// With a suspend time, the object stops being computed once its inputs and outputs have been
+// silent for that long without any message, like a subpatch switched off by switch~.
+// A message or a signal above -100dB wakes it up. It doesn't sleep while a clock is set in the
+// hosted patch, since clocks only advance when it's computed, so a running [metro] or a pending
+// [delay] keeps it awake.
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+struct parallel_job : public pd::WorkerPool::Job
+{
+    void run() override
+    {
+        patch->process(inputs.data(), outputs.data(), blocksize, samplerate, messages);
+    }
+
+    std::shared_ptr<pd::HostedPatch> patch;
+    std::vector<float> inputs;
+    std::vector<float> outputs;
+    t_binbuf* messages = nullptr;
+    int blocksize = 0;
+    float samplerate = 0.f;
+};
+
+static t_class *parallel_tilde_class;
+
+typedef struct _parallel_tilde
+{
+    t_object    x_obj;
+    t_float     x_f;
+    int         x_nins;
+    int         x_nouts;
+    int         x_nsiginlets;
+    t_binbuf*   x_pending;
+    t_float     x_suspend;
+    double      x_silent;
+    bool        x_asleep;
+
+    parallel_job*           x_job;
+    std::vector<t_sample*>* x_vectors;
+} t_parallel_tilde;
+
+static t_int *parallel_tilde_perform(t_int *w)
+{
+    t_parallel_tilde *x = (t_parallel_tilde *)(w[1]);
+    int n = (int)(w[2]);
+    parallel_job& job = *x->x_job;
+    auto& vectors = *x->x_vectors;
+    auto& pool = pd::WorkerPool::getInstance();
+
+    pool.wait(job);
+
+    // Read all the inputs before writing the outputs, pd may reuse input vectors for outputs
+    for(int ch = 0; ch < x->x_nins; ch++)
+        std::copy_n(vectors[ch], n, job.inputs.data() + ch * n);
+
+    for(int ch = 0; ch < x->x_nouts; ch++)
+        std::copy_n(job.outputs.data() + ch * n, n, vectors[x->x_nsiginlets + ch]);
+
+    auto const state = job.patch->getState();
+    if(state == pd::HostedPatch::Ready)
+    {
+        const bool idle = binbuf_getnatom(x->x_pending) == 0 && !job.patch->hasClocks() &&
+                          pd::HostedPatch::isSilent(job.inputs.data(), job.inputs.size()) &&
+                          pd::HostedPatch::isSilent(job.outputs.data(), job.outputs.size());
+
+        x->x_silent = idle ? x->x_silent + n : 0;
+        if(x->x_suspend > 0 && x->x_silent >= x->x_suspend * 0.001 * job.samplerate)
+        {
+            // Output true silence while asleep, not the tail of the last block
+            if(!x->x_asleep)
+                std::fill(job.outputs.begin(), job.outputs.end(), 0.f);
+            x->x_asleep = true;
+        }
+        else
+        {
+            x->x_asleep = false;
+            // The job's buffer was cleared by its last run
+            std::swap(x->x_pending, job.messages);
+            pool.submit(job);
+        }
+    }
+    else if(state == pd::HostedPatch::Failed)
+    {
+        binbuf_clear(x->x_pending);
+    }
+
+    return (w+3);
+}
+
+static void parallel_tilde_dsp(t_parallel_tilde *x, t_signal **sp)
+{
+    // The block of the previous chain may still be running
+    pd::WorkerPool::getInstance().wait(*x->x_job);
+
+    const int n = sp[0]->s_n;
+    if(n % libpd_blocksize())
+    {
+        pd_error(x, "parallel~: block size %d isn't a multiple of %d", n, libpd_blocksize());
+        for(int ch = 0; ch < x->x_nouts; ch++)
+            dsp_add_zero(sp[x->x_nsiginlets + ch]->s_vec, n);
+        return;
+    }
+
+    parallel_job& job = *x->x_job;
+    job.patch->setSampleRate(sp[0]->s_sr);
+    job.blocksize = n;
+    job.samplerate = sp[0]->s_sr;
+    job.inputs.assign(x->x_nins * n, 0.f);
+    job.outputs.assign(x->x_nouts * n, 0.f);
+    x->x_silent = 0;
+    x->x_asleep = false;
+
+    x->x_vectors->resize(x->x_nsiginlets + x->x_nouts);
+    for(int i = 0; i < x->x_nsiginlets + x->x_nouts; i++)
+        (*x->x_vectors)[i] = sp[i]->s_vec;
+
+    dsp_add(parallel_tilde_perform, 2, x, n);
+}
+
+static void parallel_tilde_anything(t_parallel_tilde *x, t_symbol *s, int argc, t_atom *argv)
+{
+    // Kept until the next block, when the hosted instance isn't running
+    t_atom selector;
+    SETSYMBOL(&selector, s);
+    binbuf_add(x->x_pending, 1, &selector);
+    binbuf_add(x->x_pending, argc, argv);
+    binbuf_addsemi(x->x_pending);
+}
+
+static void parallel_tilde_suspend(t_parallel_tilde *x, t_floatarg ms)
+{
+    x->x_suspend = std::max(ms, 0.f);
+}
+
+static void *parallel_tilde_new(t_symbol *s, int argc, t_atom *argv)
+{
+    int nins = 2, nouts = 2;
+    t_float suspend = 0;
+    while(argc >= 2 && argv[0].a_type == A_SYMBOL && argv[0].a_w.w_symbol->s_name[0] == '-')
+    {
+        const char* flag = argv[0].a_w.w_symbol->s_name;
+        if(!strcmp(flag, "-ninsig"))
+            nins = std::max(0, (int)atom_getfloat(argv + 1));
+        else if(!strcmp(flag, "-noutsig"))
+            nouts = std::max(0, (int)atom_getfloat(argv + 1));
+        else if(!strcmp(flag, "-suspend"))
+            suspend = std::max(0.f, atom_getfloat(argv + 1));
+        else
+            pd_error(nullptr, "parallel~: unknown flag %s", flag);
+        argc -= 2;
+        argv += 2;
+    }
+
+    if(!argc || argv[0].a_type != A_SYMBOL)
+    {
+        pd_error(nullptr, "parallel~: no object to host");
+        return nullptr;
+    }
+
+    t_parallel_tilde *x = (t_parallel_tilde *)pd_new(parallel_tilde_class);
+    x->x_nins = nins;
+    x->x_nouts = nouts;
+    x->x_nsiginlets = std::max(nins, 1);
+    x->x_suspend = suspend;
+    x->x_silent = 0;
+    x->x_asleep = false;
+    for(int i = 1; i < nins; i++)
+        inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+    for(int i = 0; i < nouts; i++)
+        outlet_new(&x->x_obj, &s_signal);
+
+    t_binbuf* b = binbuf_new();
+    binbuf_add(b, argc, argv);
+    char* text; int size;
+    binbuf_gettext(b, &text, &size);
+    binbuf_free(b);
+
+    x->x_pending = binbuf_new();
+    x->x_vectors = new std::vector<t_sample*>();
+    x->x_job = new parallel_job();
+    x->x_job->messages = binbuf_new();
+    x->x_job->patch = std::make_shared<pd::HostedPatch>(canvas_getdir(canvas_getcurrent())->s_name,
+                                                        std::string(text, size), nins, nouts, sys_getsr());
+    freebytes(text, size);
+
+    auto patch = x->x_job->patch;
+    pd::Loader::getInstance().enqueue([patch](){
+        patch->load();
+    });
+
+    return x;
+}
+
+static void parallel_tilde_free(t_parallel_tilde *x)
+{
+    pd::WorkerPool::getInstance().wait(*x->x_job);
+
+    // Stop printing through this instance, the load is skipped if it hasn't started yet.
+    // The loader runs in order, so the patch is released after it's done loading.
+    auto patch = std::move(x->x_job->patch);
+    patch->detach();
+
+    // The last reference has to go on the loader, where the instance is freed
+    pd::Loader::getInstance().enqueue([patch = std::move(patch)]() mutable {
+        patch.reset();
+    });
+
+    binbuf_free(x->x_pending);
+    binbuf_free(x->x_job->messages);
+    delete x->x_job;
+    delete x->x_vectors;
+}
+
+extern "C" void parallel_tilde_setup(void)
+{
+    parallel_tilde_class = class_new(gensym("parallel~"), (t_newmethod)parallel_tilde_new, (t_method)parallel_tilde_free,
+                                     sizeof(t_parallel_tilde), CLASS_DEFAULT, A_GIMME, 0);
+    CLASS_MAINSIGNALIN(parallel_tilde_class, t_parallel_tilde, x_f);
+    class_addmethod(parallel_tilde_class, (t_method)parallel_tilde_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(parallel_tilde_class, (t_method)parallel_tilde_suspend, gensym("suspend"), A_FLOAT, 0);
+    class_addanything(parallel_tilde_class, (t_method)parallel_tilde_anything);
+}
@@ -0,0 +1,337 @@
+/*
+ // Copyright (c) 2015-2018 Pierre Guillot.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+extern "C"
+{
+#include <z_libpd.h>
+#include <g_canvas.h>
+}
+
+#include "PdHostedPatch.hpp"
+#include "PdWorkerPool.hpp"
+
+// [poly~ -voices <n> -ninsig <n> -noutsig <n> -release <ms> <object> <args...>]
+// Computes a voice object, usually an abstraction, n times, each in a pd instance of its own.
+// All the voices get the same inputs and their outputs are summed. The voices of a block are
+// computed in parallel on the worker pool and collected before the block ends, so there's no delay.
+// "note <pitch> <velocity>", or a list of two floats, allocates a voice and sends it the list.
+// A voice without a held note is skipped once its outputs have been silent for the release time.
+// "voice <index> <message>" sends a message to one voice, any other message goes to all voices.
+// A message wakes the voices it's sent to, they're computed at least until the release time passes.
+// Each voice is a separate instance, so sends, receives, arrays, values and throw~/catch~ in a
+// voice don't reach the owner patch or the other voices.
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+struct poly_voice : public pd::WorkerPool::Job
+{
+    void run() override
+    {
+        patch->process(inputs, outputs.data(), blocksize, samplerate, messages);
+    }
+
+    std::shared_ptr<pd::HostedPatch> patch;
+    float const* inputs = nullptr;
+    std::vector<float> outputs;
+    t_binbuf* messages = nullptr;
+    int blocksize = 0;
+    float samplerate = 0.f;
+
+    int note = -1;              // The held note, -1 if none
+    unsigned int age = 0;       // When the note started, to steal the oldest voice
+    double silent = 0;          // How long the outputs have been silent, in samples
+    bool awake = false;         // Whether the voice is computed
+};
+
+static t_class *poly_tilde_class;
+
+typedef struct _poly_tilde
+{
+    t_object    x_obj;
+    t_float     x_f;
+    int         x_nins;
+    int         x_nouts;
+    int         x_nsiginlets;
+    t_float     x_release;
+    unsigned int x_age;
+
+    std::vector<poly_voice>* x_voices;
+    std::vector<float>*      x_inputs;
+    std::vector<t_sample*>*  x_vectors;
+} t_poly_tilde;
+
+static t_int *poly_tilde_perform(t_int *w)
+{
+    t_poly_tilde *x = (t_poly_tilde *)(w[1]);
+    int n = (int)(w[2]);
+    auto& voices = *x->x_voices;
+    auto& vectors = *x->x_vectors;
+    auto& pool = pd::WorkerPool::getInstance();
+
+    for(int ch = 0; ch < x->x_nins; ch++)
+        std::copy_n(vectors[ch], n, x->x_inputs->data() + ch * n);
+
+    // Voices still loading keep their messages, the ones that failed never read them
+    for(auto& voice : voices)
+    {
+        auto const state = voice.patch->getState();
+        if(state == pd::HostedPatch::Failed)
+            binbuf_clear(voice.messages);
+        else if(voice.awake && state == pd::HostedPatch::Ready)
+            pool.submit(voice);
+    }
+
+    for(int ch = 0; ch < x->x_nouts; ch++)
+        std::fill_n(vectors[x->x_nsiginlets + ch], n, 0.f);
+
+    const double release = x->x_release * 0.001 * voices.front().samplerate;
+    for(auto& voice : voices)
+    {
+        if(!voice.isPending())
+            continue;
+
+        pool.wait(voice);
+
+        for(int ch = 0; ch < x->x_nouts; ch++)
+        {
+            float const* in = voice.outputs.data() + ch * n;
+            t_sample* out = vectors[x->x_nsiginlets + ch];
+            for(int i = 0; i < n; i++)
+                out[i] += in[i];
+        }
+
+        const bool silent = pd::HostedPatch::isSilent(voice.outputs.data(), voice.outputs.size());
+        voice.silent = silent ? voice.silent + n : 0;
+        if(voice.note < 0 && voice.silent >= release)
+            voice.awake = false;
+    }
+
+    return (w+3);
+}
+
+static void poly_tilde_dsp(t_poly_tilde *x, t_signal **sp)
+{
+    const int n = sp[0]->s_n;
+    if(n % libpd_blocksize())
+    {
+        pd_error(x, "poly~: block size %d isn't a multiple of %d", n, libpd_blocksize());
+        for(int ch = 0; ch < x->x_nouts; ch++)
+            dsp_add_zero(sp[x->x_nsiginlets + ch]->s_vec, n);
+        return;
+    }
+
+    x->x_inputs->assign(x->x_nins * n, 0.f);
+    for(auto& voice : *x->x_voices)
+    {
+        voice.patch->setSampleRate(sp[0]->s_sr);
+        voice.blocksize = n;
+        voice.samplerate = sp[0]->s_sr;
+        voice.inputs = x->x_inputs->data();
+        voice.outputs.assign(x->x_nouts * n, 0.f);
+    }
+
+    x->x_vectors->resize(x->x_nsiginlets + x->x_nouts);
+    for(int i = 0; i < x->x_nsiginlets + x->x_nouts; i++)
+        (*x->x_vectors)[i] = sp[i]->s_vec;
+
+    dsp_add(poly_tilde_perform, 2, x, n);
+}
+
+static void poly_tilde_send(poly_voice& voice, t_symbol *s, int argc, t_atom *argv)
+{
+    // Sleeping voices are woken up to read it, so messages never pile up
+    voice.silent = 0;
+    voice.awake = true;
+
+    t_atom selector;
+    SETSYMBOL(&selector, s);
+    binbuf_add(voice.messages, 1, &selector);
+    binbuf_add(voice.messages, argc, argv);
+    binbuf_addsemi(voice.messages);
+}
+
+static void poly_tilde_note(t_poly_tilde *x, t_floatarg pitch, t_floatarg velocity)
+{
+    auto& voices = *x->x_voices;
+    t_atom list[2];
+    SETFLOAT(list, pitch);
+    SETFLOAT(list + 1, velocity);
+
+    if(velocity <= 0)
+    {
+        for(auto& voice : voices)
+        {
+            if(voice.note == (int)pitch)
+            {
+                voice.note = -1;
+                poly_tilde_send(voice, &s_list, 2, list);
+            }
+        }
+        return;
+    }
+
+    // Prefer a sleeping voice, then one that is releasing, and steal the oldest note otherwise
+    poly_voice* target = nullptr;
+    for(auto& voice : voices)
+    {
+        if(!voice.awake)
+        {
+            target = &voice;
+            break;
+        }
+        if(!target || (target->note >= 0 && voice.note < 0) ||
+           ((target->note >= 0) == (voice.note >= 0) && voice.age < target->age))
+            target = &voice;
+    }
+
+    target->note = (int)pitch;
+    target->age = x->x_age++;
+    target->silent = 0;
+    target->awake = true;
+    poly_tilde_send(*target, &s_list, 2, list);
+}
+
+static void poly_tilde_voice(t_poly_tilde *x, t_symbol *s, int argc, t_atom *argv)
+{
+    const int index = (int)atom_getfloatarg(0, argc, argv) - 1;
+    if(index < 0 || index >= (int)x->x_voices->size())
+    {
+        pd_error(x, "poly~: voice %d out of range", index + 1);
+        return;
+    }
+
+    if(argc < 2)
+        return;
+
+    auto& voice = (*x->x_voices)[index];
+    if(argv[1].a_type == A_SYMBOL)
+        poly_tilde_send(voice, argv[1].a_w.w_symbol, argc - 2, argv + 2);
+    else
+        poly_tilde_send(voice, &s_list, argc - 1, argv + 1);
+}
+
+static void poly_tilde_release(t_poly_tilde *x, t_floatarg ms)
+{
+    x->x_release = std::max(ms, 0.f);
+}
+
+static void poly_tilde_anything(t_poly_tilde *x, t_symbol *s, int argc, t_atom *argv)
+{
+    if(s == &s_list && argc == 2 && argv[0].a_type == A_FLOAT && argv[1].a_type == A_FLOAT)
+    {
+        poly_tilde_note(x, argv[0].a_w.w_float, argv[1].a_w.w_float);
+        return;
+    }
+
+    for(auto& voice : *x->x_voices)
+        poly_tilde_send(voice, s, argc, argv);
+}
+
+static void *poly_tilde_new(t_symbol *s, int argc, t_atom *argv)
+{
+    int nvoices = 8, nins = 0, nouts = 2;
+    t_float release = 50;
+    while(argc >= 2 && argv[0].a_type == A_SYMBOL && argv[0].a_w.w_symbol->s_name[0] == '-')
+    {
+        const char* flag = argv[0].a_w.w_symbol->s_name;
+        if(!strcmp(flag, "-voices"))
+            nvoices = std::max(1, (int)atom_getfloat(argv + 1));
+        else if(!strcmp(flag, "-ninsig"))
+            nins = std::max(0, (int)atom_getfloat(argv + 1));
+        else if(!strcmp(flag, "-noutsig"))
+            nouts = std::max(0, (int)atom_getfloat(argv + 1));
+        else if(!strcmp(flag, "-release"))
+            release = std::max(0.f, atom_getfloat(argv + 1));
+        else
+            pd_error(nullptr, "poly~: unknown flag %s", flag);
+        argc -= 2;
+        argv += 2;
+    }
+
+    if(!argc || argv[0].a_type != A_SYMBOL)
+    {
+        pd_error(nullptr, "poly~: no voice object");
+        return nullptr;
+    }
+
+    t_poly_tilde *x = (t_poly_tilde *)pd_new(poly_tilde_class);
+    x->x_nins = nins;
+    x->x_nouts = nouts;
+    x->x_nsiginlets = std::max(nins, 1);
+    x->x_release = release;
+    x->x_age = 0;
+    for(int i = 1; i < nins; i++)
+        inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+    for(int i = 0; i < nouts; i++)
+        outlet_new(&x->x_obj, &s_signal);
+
+    t_binbuf* b = binbuf_new();
+    binbuf_add(b, argc, argv);
+    char* text; int size;
+    binbuf_gettext(b, &text, &size);
+    binbuf_free(b);
+
+    const std::string directory = canvas_getdir(canvas_getcurrent())->s_name;
+    const std::string object(text, size);
+    freebytes(text, size);
+
+    x->x_inputs = new std::vector<float>();
+    x->x_vectors = new std::vector<t_sample*>();
+    x->x_voices = new std::vector<poly_voice>(nvoices);
+    for(auto& voice : *x->x_voices)
+    {
+        voice.messages = binbuf_new();
+        voice.patch = std::make_shared<pd::HostedPatch>(directory, object, nins, nouts, sys_getsr());
+
+        auto patch = voice.patch;
+        pd::Loader::getInstance().enqueue([patch](){
+            patch->load();
+        });
+    }
+
+    return x;
+}
+
+static void poly_tilde_free(t_poly_tilde *x)
+{
+    for(auto& voice : *x->x_voices)
+    {
+        // Stop printing through this instance, the loader releases the patch after loading it
+        auto patch = std::move(voice.patch);
+        patch->detach();
+
+        // The last reference has to go on the loader, where the instance is freed
+        pd::Loader::getInstance().enqueue([patch = std::move(patch)]() mutable {
+            patch.reset();
+        });
+
+        binbuf_free(voice.messages);
+    }
+
+    delete x->x_voices;
+    delete x->x_inputs;
+    delete x->x_vectors;
+}
+
+extern "C" void poly_tilde_setup(void)
+{
+    poly_tilde_class = class_new(gensym("poly~"), (t_newmethod)poly_tilde_new, (t_method)poly_tilde_free,
+                                 sizeof(t_poly_tilde), CLASS_DEFAULT, A_GIMME, 0);
+    CLASS_MAINSIGNALIN(poly_tilde_class, t_poly_tilde, x_f);
+    class_addmethod(poly_tilde_class, (t_method)poly_tilde_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(poly_tilde_class, (t_method)poly_tilde_note, gensym("note"), A_FLOAT, A_FLOAT, 0);
+    class_addmethod(poly_tilde_class, (t_method)poly_tilde_voice, gensym("voice"), A_GIMME, 0);
+    class_addmethod(poly_tilde_class, (t_method)poly_tilde_release, gensym("release"), A_FLOAT, 0);
+    class_addanything(poly_tilde_class, (t_method)poly_tilde_anything);
+}
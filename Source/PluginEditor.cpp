@@ -18,6 +18,7 @@
 PlugDataPluginEditor::PlugDataPluginEditor(PlugDataAudioProcessor& p, Console* debugConsole)
     : AudioProcessorEditor(&p)
     , pd(p)
+    , profilerPanel(p.profiler, p.telemetry)
     , levelmeter(p.parameters, p.meterSource)
 {
     console = debugConsole;
@@ -61,6 +62,18 @@ PlugDataPluginEditor::PlugDataPluginEditor(PlugDataAudioProcessor& p, Console* d
     addAndMakeVisible(tabbar);
     addAndMakeVisible(console);
     addChildComponent(inspector);
+    addChildComponent(profilerPanel);
+
+    // Heatmap over the boxes, from the share of the DSP chain each object takes
+    profilerPanel.onUpdate = [this]() {
+        for (auto* cnv : canvases) {
+            cnv->cpuShares.clear();
+            for (auto const& entry : profilerPanel.entries) {
+                cnv->cpuShares[entry.object] = static_cast<float>(profilerPanel.getShare(entry));
+            }
+            cnv->repaint();
+        }
+    };
 
     bypassButton.setTooltip("Bypass");
     bypassButton.setClickingTogglesState(true);
@@ -311,12 +324,13 @@ PlugDataPluginEditor::PlugDataPluginEditor(PlugDataAudioProcessor& p, Console* d
 
         toolbarButtons[8].setVisible(!sidebarHidden);
         toolbarButtons[9].setVisible(!sidebarHidden);
+        toolbarButtons[10].setVisible(!sidebarHidden);
 
         repaint();
         resized();
     };
 
-    // Sidebar selectors (inspector or console)
+    // Sidebar selectors (console, inspector or profiler)
     toolbarButtons[8].setTooltip("Show Console");
     toolbarButtons[8].setClickingTogglesState(true);
     toolbarButtons[8].setRadioGroupId(101);
@@ -325,16 +339,29 @@ PlugDataPluginEditor::PlugDataPluginEditor(PlugDataAudioProcessor& p, Console* d
     toolbarButtons[9].setClickingTogglesState(true);
     toolbarButtons[9].setRadioGroupId(101);
 
+    toolbarButtons[10].setTooltip("Show Profiler");
+    toolbarButtons[10].setClickingTogglesState(true);
+    toolbarButtons[10].setRadioGroupId(101);
+
     //  Open console
     toolbarButtons[8].onClick = [this]() {
         console->setVisible(true);
         inspector.setVisible(false);
+        profilerPanel.setVisible(false);
     };
 
     // Open inspector
     toolbarButtons[9].onClick = [this]() {
         console->setVisible(false);
         inspector.setVisible(true);
+        profilerPanel.setVisible(false);
+    };
+
+    // Open profiler
+    toolbarButtons[10].onClick = [this]() {
+        console->setVisible(false);
+        inspector.setVisible(false);
+        profilerPanel.setVisible(true);
     };
 
     addAndMakeVisible(hideButton);
@@ -409,6 +436,9 @@ void PlugDataPluginEditor::resized()
     inspector.setBounds(getWidth() - sContentWidth, sbarY + 2, sContentWidth, getHeight() - sbarY);
     inspector.toFront(false);
 
+    profilerPanel.setBounds(getWidth() - sContentWidth, sbarY + 2, sContentWidth, getHeight() - sbarY);
+    profilerPanel.toFront(false);
+
     tabbar.setBounds(0, sbarY, getWidth() - sWidth, getHeight() - sbarY - statusbarHeight);
     tabbar.toFront(false);
 
@@ -428,6 +458,7 @@ void PlugDataPluginEditor::resized()
     hideButton.setBounds(std::min(getWidth() - sWidth, getWidth() - 80), 0, 70, toolbarHeight);
     toolbarButtons[8].setBounds(std::min(getWidth() - sWidth + 90, getWidth() - 80), 0, 70, toolbarHeight);
     toolbarButtons[9].setBounds(std::min(getWidth() - sWidth + 160, getWidth() - 80), 0, 70, toolbarHeight);
+    toolbarButtons[10].setBounds(std::min(getWidth() - sWidth + 230, getWidth() - 80), 0, 70, toolbarHeight);
 
     lockButton.setBounds(8, getHeight() - 27, 27, 27);
     connectionStyleButton.setBounds(38, getHeight() - 27, 27, 27);
@@ -522,9 +553,29 @@ void PlugDataPluginEditor::timerCallback()
     auto* cnv = getCurrentCanvas();
     // cnv->patch.setCurrent();
 
+    // Guis that pd reports changes for are only updated when they changed, others are polled
+    // Changes on other tabs are dropped, so update everything when switching canvas
+    // Each canvas reports to its own instance, like help files do, so every instance's queue is emptied
+    std::unordered_set<void*> changed;
+    std::unordered_set<pd::Instance*> instances = { &pd };
+    for (auto* canvas : canvases) {
+        instances.insert(canvas->pd);
+    }
+
+    bool updateAll = cnv != lastUpdatedCanvas;
+    for (auto* instance : instances) {
+        if (!instance->dequeueGuiUpdates(changed) && cnv && instance == cnv->pd) {
+            updateAll = true;
+        }
+    }
+    lastUpdatedCanvas = cnv;
+
     //if(pd.getCallbackLock()->tryEnter()) {
         for (auto& box : cnv->boxes) {
-            if (box->graphics) {
+            if (!box->graphics)
+                continue;
+
+            if (updateAll || !box->graphics->pushesUpdates() || changed.count(box->pdObject->getPointer())) {
                 box->graphics->updateValue();
             }
         }
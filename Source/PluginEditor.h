@@ -11,6 +11,7 @@
 #include "Inspector.h"
 #include "LevelMeter.h"
 #include "LookAndFeel.h"
+#include "ProfilerPanel.h"
 
 #include "../Libraries/JUCE/modules/juce_audio_plugin_client/Standalone/juce_StandaloneFilterWindow.h"
 
@@ -90,6 +91,7 @@ public:
     TabComponent tabbar;
     OwnedArray<Canvas, CriticalSection> canvases;
     Inspector inspector;
+    ProfilerPanel profilerPanel;
 
     LevelMeter levelmeter;
 
@@ -108,8 +110,8 @@ private:
 
     bool sidebarHidden = false;
 
-    std::array<TextButton, 10> toolbarButtons = { TextButton(CharPointer_UTF8("\xef\x85\x9b")), TextButton(CharPointer_UTF8("\xef\x81\xbb")), TextButton(CharPointer_UTF8("\xef\x80\x99")), TextButton(CharPointer_UTF8("\xef\x83\xa2")), TextButton(CharPointer_UTF8("\xef\x80\x9e")), TextButton(CharPointer_UTF8("\xef\x81\xa7")), TextButton(CharPointer_UTF8("\xef\x80\x93")), TextButton(CharPointer_UTF8("\xef\x81\x94")),
-        TextButton(CharPointer_UTF8("\xef\x84\xa0")), TextButton(CharPointer_UTF8("\xef\x87\x9e")) };
+    std::array<TextButton, 11> toolbarButtons = { TextButton(CharPointer_UTF8("\xef\x85\x9b")), TextButton(CharPointer_UTF8("\xef\x81\xbb")), TextButton(CharPointer_UTF8("\xef\x80\x99")), TextButton(CharPointer_UTF8("\xef\x83\xa2")), TextButton(CharPointer_UTF8("\xef\x80\x9e")), TextButton(CharPointer_UTF8("\xef\x81\xa7")), TextButton(CharPointer_UTF8("\xef\x80\x93")), TextButton(CharPointer_UTF8("\xef\x81\x94")),
+        TextButton(CharPointer_UTF8("\xef\x84\xa0")), TextButton(CharPointer_UTF8("\xef\x87\x9e")), TextButton(CharPointer_UTF8("\xef\x83\xa4")) };
 
     TextButton& hideButton = toolbarButtons[7];
 
@@ -126,5 +128,8 @@ private:
     
     SharedResourcePointer<TooltipWindow> tooltipWindow;
 
+    // Used to detect tab switches, changes reported by pd are only applied to the current canvas
+    Canvas* lastUpdatedCanvas = nullptr;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlugDataPluginEditor)
 };
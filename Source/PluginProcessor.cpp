@@ -29,9 +29,7 @@ PlugDataAudioProcessor::PlugDataAudioProcessor(Console* externalConsole)
     , pd::Instance("PlugData"), Thread("PlugDataBackground")
     ,
 #endif
-    numin(2)
-    , numout(2)
-    , m_name("PlugData")
+    m_name("PlugData")
     , m_accepts_midi(true)
     , m_produces_midi(true)
     , m_is_midi_effect(false)
@@ -66,6 +64,8 @@ PlugDataAudioProcessor::PlugDataAudioProcessor(Console* externalConsole)
     
     // Update pd search paths for abstractions
     updateSearchPaths();
+    
+    pdBlockSize = settingsTree.getProperty("PdBlockSize", 64);
 
     // Initialise library for text autocompletion
     objectLibrary.initialiseLibrary(settingsTree.getChildWithName("Paths"));
@@ -88,6 +88,9 @@ PlugDataAudioProcessor::PlugDataAudioProcessor(Console* externalConsole)
         ownsConsole = true;
     }
 
+    // Messages to [pd] that ask for the callback timing
+    addListener("__telemetry");
+
     sendMessagesFromQueue();
     processMessages();
 
@@ -152,6 +155,14 @@ void PlugDataAudioProcessor::saveSettings()
 void PlugDataAudioProcessor::updateSearchPaths()
 {
     // Reload pd search paths from settings
+    initialiseInstance();
+
+    objectLibrary.initialiseLibrary(settingsTree.getChildWithName("Paths"));
+}
+
+void PlugDataAudioProcessor::initialiseInstance()
+{
+    // Each pd instance has its own search paths
     auto pathTree = settingsTree.getChildWithName("Paths");
 
     libpd_clear_search_path();
@@ -159,8 +170,6 @@ void PlugDataAudioProcessor::updateSearchPaths()
         auto path = child.getProperty("Path").toString();
         libpd_add_to_search_path(path.toRawUTF8());
     }
-
-    objectLibrary.initialiseLibrary(pathTree);
 }
 //==============================================================================
 const String PlugDataAudioProcessor::getName() const
@@ -230,7 +239,10 @@ void PlugDataAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBloc
     samplerate = sampleRate;
     sampsperblock = samplesPerBlock;
 
+    endCrossfade();
+
     prepareDSP(getTotalNumInputChannels(), getTotalNumOutputChannels(), sampleRate);
+    setBlockSize(pdBlockSize);
     //sendCurrentBusesLayoutInformation();
     m_audio_advancement = 0;
     const size_t blksize = static_cast<size_t>(Instance::getBlockSize());
@@ -238,7 +250,10 @@ void PlugDataAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBloc
     const size_t nouts = std::max(static_cast<size_t>(getTotalNumOutputChannels()), static_cast<size_t>(2));
     m_audio_buffer_in.resize(nins * blksize);
     m_audio_buffer_out.resize(nouts * blksize);
+    m_fade_buffer.resize(nouts * blksize);
     std::fill(m_audio_buffer_out.begin(), m_audio_buffer_out.end(), 0.f);
+    std::fill(m_fade_buffer.begin(), m_fade_buffer.end(), 0.f);
+    fadeLength = static_cast<int>(sampleRate * crossfadeTime);
     std::fill(m_audio_buffer_in.begin(), m_audio_buffer_in.end(), 0.f);
     m_midi_buffer_in.clear();
     m_midi_buffer_out.clear();
@@ -253,12 +268,13 @@ void PlugDataAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBloc
     processPrints();
     processingBuffer.setSize(2, samplesPerBlock);
 
-    meterSource.resize(numout, 50.0f * 0.001f * sampleRate / samplesPerBlock);
+    meterSource.resize(std::max(getTotalNumOutputChannels(), 1), 50.0f * 0.001f * sampleRate / samplesPerBlock);
 }
 
 void PlugDataAudioProcessor::releaseResources()
 {
     audioStarted = false;
+    endCrossfade();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -268,12 +284,9 @@ bool PlugDataAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts)
     ignoreUnused(layouts);
     return true;
 #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // Any layout up to maxChannels is passed straight to pd's adc~ and dac~ channels
+    auto const numOutputs = layouts.getMainOutputChannels();
+    if (numOutputs == 0 || numOutputs > maxChannels)
         return false;
 
         // This checks if the input layout matches the output layout
@@ -292,7 +305,7 @@ void PlugDataAudioProcessor::run()
     // Hack to make sure DAW will keep dequeuing messages from pd to the gui when bypassed
     // Should only start running when audio is bypassed
     while(!threadShouldExit()) {
-                
+        
         if(timeSinceProcess < 5) {
             timeSinceProcess = timeSinceProcess + 1;
         }
@@ -351,6 +364,7 @@ void PlugDataAudioProcessor::processBlockBypassed(AudioSampleBuffer& buffer, Mid
 
 void PlugDataAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
+    auto const callbackStart = Telemetry::now();
 
     ScopedNoDenormals noDenormals;
     auto totalNumInputChannels = getTotalNumInputChannels();
@@ -365,11 +379,6 @@ void PlugDataAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    auto const maxOuts = std::max(numout, buffer.getNumChannels());
-    for (int i = numin; i < maxOuts; ++i) {
-        buffer.clear(i, 0, buffer.getNumSamples());
-    }
-
     // This is the place where you'd normally do the guts of your plugin's
     // audio processing...
     // Make sure to reset the state if your inner loop is processing
@@ -390,36 +399,23 @@ void PlugDataAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
     }
 
     // Run help files (without audio)
+    // processingBuffer is only used as scratch space for them
     if (auto* editor = dynamic_cast<PlugDataPluginEditor*>(getActiveEditor())) {
+        processingBuffer.setSize(2, buffer.getNumSamples(), false, false, true);
         for (int c = 0; c < editor->canvases.size(); c++) {
             auto* cnv = editor->canvases[c];
             if (cnv && cnv->aux_instance) {
+                processingBuffer.clear();
                 cnv->aux_instance->enabled->store(0);
                 cnv->aux_instance->process(processingBuffer, midiMessages);
             }
         }
     }
-    
-    processingBuffer.setSize(2, buffer.getNumSamples());
 
-    // If we're a logic MIDI processor!
-    if(buffer.getNumChannels() == 0) {
-        processingBuffer.clear();
-    }
-    else {
-        processingBuffer.copyFrom(0, 0, buffer, 0, 0, buffer.getNumSamples());
-        processingBuffer.copyFrom(1, 0, buffer, totalNumInputChannels == 2 ? 1 : 0, 0, buffer.getNumSamples());
+    // The host buffer is copied straight into pd's input buffer and back, for any number of channels
+    process(buffer, midiMessages);
 
-    }
-
-    process(processingBuffer, midiMessages);
-
-    if(buffer.getNumChannels() != 0) {
-        buffer.copyFrom(0, 0, processingBuffer, 0, 0, buffer.getNumSamples());
-    }
-    if (totalNumOutputChannels == 2) {
-        buffer.copyFrom(1, 0, processingBuffer, 1, 0, buffer.getNumSamples());
-    }
+    auto const meterStart = Telemetry::now();
 
     float avg = 0.0f;
     for (int ch = 0; ch < buffer.getNumChannels(); ch++) {
@@ -430,19 +426,28 @@ void PlugDataAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
     buffer.applyGain(getParameters()[0]->getValue());
 
     meterSource.measureBlock(buffer);
+
+    auto const callbackEnd = Telemetry::now();
+    phaseTicks[Telemetry::Meters] += callbackEnd - meterStart;
+
+    for (int phase = Telemetry::Dequeue; phase < Telemetry::NumPhases; phase++) {
+        telemetry.add(static_cast<Telemetry::Phase>(phase), Telemetry::toMicroseconds(phaseTicks[phase]));
+    }
+    telemetry.addCallback(Telemetry::toMicroseconds(callbackEnd - callbackStart), buffer.getNumSamples(), getSampleRate());
 }
 
 void PlugDataAudioProcessor::process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
     timeSinceProcess = 0;
+    phaseTicks.fill(0);
     
     ScopedNoDenormals noDenormals;
     const int blocksize = Instance::getBlockSize();
     const int nsamples  = buffer.getNumSamples();
-    const int adv       = m_audio_advancement >= 64 ? 0 : m_audio_advancement;
+    const int adv       = m_audio_advancement >= blocksize ? 0 : m_audio_advancement;
     const int nleft     = blocksize - adv;
-    const int nins      = getTotalNumInputChannels();
-    const int nouts     = getTotalNumOutputChannels();
+    const int nins      = std::min(getTotalNumInputChannels(), buffer.getNumChannels());
+    const int nouts     = std::min(getTotalNumOutputChannels(), buffer.getNumChannels());
     const float **bufferin = buffer.getArrayOfReadPointers();
     float **bufferout = buffer.getArrayOfWritePointers();
     const bool midi_consume = m_accepts_midi;
@@ -647,49 +652,109 @@ void PlugDataAudioProcessor::processInternal()
     timeSinceProcess = 0;
     setThis();
     
+    auto const dequeueStart = Telemetry::now();
     isDequeueing = true;
     sendMessagesFromQueue();
     isDequeueing = false;
     
+    auto const midiStart = Telemetry::now();
     sendMidiBuffer();
+    
+    auto const midiEnd = Telemetry::now();
     processMessages();
     processPrints();
+    
+    phaseTicks[Telemetry::Dequeue] += (midiStart - dequeueStart) + (Telemetry::now() - midiEnd);
+    phaseTicks[Telemetry::Midi] += midiEnd - midiStart;
 
     //////////////////////////////////////////////////////////////////////////////////////////
     //                                          AUDIO                                       //
     //////////////////////////////////////////////////////////////////////////////////////////
 
+    auto const dspStart = Telemetry::now();
+    
     if (enabled->load()) {
-        // Copy circuitlab's output to Pure data to Pd input channels
-        std::copy_n(m_audio_buffer_out.data() + (2 * 64), (numout - 2) * 64, m_audio_buffer_in.data() + (2 * 64));
-
-        Instance::canvasLock.lock();
+        canvasLock.lock();
         performDSP(m_audio_buffer_in.data(), m_audio_buffer_out.data());
-        Instance::canvasLock.unlock();
+        performCrossfade();
+        canvasLock.unlock();
     }
 
     else {
         std::fill(m_audio_buffer_in.begin(), m_audio_buffer_in.end(), 0.f);
 
-        Instance::canvasLock.lock();
+        canvasLock.lock();
         performDSP(m_audio_buffer_in.data(), m_audio_buffer_out.data());
-        Instance::canvasLock.unlock();
+        performCrossfade();
+        canvasLock.unlock();
 
         std::fill(m_audio_buffer_out.begin(), m_audio_buffer_out.end(), 0.f);
     }
+    
+    phaseTicks[Telemetry::DSP] += Telemetry::now() - dspStart;
 
     //////////////////////////////////////////////////////////////////////////////////////////
     //                                          MIDI OUT                                    //
     //////////////////////////////////////////////////////////////////////////////////////////
 
     if (m_produces_midi) {
+        auto const midiOutStart = Telemetry::now();
         m_midibyte_index = 0;
         m_midibyte_buffer[0] = 0;
         m_midibyte_buffer[1] = 0;
         m_midibyte_buffer[2] = 0;
         m_midi_buffer_out.clear();
         processMidi();
+        phaseTicks[Telemetry::Midi] += Telemetry::now() - midiOutStart;
+    }
+}
+
+void PlugDataAudioProcessor::performCrossfade()
+{
+    if (!fadingOut)
+        return;
+
+    // The fade ended in the last block, and the messages the previous patch sent meanwhile were dequeued since.
+    // loadPatch frees it once it sees this
+    if (fadePosition >= fadeLength) {
+        fadingOut = nullptr;
+        return;
+    }
+
+    const int blocksize = Instance::getBlockSize();
+    const int nouts = static_cast<int>(m_audio_buffer_out.size()) / blocksize;
+
+    performDSP(*fadingOut, m_audio_buffer_in.data(), m_fade_buffer.data());
+
+    // Equal power, since the two patches have nothing in common
+    for (int i = 0; i < blocksize; i++) {
+        auto const position = std::min(static_cast<float>(fadePosition + i) / static_cast<float>(fadeLength), 1.f);
+        auto const gainIn = std::sin(position * MathConstants<float>::halfPi);
+        auto const gainOut = std::cos(position * MathConstants<float>::halfPi);
+
+        for (int ch = 0; ch < nouts; ch++) {
+            auto& sample = m_audio_buffer_out[ch * blocksize + i];
+            sample = sample * gainIn + m_fade_buffer[ch * blocksize + i] * gainOut;
+        }
     }
+
+    fadePosition += blocksize;
+}
+
+void PlugDataAudioProcessor::endCrossfade()
+{
+    // Only called while no blocks are computed, so ending the fade here can't be heard
+    canvasLock.lock();
+    fadingOut = nullptr;
+    canvasLock.unlock();
+}
+
+bool PlugDataAudioProcessor::isFadingOut(pd::Instance::LoadedInstance* instance)
+{
+    canvasLock.lock();
+    bool const fading = fadingOut == instance;
+    canvasLock.unlock();
+    return fading;
 }
 
 //==============================================================================
@@ -771,13 +836,52 @@ void PlugDataAudioProcessor::loadPatch(String patch)
         patchFile.replaceWithText(patch);
     }
 
-    const CriticalSection* lock = getCallbackLock();
+    // The patch is opened in an instance of its own on this thread, while the current one keeps playing
+    auto loaded = prepareInstance(patchFile.getParentDirectory().getFullPathName().toStdString(), patchFile.getFileName().toStdString());
 
-    lock->enter();
-    openPatch(patchFile.getParentDirectory().getFullPathName().toStdString(), patchFile.getFileName().toStdString());
-    lock->exit();
+    // The canvases of the previous patch go before it does. What they queued runs first, while they still exist
+    auto* editor = dynamic_cast<PlugDataPluginEditor*>(getActiveEditor());
+    if (editor) {
+        waitForStateUpdate();
+        editor->tabbar.clearTabs();
+        editor->canvases.clear();
+        editor->mainCanvas = nullptr;
+    }
 
-    if (auto* editor = dynamic_cast<PlugDataPluginEditor*>(getActiveEditor())) {
+    // It takes over between two blocks, whichever thread dequeues the function. The previous patch
+    // only fades out when the function runs from processBlock, otherwise no blocks would finish the
+    // fade and it's freed right away. That step only swaps pointers, everything that allocates happens here
+    std::unique_ptr<LoadedInstance> previous;
+    while (true) {
+        waitForResult(enqueueFunctionAsync([this, &loaded, &previous]() {
+            canvasLock.lock();
+
+            // An earlier fade is left to finish rather than cut short
+            if (!fadingOut && matchesSettings(*loaded)) {
+                previous = swapInstance(std::move(loaded));
+                if (fadeLength > 0 && isDequeueing) {
+                    fadingOut = previous.get();
+                    fadePosition = 0;
+                }
+            }
+            canvasLock.unlock();
+        }));
+
+        if (previous)
+            break;
+
+        canvasLock.lock();
+        bool const matches = matchesSettings(*loaded);
+        canvasLock.unlock();
+
+        // The audio settings changed while the patch was loading
+        if (!matches)
+            restartInstance(*loaded);
+        else
+            Thread::sleep(1);
+    }
+
+    if (editor) {
         auto* cnv = editor->canvases.add(new Canvas(*editor, false));
         cnv->title = "Untitled Patcher";
 
@@ -786,6 +890,19 @@ void PlugDataAudioProcessor::loadPatch(String patch)
         cnv->synchronise();
         editor->addTab(cnv);
     }
+
+    // The previous patch is freed here, once the fade is done. If the audio stopped mid-fade without
+    // releaseResources, nobody finishes the fade, and ending it can't be heard
+    for (int i = 0; i < 200 && isFadingOut(previous.get()); i++)
+        Thread::sleep(5);
+
+    canvasLock.lock();
+    if (fadingOut == previous.get())
+        fadingOut = nullptr;
+    canvasLock.unlock();
+
+    previous.reset();
+    setThis();
 }
 
 void PlugDataAudioProcessor::receiveNoteOn(const int channel, const int pitch, const int velocity)
@@ -846,6 +963,28 @@ void PlugDataAudioProcessor::receiveMidiByte(const int port, const int byte)
     }
 }
 
+void PlugDataAudioProcessor::receiveMessage(const char* dest, const char* msg, const pd::AtomList& list)
+{
+    if (strcmp(dest, "__telemetry") != 0)
+        return;
+
+    // [; pd telemetry reset( clears the statistics
+    if (list.size() > 0 && list[0].isSymbol() && strcmp(list[0].getSymbol(), "reset") == 0) {
+        telemetry.reset();
+        return;
+    }
+
+    // [; pd telemetry( answers on [r telemetry] with "<phase> <median> <p99> <max> <count>", in microseconds
+    for (int phase = 0; phase < Telemetry::NumPhases; phase++) {
+        auto const stats = telemetry.getStats(static_cast<Telemetry::Phase>(phase));
+        sendMessage("telemetry", Telemetry::getName(static_cast<Telemetry::Phase>(phase)),
+            { pd::Atom(static_cast<float>(stats.median)), pd::Atom(static_cast<float>(stats.p99)), pd::Atom(static_cast<float>(stats.max)), pd::Atom(static_cast<float>(stats.count)) });
+    }
+
+    sendMessage("telemetry", "deadline", { pd::Atom(static_cast<float>(telemetry.getDeadline())) });
+    sendMessage("telemetry", "xruns", { pd::Atom(static_cast<float>(telemetry.getNumXruns())) });
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
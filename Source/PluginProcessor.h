@@ -10,6 +10,7 @@
 #include "Pd/PdInstance.hpp"
 #include "Pd/PdLibrary.hpp"
 #include "PluginEditor.h"
+#include "Telemetry.h"
 #include <JuceHeader.h>
 #include <ff_meters/ff_meters.h>
 
@@ -71,6 +72,7 @@ public:
     void receiveAftertouch(const int channel, const int value) override;
     void receivePolyAftertouch(const int channel, const int pitch, const int value) override;
     void receiveMidiByte(const int port, const int byte) override;
+    void receiveMessage(const char* dest, const char* msg, const pd::AtomList& list) override;
 
     void receivePrint(const std::string& message) override
     {
@@ -127,6 +129,7 @@ public:
     void initialiseFilesystem();
     void saveSettings();
     void updateSearchPaths();
+    void initialiseInstance() override;
 
     void sendMidiBuffer();
     
@@ -143,12 +146,19 @@ public:
 
     std::atomic<float>* volume;
 
-    std::vector<pd::Atom> parameterAtom = std::vector<pd::Atom>(1);
+    pd::AtomList parameterAtom = { pd::Atom(0.0f) };
 
-    int numin;
-    int numout;
     int sampsperblock = 512;
 
+    // Maximum number of input or output channels in the main bus
+    static constexpr int maxChannels = 32;
+    
+    // Number of samples pd computes per dequeue of messages/MIDI, a multiple of 64
+    int pdBlockSize = 64;
+    
+    // Seconds the previous patch takes to fade out when loadPatch swaps in a new one
+    static constexpr double crossfadeTime = 0.02;
+
     ValueTree settingsTree = ValueTree("PlugDataSettings");
 
     pd::Library objectLibrary;
@@ -165,8 +175,14 @@ public:
 
     foleys::LevelMeterSource meterSource;
 
+    // Callback timing, read by the profiler panel and [; pd telemetry(
+    Telemetry telemetry;
+
 private:
     void processInternal();
+    void performCrossfade();
+    void endCrossfade();
+    bool isFadingOut(pd::Instance::LoadedInstance* instance);
 
     bool ownsConsole;
 
@@ -179,6 +195,13 @@ private:
     int m_audio_advancement;
     std::vector<float> m_audio_buffer_in;
     std::vector<float> m_audio_buffer_out;
+    std::vector<float> m_fade_buffer;
+
+    // The previous patch while it fades out, guarded by canvasLock. loadPatch owns it and frees it
+    // once the audio thread sets this back to nullptr
+    pd::Instance::LoadedInstance* fadingOut = nullptr;
+    int fadePosition = 0;
+    int fadeLength = 0;
 
     MidiBuffer m_midi_buffer_in;
     MidiBuffer m_midi_buffer_out;
@@ -196,6 +219,9 @@ private:
     
     std::atomic<bool> isDequeueing = false;
 
+    // Time spent per phase in the current callback, summed over its pd blocks
+    std::array<int64, Telemetry::NumPhases> phaseTicks = {};
+
     MainLook mainLook;
 
     //==============================================================================
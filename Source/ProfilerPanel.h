@@ -0,0 +1,220 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+#pragma once
+
+#include "LookAndFeel.h"
+#include "Pd/PdProfiler.hpp"
+#include "Telemetry.h"
+#include <JuceHeader.h>
+
+// Sidebar panel that shows the audio callback timing, and the DSP time of every object from pd::Profiler
+struct ProfilerPanel : public Component,
+                       public TableListBoxModel,
+                       public Timer {
+    //==============================================================================
+    ProfilerPanel(pd::Profiler& p, Telemetry& t) : profiler(p), telemetry(t), font(14.0f)
+    {
+        callbackInfo.setFont(Font(13.0f));
+        callbackInfo.setJustificationType(Justification::topLeft);
+        callbackInfo.setColour(Label::textColourId, Colours::white);
+        addAndMakeVisible(callbackInfo);
+
+        enableButton.setClickingTogglesState(true);
+        enableButton.setConnectedEdges(12);
+        enableButton.onClick = [this]() {
+            setProfiling(enableButton.getToggleState());
+        };
+        addAndMakeVisible(enableButton);
+
+        addAndMakeVisible(&table);
+        table.setModel(this);
+
+        table.setColour(ListBox::outlineColourId, Colours::transparentBlack);
+        table.setColour(ListBox::textColourId, Colours::white);
+
+        table.setOutlineThickness(1);
+
+        table.getHeader().addColumn("Object", 1, 90, 30, -1);
+        table.getHeader().addColumn("Subpatch", 2, 70, 30, -1);
+        table.getHeader().addColumn(CharPointer_UTF8("\xc2\xb5s/tick"), 3, 50, 30, -1);
+        table.getHeader().addColumn("CPU", 4, 50, 30, -1);
+
+        table.getHeader().setStretchToFitActive(true);
+        table.getHeader().setSortColumnId(3, false);
+
+        table.getHeader().setColour(TableHeaderComponent::textColourId, Colours::white);
+        table.getHeader().setColour(TableHeaderComponent::backgroundColourId, MainLook::highlightColour);
+
+        startTimer(500);
+    }
+
+    ~ProfilerPanel()
+    {
+        // Nobody can see the results anymore
+        profiler.setEnabled(false);
+    }
+
+    void setProfiling(bool shouldProfile)
+    {
+        profiler.setEnabled(shouldProfile);
+        enableButton.setToggleState(shouldProfile, dontSendNotification);
+        enableButton.setButtonText(shouldProfile ? "Stop Profiling" : "Start Profiling");
+
+        if (!shouldProfile) {
+            entries.clear();
+            total = 0;
+            table.updateContent();
+            repaint();
+
+            if (onUpdate)
+                onUpdate();
+        }
+    }
+
+    void timerCallback() override
+    {
+        updateCallbackInfo();
+
+        if (!profiler.isEnabled() || !profiler.getResults(entries, total))
+            return;
+
+        sortEntries();
+        table.updateContent();
+        repaint();
+
+        if (onUpdate)
+            onUpdate();
+    }
+
+    //==============================================================================
+    int getNumRows() override
+    {
+        return static_cast<int>(entries.size());
+    }
+
+    void paintRowBackground(Graphics& g, int row, int w, int h, bool rowIsSelected) override
+    {
+        if (rowIsSelected) {
+            g.fillAll(MainLook::highlightColour);
+        } else {
+            g.fillAll((row % 2) ? MainLook::firstBackground : MainLook::secondBackground);
+        }
+    }
+
+    void paintCell(Graphics& g, int rowNumber, int columnId, int width, int height, bool /*rowIsSelected*/) override
+    {
+        if (rowNumber >= entries.size())
+            return;
+
+        auto const& entry = entries[rowNumber];
+
+        String text;
+        switch (columnId) {
+        case 1:
+            text = entry.name;
+            break;
+        case 2:
+            text = entry.parentName ? entry.parentName : "main";
+            break;
+        case 3:
+            text = String(entry.time / 1000.0, 2);
+            break;
+        case 4:
+            text = String(getShare(entry) * 100.0, 1) + "%";
+            break;
+        }
+
+        g.setColour(Colours::white);
+        g.setFont(font);
+        g.drawText(text, 2, 0, width - 4, height, columnId > 2 ? Justification::centredRight : Justification::centredLeft, true);
+
+        g.setColour(Colours::black.withAlpha(0.2f));
+        g.fillRect(width - 1, 0, 1, height);
+    }
+
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override
+    {
+        sortColumn = newSortColumnId;
+        sortForwards = isForwards;
+
+        sortEntries();
+        table.updateContent();
+        repaint();
+    }
+
+    // The p99 of each phase of the audio callback, next to the time its samples last
+    void updateCallbackInfo()
+    {
+        auto const callback = telemetry.getStats(Telemetry::Callback);
+        if (!isVisible() || callback.count == 0)
+            return;
+
+        String text;
+        text << "Callback p99 " << String(roundToInt(callback.p99)) << " / " << String(roundToInt(telemetry.getDeadline())) << CharPointer_UTF8(" \xc2\xb5s, ");
+        text << String(telemetry.getNumXruns()) << " xruns\n";
+
+        for (int phase = Telemetry::Dequeue; phase < Telemetry::NumPhases; phase++) {
+            auto const stats = telemetry.getStats(static_cast<Telemetry::Phase>(phase));
+            text << Telemetry::getName(static_cast<Telemetry::Phase>(phase)) << " " << String(roundToInt(stats.p99)) << "  ";
+        }
+
+        callbackInfo.setText(text, dontSendNotification);
+    }
+
+    //==============================================================================
+    void resized() override
+    {
+        auto bounds = getLocalBounds();
+        callbackInfo.setBounds(bounds.removeFromTop(36));
+        enableButton.setBounds(bounds.removeFromTop(30).reduced(2));
+        table.setBounds(bounds.expanded(2));
+    }
+
+    // Share of the whole DSP chain, a subpatch includes its content
+    double getShare(pd::Profiler::Entry const& entry) const
+    {
+        return total > 0 ? entry.time / total : 0.0;
+    }
+
+    void sortEntries()
+    {
+        auto compare = [this](pd::Profiler::Entry const& lhs, pd::Profiler::Entry const& rhs) {
+            switch (sortColumn) {
+            case 1:
+                return String(lhs.name).compareNatural(rhs.name) < 0;
+            case 2:
+                return String(lhs.parentName ? lhs.parentName : "").compareNatural(rhs.parentName ? rhs.parentName : "") < 0;
+            default:
+                return lhs.time < rhs.time;
+            }
+        };
+
+        if (sortForwards) {
+            std::stable_sort(entries.begin(), entries.end(), compare);
+        } else {
+            std::stable_sort(entries.rbegin(), entries.rend(), compare);
+        }
+    }
+
+    // Called when new results came in, or when they were cleared
+    std::function<void()> onUpdate;
+
+    std::vector<pd::Profiler::Entry> entries;
+    double total = 0;
+
+private:
+    pd::Profiler& profiler;
+    Telemetry& telemetry;
+
+    Label callbackInfo;
+    TextButton enableButton = TextButton("Start Profiling");
+    TableListBox table;
+    Font font;
+
+    int sortColumn = 3;
+    bool sortForwards = false;
+};
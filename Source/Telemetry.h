@@ -0,0 +1,145 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cmath>
+
+// Timing statistics of the audio callback, split into its phases
+// The audio thread adds durations to log-spaced histograms without locking or allocating,
+// any other thread can read percentiles from them at the same time
+struct Telemetry {
+    enum Phase {
+        Callback, // The whole processBlock
+        Dequeue,  // Messages, prints and functions from and to the gui
+        Midi,     // MIDI conversion in both directions
+        DSP,      // performDSP
+        Meters,   // Gain and level meter
+        NumPhases
+    };
+
+    // Quarter octaves from 1µs, so the last bucket starts around 16 seconds
+    static constexpr int bucketsPerOctave = 4;
+    static constexpr int numBuckets = 96;
+
+    struct Stats {
+        double median = 0; // In microseconds, rounded up to the bucket
+        double p99 = 0;
+        double max = 0;
+        uint32 count = 0;
+    };
+
+    static int64 now() noexcept
+    {
+        return Time::getHighResolutionTicks();
+    }
+
+    static double toMicroseconds(int64 ticks) noexcept
+    {
+        return Time::highResolutionTicksToSeconds(ticks) * 1e6;
+    }
+
+    static const char* getName(Phase phase) noexcept
+    {
+        static const char* names[NumPhases] = { "callback", "dequeue", "midi", "dsp", "meters" };
+        return names[phase];
+    }
+
+    //==============================================================================
+    // Audio thread
+
+    void add(Phase phase, double microseconds) noexcept
+    {
+        auto& histogram = histograms[phase];
+        const int bucket = std::clamp(static_cast<int>(std::floor(std::log2(std::max(microseconds, 1.0)) * bucketsPerOctave)), 0, numBuckets - 1);
+        histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+        // Only the audio thread writes it, a reset in between just loses one maximum
+        if (microseconds > histogram.max.load(std::memory_order_relaxed))
+            histogram.max.store(microseconds, std::memory_order_relaxed);
+    }
+
+    // A callback that takes longer than the time its samples last is counted as an xrun
+    void addCallback(double microseconds, int numSamples, double sampleRate) noexcept
+    {
+        add(Callback, microseconds);
+
+        const double budget = sampleRate > 0 ? numSamples / sampleRate * 1e6 : 0.0;
+        deadline.store(budget, std::memory_order_relaxed);
+
+        if (budget > 0 && microseconds > budget)
+            xruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    // Any thread
+
+    Stats getStats(Phase phase) const noexcept
+    {
+        auto const& histogram = histograms[phase];
+
+        std::array<uint32, numBuckets> counts;
+        Stats stats;
+        for (int i = 0; i < numBuckets; i++) {
+            counts[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+            stats.count += counts[i];
+        }
+
+        stats.max = histogram.max.load(std::memory_order_relaxed);
+        stats.median = getPercentile(counts, stats.count, 0.5);
+        stats.p99 = getPercentile(counts, stats.count, 0.99);
+        return stats;
+    }
+
+    // The duration of the last callback's samples, in microseconds
+    double getDeadline() const noexcept
+    {
+        return deadline.load(std::memory_order_relaxed);
+    }
+
+    uint32 getNumXruns() const noexcept
+    {
+        return xruns.load(std::memory_order_relaxed);
+    }
+
+    void reset() noexcept
+    {
+        for (auto& histogram : histograms) {
+            for (auto& bucket : histogram.buckets)
+                bucket.store(0, std::memory_order_relaxed);
+            histogram.max.store(0, std::memory_order_relaxed);
+        }
+        xruns.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    struct Histogram {
+        std::array<std::atomic<uint32>, numBuckets> buckets = {};
+        std::atomic<double> max = 0;
+    };
+
+    static double getPercentile(std::array<uint32, numBuckets> const& counts, uint32 total, double fraction) noexcept
+    {
+        if (total == 0)
+            return 0;
+
+        const auto target = static_cast<uint64>(std::ceil(total * fraction));
+        uint64 seen = 0;
+        for (int i = 0; i < numBuckets; i++) {
+            seen += counts[i];
+            if (seen >= target)
+                return std::exp2(static_cast<double>(i + 1) / bucketsPerOctave);
+        }
+        return std::exp2(static_cast<double>(numBuckets) / bucketsPerOctave);
+    }
+
+    std::array<Histogram, NumPhases> histograms;
+    std::atomic<double> deadline = 0;
+    std::atomic<uint32> xruns = 0;
+};